@@ -0,0 +1,181 @@
+//
+// Created by byao on 2/4/18.
+// Copyright (c) 2018 byao. All rights reserved.
+//
+// Loopback tcp echo, ping-pong on every connection: requests/s, bytes/s and
+// round trip latency percentiles.
+//
+// usage: benchecho [connections] [message size] [server threads]
+//                  [client threads] [seconds]
+//
+
+#include "../src/address.hpp"
+#include "../src/bytebuffer.hpp"
+#include "../src/poller_epoll.hpp"
+#include "../src/tcp_listener.hpp"
+#include "../src/tcp_stream.hpp"
+#include "histogram.hpp"
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+
+using namespace std;
+using namespace bsnet;
+
+namespace {
+
+using Clock = chrono::steady_clock;
+
+atomic<bool> stopped(false);
+
+// calls 'handle' for the polled events, and the ones queued in user space.
+template <typename F>
+void poll_once(Poller &poller, vector<Event> &events, vector<Event> &user,
+               F handle) {
+  Duration timeout(100);
+  int n = poller.poll(events, &timeout);
+  for (int i = 0; i < n; ++i) {
+    if (events[i].token() == Token(0)) {
+      user.clear();
+      poller.user_poll(user);
+      for (auto &evt : user)
+        handle(evt);
+    } else {
+      handle(events[i]);
+    }
+  }
+}
+
+void serve(vector<TcpStream> &streams) {
+  auto poller = Poller::new_instance();
+  for (size_t i = 0; i < streams.size(); ++i)
+    poller->register_evt(streams[i], Token(i + 1), Ready::readable(),
+                         PollOpt::edge());
+
+  vector<Event> events(256), user;
+  ByteBuffer buf(TcpStream::MaxReadSize);
+  while (!stopped.load(memory_order_relaxed)) {
+    poll_once(*poller, events, user, [&](const Event &evt) {
+      TcpStream &stream = streams[evt.token().index() - 1];
+      if (evt.readiness().is_writable())
+        stream.flush();
+      if (evt.readiness().is_readable() && stream.read_some(buf) > 0)
+        stream.send(buf);
+    });
+  }
+}
+
+struct Conn {
+  TcpStream stream;
+  ByteBuffer buf;
+  size_t received;
+  Clock::time_point sent;
+};
+
+struct ClientResult {
+  Histogram latency;
+  uint64_t requests = 0;
+};
+
+void drive(vector<Conn> &conns, const vector<Byte> &msg,
+           Clock::time_point deadline, ClientResult &res) {
+  auto poller = Poller::new_instance();
+  for (size_t i = 0; i < conns.size(); ++i)
+    poller->register_evt(conns[i].stream, Token(i + 1), Ready::readable(),
+                         PollOpt::edge());
+
+  auto ping = [&](Conn &conn) {
+    conn.received = 0;
+    conn.sent = Clock::now();
+    conn.stream.send(msg.data(), msg.size());
+  };
+  for (auto &conn : conns)
+    ping(conn);
+
+  vector<Event> events(256), user;
+  while (Clock::now() < deadline) {
+    poll_once(*poller, events, user, [&](const Event &evt) {
+      Conn &conn = conns[evt.token().index() - 1];
+      if (evt.readiness().is_writable())
+        conn.stream.flush();
+      if (!evt.readiness().is_readable() ||
+          conn.stream.read_some(conn.buf) <= 0)
+        return;
+      conn.received += conn.buf.readable_bytes();
+      conn.buf.clear();
+      if (conn.received >= msg.size()) {
+        auto rtt = chrono::duration_cast<chrono::nanoseconds>(Clock::now() -
+                                                              conn.sent);
+        res.latency.record(static_cast<uint64_t>(rtt.count()));
+        ++res.requests;
+        ping(conn);
+      }
+    });
+  }
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  int conns = argc > 1 ? atoi(argv[1]) : 16;
+  auto size = static_cast<size_t>(argc > 2 ? atoi(argv[2]) : 64);
+  int server_threads = argc > 3 ? atoi(argv[3]) : 1;
+  int client_threads = argc > 4 ? atoi(argv[4]) : 1;
+  int seconds = argc > 5 ? atoi(argv[5]) : 5;
+
+  TcpListener listener = TcpListener::bind(AddrV4::from("127.0.0.1:0"),
+                                           static_cast<size_t>(conns));
+  Addr addr;
+  listener.local_addr(addr);
+
+  // connect everything before the clock starts.
+  vector<vector<TcpStream>> served(server_threads);
+  vector<vector<Conn>> clients(client_threads);
+  for (int i = 0; i < conns; ++i) {
+    TcpStream client = TcpStream::connect(addr);
+    TcpStream server = listener.accept();
+    client.set_nodelay(true);
+    server.set_nodelay(true);
+    served[i % server_threads].push_back(std::move(server));
+    clients[i % client_threads].push_back(
+        Conn{std::move(client), ByteBuffer(size), 0, Clock::time_point()});
+  }
+
+  vector<Byte> msg(size, 'x');
+  vector<ClientResult> results(client_threads);
+  vector<thread> servers, drivers;
+  for (auto &streams : served)
+    servers.emplace_back(serve, std::ref(streams));
+  auto start = Clock::now();
+  auto deadline = start + chrono::seconds(seconds);
+  for (int i = 0; i < client_threads; ++i)
+    drivers.emplace_back(drive, std::ref(clients[i]), std::cref(msg), deadline,
+                         std::ref(results[i]));
+  for (auto &t : drivers)
+    t.join();
+  double elapsed = chrono::duration<double>(Clock::now() - start).count();
+  stopped.store(true);
+  for (auto &t : servers)
+    t.join();
+
+  ClientResult total;
+  for (auto &res : results) {
+    total.latency.merge(res.latency);
+    total.requests += res.requests;
+  }
+  auto us = [&](double p) { return total.latency.percentile(p) / 1000.0; };
+
+  printf("connections: %d, message: %zu bytes, threads: %d server, %d client, "
+         "%d s\n",
+         conns, size, server_threads, client_threads, seconds);
+  printf("%12s %12s %10s %10s %10s %10s %10s\n", "requests/s", "MB/s",
+         "mean us", "p50 us", "p99 us", "p99.9 us", "max us");
+  printf("%12.0f %12.2f %10.1f %10.1f %10.1f %10.1f %10.1f\n",
+         total.requests / elapsed, total.requests * size / elapsed / 1e6,
+         total.latency.mean() / 1000.0, us(50), us(99), us(99.9),
+         total.latency.max() / 1000.0);
+  return 0;
+}
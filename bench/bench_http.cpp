@@ -0,0 +1,225 @@
+//
+// Created by byao on 2/14/18.
+// Copyright (c) 2018 byao. All rights reserved.
+//
+// Loopback HTTP/1.1 server, every connection sends pipelined GET requests
+// in batches of 'depth' and waits for the responses. The same load is run
+// first against a raw echo server, the baseline of the transport alone.
+//
+// usage: benchhttp [connections] [depth] [body size] [seconds]
+//
+
+#include "../src/address.hpp"
+#include "../src/bytebuffer.hpp"
+#include "../src/http.hpp"
+#include "../src/poller_epoll.hpp"
+#include "../src/tcp_listener.hpp"
+#include "../src/tcp_stream.hpp"
+#include "histogram.hpp"
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std;
+using namespace bsnet;
+
+namespace {
+
+using Clock = chrono::steady_clock;
+
+const string Request = "GET /bench HTTP/1.1\r\n"
+                       "Host: 127.0.0.1\r\n"
+                       "User-Agent: benchhttp\r\n"
+                       "Accept: */*\r\n"
+                       "\r\n";
+
+// calls 'handle' for the polled events, and the ones queued in user space.
+template <typename F>
+void poll_once(Poller &poller, vector<Event> &events, vector<Event> &user,
+               F handle) {
+  Duration timeout(100);
+  int n = poller.poll(events, &timeout);
+  for (int i = 0; i < n; ++i) {
+    if (events[i].token() == Token(0)) {
+      user.clear();
+      poller.user_poll(user);
+      for (auto &evt : user)
+        handle(evt);
+    } else {
+      handle(events[i]);
+    }
+  }
+}
+
+struct Session {
+  TcpStream stream;
+  ByteBuffer in;
+  HttpParser parser;
+  HttpRequest req;
+};
+
+void serve(vector<Session> &sessions, bool http, const string &body,
+           const atomic<bool> &stopped) {
+  auto poller = Poller::new_instance();
+  for (size_t i = 0; i < sessions.size(); ++i)
+    poller->register_evt(sessions[i].stream, Token(i + 1), Ready::readable(),
+                         PollOpt::edge());
+
+  vector<Event> events(256), user;
+  HttpResponse res;
+  while (!stopped.load(memory_order_relaxed)) {
+    poll_once(*poller, events, user, [&](const Event &evt) {
+      Session &s = sessions[evt.token().index() - 1];
+      if (evt.readiness().is_writable())
+        s.stream.flush();
+      if (!evt.readiness().is_readable() || s.stream.read_some(s.in) <= 0)
+        return;
+      if (!http) {
+        s.stream.send(s.in);
+        return;
+      }
+      HttpResult r;
+      while ((r = s.parser.parse(s.in, s.req)) != HttpResult::NeedMore) {
+        if (r == HttpResult::Done) {
+          res.start(200);
+          res.header("Content-Type", "text/plain");
+          res.body(body);
+          res.send(s.stream);
+        } else if (r == HttpResult::Invalid) {
+          s.stream.shutdown(Shutdown::Both);
+          return;
+        }
+      }
+      s.parser.consume(s.in);
+    });
+  }
+}
+
+struct Conn {
+  TcpStream stream;
+  ByteBuffer buf;
+  size_t received;
+  Clock::time_point sent;
+};
+
+struct Result {
+  Histogram latency;
+  uint64_t requests = 0;
+  double elapsed = 0;
+};
+
+void drive(vector<Conn> &conns, const string &batch, size_t expect,
+           Clock::time_point deadline, Result &res) {
+  auto poller = Poller::new_instance();
+  for (size_t i = 0; i < conns.size(); ++i)
+    poller->register_evt(conns[i].stream, Token(i + 1), Ready::readable(),
+                         PollOpt::edge());
+
+  auto ping = [&](Conn &conn) {
+    conn.received = 0;
+    conn.sent = Clock::now();
+    conn.stream.send(batch);
+  };
+  for (auto &conn : conns)
+    ping(conn);
+
+  size_t depth = batch.size() / Request.size();
+  vector<Event> events(256), user;
+  while (Clock::now() < deadline) {
+    poll_once(*poller, events, user, [&](const Event &evt) {
+      Conn &conn = conns[evt.token().index() - 1];
+      if (evt.readiness().is_writable())
+        conn.stream.flush();
+      if (!evt.readiness().is_readable() ||
+          conn.stream.read_some(conn.buf) <= 0)
+        return;
+      conn.received += conn.buf.readable_bytes();
+      conn.buf.clear();
+      if (conn.received >= expect) {
+        auto rtt = chrono::duration_cast<chrono::nanoseconds>(Clock::now() -
+                                                              conn.sent);
+        res.latency.record(static_cast<uint64_t>(rtt.count()));
+        res.requests += depth;
+        ping(conn);
+      }
+    });
+  }
+}
+
+Result run(bool http, int nconns, size_t depth, const string &body,
+           int seconds) {
+  TcpListener listener = TcpListener::bind(AddrV4::from("127.0.0.1:0"),
+                                           static_cast<size_t>(nconns));
+  Addr addr;
+  listener.local_addr(addr);
+
+  vector<Session> sessions;
+  vector<Conn> conns;
+  for (int i = 0; i < nconns; ++i) {
+    TcpStream client = TcpStream::connect(addr);
+    TcpStream server = listener.accept();
+    client.set_nodelay(true);
+    server.set_nodelay(true);
+    sessions.push_back(Session{std::move(server), ByteBuffer(4096),
+                               HttpParser(), HttpRequest()});
+    conns.push_back(
+        Conn{std::move(client), ByteBuffer(4096), 0, Clock::time_point()});
+  }
+
+  string batch;
+  for (size_t i = 0; i < depth; ++i)
+    batch += Request;
+  size_t expect = batch.size();
+  if (http) {
+    HttpResponse res;
+    ByteBuffer out;
+    res.start(200);
+    res.header("Content-Type", "text/plain");
+    res.body(body);
+    res.write_to(out);
+    expect = depth * static_cast<size_t>(out.readable_bytes());
+  }
+
+  atomic<bool> stopped(false);
+  Result res;
+  thread server(serve, std::ref(sessions), http, std::cref(body),
+                std::cref(stopped));
+  auto start = Clock::now();
+  drive(conns, batch, expect, start + chrono::seconds(seconds), res);
+  res.elapsed = chrono::duration<double>(Clock::now() - start).count();
+  stopped.store(true);
+  server.join();
+  return res;
+}
+
+void report(const char *name, Result &res) {
+  auto us = [&](double p) { return res.latency.percentile(p) / 1000.0; };
+  printf("%-6s %12.0f %10.1f %10.1f %10.1f %10.1f\n", name,
+         res.requests / res.elapsed, res.latency.mean() / 1000.0, us(50),
+         us(99), res.latency.max() / 1000.0);
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  int conns = argc > 1 ? atoi(argv[1]) : 16;
+  auto depth = static_cast<size_t>(argc > 2 ? atoi(argv[2]) : 8);
+  auto size = static_cast<size_t>(argc > 3 ? atoi(argv[3]) : 64);
+  int seconds = argc > 4 ? atoi(argv[4]) : 5;
+
+  string body(size, 'x');
+  Result echo = run(false, conns, depth, body, seconds);
+  Result http = run(true, conns, depth, body, seconds);
+
+  printf("connections: %d, depth: %zu, body: %zu bytes, %d s each\n", conns,
+         depth, size, seconds);
+  printf("%-6s %12s %10s %10s %10s %10s\n", "", "requests/s", "batch us",
+         "p50 us", "p99 us", "max us");
+  report("echo", echo);
+  report("http", http);
+  return 0;
+}
@@ -0,0 +1,91 @@
+//
+// Created by byao on 1/30/18.
+// Copyright (c) 2018 byao. All rights reserved.
+//
+// Queue throughput, the blocking queues against the lock-free ones, with
+// the same number of producers and consumers, 2 to 32 threads in total.
+//
+// usage: benchqueue [items per producer]
+//
+
+#include "../src/blocking_queue.hpp"
+#include "../src/lockfree_queue.hpp"
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+
+using namespace std;
+using namespace bsnet;
+
+namespace {
+
+constexpr size_t Capacity = 1024;
+constexpr long Stop = -1;
+
+// consumers return on a stop marker, one per consumer.
+template <typename Queue>
+double run(Queue &q, int producers, int consumers, long items) {
+  atomic<long> checksum(0);
+  vector<thread> threads;
+  auto start = chrono::steady_clock::now();
+  for (int c = 0; c < consumers; ++c) {
+    threads.emplace_back([&] {
+      long sum = 0;
+      long v;
+      for (q.get(v); v != Stop; q.get(v))
+        sum += v;
+      checksum.fetch_add(sum);
+    });
+  }
+  vector<thread> puts;
+  for (int p = 0; p < producers; ++p) {
+    puts.emplace_back([&] {
+      for (long i = 0; i < items; ++i)
+        q.put(i);
+    });
+  }
+  for (auto &th : puts)
+    th.join();
+  for (int c = 0; c < consumers; ++c)
+    q.put(Stop);
+  for (auto &th : threads)
+    th.join();
+  double secs =
+      chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+  if (checksum.load() != producers * (items * (items - 1) / 2)) {
+    fprintf(stderr, "checksum mismatch\n");
+    exit(1);
+  }
+  return producers * items / secs / 1e6;
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  long items = argc > 1 ? atol(argv[1]) : 1000000;
+
+  printf("%-8s %14s %14s %14s %14s\n", "threads", "blocking", "bounded",
+         "spsc", "mpmc");
+  for (int pairs = 1; pairs <= 16; pairs <<= 1) {
+    long n = items / pairs;
+    blocking_queue_t<long> bq;
+    bounded_blocking_queue_t<long> bbq(Capacity);
+    mpmc_queue_t<long> mq(Capacity);
+    double b = run(bq, pairs, pairs, n);
+    double bb = run(bbq, pairs, pairs, n);
+    double m = run(mq, pairs, pairs, n);
+    if (pairs == 1) {
+      spsc_queue_t<long> sq(Capacity);
+      double s = run(sq, 1, 1, n);
+      printf("%-8d %14.2f %14.2f %14.2f %14.2f\n", pairs * 2, b, bb, s, m);
+    } else {
+      printf("%-8d %14.2f %14.2f %14s %14.2f\n", pairs * 2, b, bb, "-", m);
+    }
+  }
+  printf("(million items per second)\n");
+  return 0;
+}
@@ -0,0 +1,148 @@
+//
+// Created by byao on 1/9/18.
+// Copyright (c) 2018 byao. All rights reserved.
+//
+// Loopback udp throughput, with and without segmentation offload.
+//
+// usage: benchudp [payload size] [seconds per mode]
+//
+
+#include "../src/address.hpp"
+#include "../src/bytebuffer.hpp"
+#include "../src/poller_epoll.hpp"
+#include "../src/udp_socket.hpp"
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <poll.h>
+#include <sys/socket.h>
+#include <thread>
+#include <vector>
+
+using namespace std;
+using namespace bsnet;
+
+namespace {
+
+struct Mode {
+  const char *name;
+  bool gso;
+  bool gro;
+};
+
+struct Result {
+  uint64_t sent;
+  uint64_t received;
+  uint64_t send_calls;
+  uint64_t recv_calls;
+  double seconds;
+};
+
+void wait_writable(int fd) {
+  struct pollfd pfd;
+  pfd.fd = fd;
+  pfd.events = POLLOUT;
+  ::poll(&pfd, 1, 100);
+}
+
+Result run(const Mode &mode, uint16_t payload, int seconds) {
+  UdpSocket server = UdpSocket::bind(AddrV4::from("127.0.0.1:0"));
+  UdpSocket client = UdpSocket::bind(AddrV4::from("127.0.0.1:0"));
+  int bufsize = 16 << 20;
+  ::setsockopt(server.fd(), SOL_SOCKET, SO_RCVBUF, &bufsize, sizeof(bufsize));
+  ::setsockopt(client.fd(), SOL_SOCKET, SO_SNDBUF, &bufsize, sizeof(bufsize));
+  if (mode.gro)
+    server.set_gro(true);
+
+  Addr server_addr;
+  server.local_addr(server_addr);
+  client.connect(server_addr);
+
+  Result res{0, 0, 0, 0, 0};
+  atomic<bool> done(false);
+
+  thread receiver([&]() {
+    auto poller = Poller::new_instance();
+    poller->register_evt(server, Token(1), Ready::readable(), PollOpt::edge());
+    vector<Event> events(1);
+    ByteBuffer rbuf(UdpSocket::MaxDatagram);
+    Duration timeout(100);
+    while (true) {
+      int n = poller->poll(events, &timeout);
+      if (n == 0 && done.load())
+        break;
+      while (true) {
+        uint16_t segment = 0;
+        ssize_t len = server.recv(rbuf, &segment);
+        if (len <= 0)
+          break;
+        ++res.recv_calls;
+        res.received += (len + segment - 1) / segment;
+        rbuf.clear();
+      }
+    }
+  });
+
+  ByteBuffer wbuf(UdpSocket::MaxSegments * payload);
+  vector<Byte> chunk(static_cast<size_t>(UdpSocket::MaxSegments) * payload,
+                     'x');
+  auto start = chrono::steady_clock::now();
+  auto deadline = start + chrono::seconds(seconds);
+  while (chrono::steady_clock::now() < deadline) {
+    for (int i = 0; i < 64; ++i) {
+      ssize_t n;
+      if (mode.gso) {
+        wbuf.put(chunk.data(), chunk.size());
+        n = client.send_segments(wbuf, payload);
+      } else {
+        wbuf.put(chunk.data(), payload);
+        n = client.send(wbuf);
+      }
+      if (n == -1) {
+        if (errno != EAGAIN && errno != ENOBUFS) {
+          perror("send");
+          exit(1);
+        }
+        wait_writable(client.fd());
+      } else {
+        ++res.send_calls;
+        res.sent += (n + payload - 1) / payload;
+      }
+      wbuf.clear();
+    }
+  }
+  res.seconds =
+      chrono::duration<double>(chrono::steady_clock::now() - start).count();
+  done.store(true);
+  receiver.join();
+  return res;
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  auto payload = static_cast<uint16_t>(argc > 1 ? atoi(argv[1]) : 1200);
+  int seconds = argc > 2 ? atoi(argv[2]) : 2;
+
+  const Mode modes[] = {
+      {"plain", false, false}, {"gso", true, false}, {"gso+gro", true, true}};
+
+  printf("payload: %u bytes, %d s per mode\n", payload, seconds);
+  printf("%-10s %14s %14s %14s %14s\n", "mode", "sent pkt/s", "recv pkt/s",
+         "send calls/s", "recv calls/s");
+  for (auto &mode : modes) {
+    Result res;
+    try {
+      res = run(mode, payload, seconds);
+    } catch (std::exception &ex) {
+      printf("%-10s unsupported: %s\n", mode.name, ex.what());
+      continue;
+    }
+    printf("%-10s %14.0f %14.0f %14.0f %14.0f\n", mode.name,
+           res.sent / res.seconds, res.received / res.seconds,
+           res.send_calls / res.seconds, res.recv_calls / res.seconds);
+  }
+  return 0;
+}
@@ -0,0 +1,104 @@
+//
+// Created by byao on 2/4/18.
+// Copyright (c) 2018 byao. All rights reserved.
+//
+
+#ifndef BSNET_BENCH_HISTOGRAM_HPP
+#define BSNET_BENCH_HISTOGRAM_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace bsnet {
+
+/**
+ * Latency histogram in the manner of HdrHistogram.
+ *
+ * A value is bucketed by its highest bit, and each bucket is split into
+ * 'SubCount' linear sub-buckets, so a recorded value is reported within
+ * 1 / SubCount of itself over the whole 64 bit range, with a fixed array.
+ * Recording is a few instructions, histograms of several threads are
+ * merged after the run.
+ */
+class Histogram {
+public:
+  static constexpr int SubBits = 7;
+  static constexpr std::uint64_t SubCount = 1 << SubBits;
+
+  Histogram() : _counts((64 - SubBits + 1) * SubCount, 0) {}
+
+  void record(std::uint64_t v) {
+    ++_counts[index(v)];
+    ++_total;
+    _sum += v;
+    if (v < _min)
+      _min = v;
+    if (v > _max)
+      _max = v;
+  }
+
+  void merge(const Histogram &other) {
+    for (std::size_t i = 0; i < _counts.size(); ++i)
+      _counts[i] += other._counts[i];
+    _total += other._total;
+    _sum += other._sum;
+    if (other._min < _min)
+      _min = other._min;
+    if (other._max > _max)
+      _max = other._max;
+  }
+
+  std::uint64_t count() const { return _total; }
+  std::uint64_t min() const { return _total ? _min : 0; }
+  std::uint64_t max() const { return _max; }
+  double mean() const {
+    return _total ? static_cast<double>(_sum) / _total : 0;
+  }
+
+  /**
+   * The value below which 'p' percent of the recorded values fall.
+   */
+  std::uint64_t percentile(double p) const {
+    if (_total == 0)
+      return 0;
+    auto rank = static_cast<std::uint64_t>(p / 100 * _total + 0.5);
+    if (rank == 0)
+      rank = 1;
+    std::uint64_t seen = 0;
+    for (std::size_t i = 0; i < _counts.size(); ++i) {
+      seen += _counts[i];
+      if (seen >= rank)
+        return highest(i) < _max ? highest(i) : _max;
+    }
+    return _max;
+  }
+
+private:
+  static std::size_t index(std::uint64_t v) {
+    if (v < SubCount)
+      return static_cast<std::size_t>(v);
+    int shift = 63 - __builtin_clzll(v) - SubBits;
+    return static_cast<std::size_t>((shift + 1) * SubCount +
+                                    (v >> shift) - SubCount);
+  }
+
+  // the highest value counted in the sub-bucket 'i'.
+  static std::uint64_t highest(std::size_t i) {
+    if (i < SubCount)
+      return i;
+    int shift = static_cast<int>(i / SubCount) - 1;
+    std::uint64_t sub = i % SubCount + SubCount;
+    return ((sub + 1) << shift) - 1;
+  }
+
+  std::vector<std::uint64_t> _counts;
+  std::uint64_t _total = 0;
+  std::uint64_t _sum = 0;
+  std::uint64_t _min = UINT64_MAX;
+  std::uint64_t _max = 0;
+};
+
+} // namespace bsnet
+
+#endif // BSNET_BENCH_HISTOGRAM_HPP
@@ -0,0 +1,66 @@
+//
+// Created by byao on 2/3/18.
+// Copyright (c) 2018 byao. All rights reserved.
+//
+
+#include "../../src/bytebuffer.hpp"
+#include "../../src/ringbuf.hpp"
+#include <benchmark/benchmark.h>
+#include <vector>
+
+using namespace bsnet;
+
+namespace {
+
+void BM_RingbufAppendRetrieve(benchmark::State &state) {
+  auto size = static_cast<int>(state.range(0));
+  ringbuf_t<char> buf(64 * 1024);
+  std::vector<char> in(size, 'x'), out(size);
+  for (auto _ : state) {
+    buf.append(in.data(), size);
+    benchmark::DoNotOptimize(buf.retrieve(out.data(), size));
+  }
+  state.SetBytesProcessed(state.iterations() * size);
+}
+BENCHMARK(BM_RingbufAppendRetrieve)->RangeMultiplier(4)->Range(16, 16 << 10);
+
+// the readable bytes wrap around the end of the storage every few calls.
+void BM_RingbufWrap(benchmark::State &state) {
+  auto size = static_cast<int>(state.range(0));
+  ringbuf_t<char> buf(3 * size + 7);
+  std::vector<char> in(size, 'x'), out(size);
+  buf.append(in.data(), size);
+  for (auto _ : state) {
+    buf.append(in.data(), size);
+    benchmark::DoNotOptimize(buf.retrieve(out.data(), size));
+  }
+  state.SetBytesProcessed(state.iterations() * size);
+}
+BENCHMARK(BM_RingbufWrap)->RangeMultiplier(4)->Range(16, 16 << 10);
+
+void BM_ByteBufferFind(benchmark::State &state) {
+  auto size = static_cast<std::size_t>(state.range(0));
+  ByteBuffer buf(size + 1);
+  std::vector<char> line(size, 'a');
+  line.back() = '\n';
+  buf.put(line.data(), line.size());
+  for (auto _ : state)
+    benchmark::DoNotOptimize(buf.find('\n'));
+  state.SetBytesProcessed(state.iterations() * size);
+}
+BENCHMARK(BM_ByteBufferFind)->RangeMultiplier(8)->Range(64, 64 << 10);
+
+void BM_ByteBufferPutTake(benchmark::State &state) {
+  auto size = static_cast<std::size_t>(state.range(0));
+  ByteBuffer buf(4096);
+  std::vector<char> in(size, 'x'), out(size);
+  for (auto _ : state) {
+    buf.put(in.data(), size);
+    buf.take(out.data(), size);
+    benchmark::ClobberMemory();
+  }
+  state.SetBytesProcessed(state.iterations() * size);
+}
+BENCHMARK(BM_ByteBufferPutTake)->RangeMultiplier(4)->Range(8, 64 << 10);
+
+} // namespace
@@ -0,0 +1,76 @@
+//
+// Created by byao on 2/12/18.
+// Copyright (c) 2018 byao. All rights reserved.
+//
+
+#include "../../src/bytebuffer.hpp"
+#include "../../src/framing.hpp"
+#include <algorithm>
+#include <benchmark/benchmark.h>
+#include <cstdint>
+#include <string>
+
+using namespace bsnet;
+
+namespace {
+
+// encodes a batch of frames and decodes them back, as a server reading
+// pipelined requests does, the payloads are never copied out.
+template <typename Codec> void run(benchmark::State &state, Codec &codec) {
+  auto size = static_cast<std::size_t>(state.range(0));
+  constexpr int Batch = 64;
+  std::string payload(size, 'x');
+  ByteBuffer buf(static_cast<std::size_t>(Batch) * (size + 16));
+  for (auto _ : state) {
+    for (int i = 0; i < Batch; ++i)
+      codec.encode(buf, payload.data(), payload.size());
+    Frame frame;
+    while (codec.decode(buf, frame) == DecodeResult::Frame) {
+      benchmark::DoNotOptimize(frame.payload.iov());
+      buf.discard(static_cast<ByteBuffer::SizeType>(frame.size));
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * Batch);
+  state.SetBytesProcessed(state.iterations() * Batch *
+                          static_cast<std::int64_t>(size));
+}
+
+void BM_LengthCodec(benchmark::State &state) {
+  length_codec_t<std::uint32_t> codec;
+  run(state, codec);
+}
+BENCHMARK(BM_LengthCodec)->RangeMultiplier(8)->Range(8, 8 << 10);
+
+void BM_LineCodec(benchmark::State &state) {
+  LineCodec codec(64 << 10);
+  run(state, codec);
+}
+BENCHMARK(BM_LineCodec)->RangeMultiplier(8)->Range(8, 8 << 10);
+
+void BM_VarintCodec(benchmark::State &state) {
+  VarintCodec codec;
+  run(state, codec);
+}
+BENCHMARK(BM_VarintCodec)->RangeMultiplier(8)->Range(8, 8 << 10);
+
+// a large frame arriving in small reads, decoded after each one.
+void BM_LineCodecPartial(benchmark::State &state) {
+  auto chunk = static_cast<std::size_t>(state.range(0));
+  std::string line(64 << 10, 'x');
+  line += '\n';
+  LineCodec codec(128 << 10, false);
+  ByteBuffer buf(line.size() + 1);
+  for (auto _ : state) {
+    Frame frame;
+    for (std::size_t pos = 0; pos < line.size(); pos += chunk) {
+      buf.put(line.data() + pos, std::min(chunk, line.size() - pos));
+      if (codec.decode(buf, frame) == DecodeResult::Frame)
+        buf.discard(static_cast<ByteBuffer::SizeType>(frame.size));
+    }
+  }
+  state.SetBytesProcessed(state.iterations() *
+                          static_cast<std::int64_t>(line.size()));
+}
+BENCHMARK(BM_LineCodecPartial)->RangeMultiplier(4)->Range(64, 16 << 10);
+
+} // namespace
@@ -0,0 +1,68 @@
+//
+// Created by byao on 2/3/18.
+// Copyright (c) 2018 byao. All rights reserved.
+//
+
+#include "../../src/executor.hpp"
+#include "../../src/poller_epoll.hpp"
+#include "../../src/registration.hpp"
+#include <benchmark/benchmark.h>
+#include <vector>
+
+using namespace bsnet;
+
+namespace {
+
+// set readiness, and get the event back through the readiness queue.
+void BM_ReadinessRoundTrip(benchmark::State &state) {
+  auto poller = Poller::new_instance();
+  Registration reg;
+  SetReadiness sr = reg.new_set_readiness();
+  poller->register_evt(reg, Token(1), Ready::readable(), PollOpt::edge());
+  std::vector<Event> events;
+  for (auto _ : state) {
+    sr.set_readiness(Ready::readable());
+    events.clear();
+    benchmark::DoNotOptimize(poller->user_poll(events));
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_ReadinessRoundTrip);
+
+// queue a batch of events, and drain them in one call.
+void BM_ReadinessQueueEvents(benchmark::State &state) {
+  auto batch = static_cast<int>(state.range(0));
+  auto poller = Poller::new_instance();
+  std::vector<Registration> regs(batch);
+  std::vector<SetReadiness> srs;
+  for (int i = 0; i < batch; ++i) {
+    poller->register_evt(regs[i], Token(i + 1), Ready::readable(),
+                         PollOpt::edge());
+    srs.push_back(regs[i].new_set_readiness());
+  }
+  std::vector<Event> events;
+  for (auto _ : state) {
+    for (auto &sr : srs)
+      sr.set_readiness(Ready::readable());
+    events.clear();
+    benchmark::DoNotOptimize(poller->user_poll(events));
+  }
+  state.SetItemsProcessed(state.iterations() * batch);
+}
+BENCHMARK(BM_ReadinessQueueEvents)->RangeMultiplier(8)->Range(1, 512);
+
+void BM_ExecutorPostRun(benchmark::State &state) {
+  auto poller = Poller::new_instance();
+  Executor ex = poller->executor();
+  std::vector<Event> events;
+  long n = 0;
+  for (auto _ : state) {
+    ex.post([&n] { ++n; });
+    poller->user_poll(events);
+  }
+  benchmark::DoNotOptimize(n);
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_ExecutorPostRun);
+
+} // namespace
@@ -0,0 +1,61 @@
+//
+// Created by byao on 2/3/18.
+// Copyright (c) 2018 byao. All rights reserved.
+//
+
+#include "../../src/blocking_queue.hpp"
+#include "../../src/lockfree_queue.hpp"
+#include <benchmark/benchmark.h>
+#include <memory>
+
+using namespace bsnet;
+
+namespace {
+
+// every thread puts then gets, so the queue never fills up or stays empty,
+// and the cost is the contention on the queue.
+template <typename Queue> void BM_QueueContention(benchmark::State &state) {
+  static std::unique_ptr<Queue> q;
+  if (state.thread_index() == 0)
+    q.reset(new Queue(1024));
+  long v = 0;
+  for (auto _ : state) {
+    q->put(v);
+    q->get(v);
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK_TEMPLATE(BM_QueueContention, bounded_blocking_queue_t<long>)
+    ->ThreadRange(1, 16)
+    ->UseRealTime();
+BENCHMARK_TEMPLATE(BM_QueueContention, mpmc_queue_t<long>)
+    ->ThreadRange(1, 16)
+    ->UseRealTime();
+
+void BM_BoundedQueueGetAll(benchmark::State &state) {
+  auto batch = static_cast<int>(state.range(0));
+  bounded_blocking_queue_t<long> q(batch);
+  std::vector<long> res;
+  res.reserve(batch);
+  for (auto _ : state) {
+    for (int i = 0; i < batch; ++i)
+      q.put(i);
+    res.clear();
+    benchmark::DoNotOptimize(q.get_all(res));
+  }
+  state.SetItemsProcessed(state.iterations() * batch);
+}
+BENCHMARK(BM_BoundedQueueGetAll)->RangeMultiplier(8)->Range(1, 4096);
+
+void BM_SpscQueue(benchmark::State &state) {
+  spsc_queue_t<long> q(1024);
+  long v = 0;
+  for (auto _ : state) {
+    q.try_put(v);
+    q.try_get(v);
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_SpscQueue);
+
+} // namespace
@@ -0,0 +1,56 @@
+//
+// Created by byao on 2/3/18.
+// Copyright (c) 2018 byao. All rights reserved.
+//
+
+#include "../../src/slab.hpp"
+#include "../../src/token.hpp"
+#include <benchmark/benchmark.h>
+#include <algorithm>
+#include <random>
+#include <vector>
+
+using namespace bsnet;
+
+namespace {
+
+constexpr std::uint32_t PoolSize = 64 * 1024;
+
+// allocate and free a token in a pool filled at range(0) percent, the
+// free slots scattered at random.
+void BM_TokenAllocFree(benchmark::State &state) {
+  TokenPool pool(PoolSize, PoolSize);
+  std::vector<Token> tokens;
+  for (std::uint32_t i = 0; i < PoolSize; ++i)
+    tokens.push_back(pool.alloc_token());
+  std::mt19937 gen(42);
+  std::shuffle(tokens.begin(), tokens.end(), gen);
+  auto free = PoolSize - PoolSize * state.range(0) / 100;
+  for (std::uint32_t i = 0; i < free; ++i)
+    pool.free_token(tokens[i]);
+
+  for (auto _ : state) {
+    Token tok = pool.alloc_token();
+    benchmark::DoNotOptimize(tok);
+    pool.free_token(tok);
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_TokenAllocFree)->Arg(0)->Arg(50)->Arg(90)->Arg(99);
+
+void BM_SlabLookup(benchmark::State &state) {
+  Slab<long> slab;
+  std::vector<Token> tokens;
+  for (int i = 0; i < state.range(0); ++i)
+    tokens.push_back(slab.insert(i));
+  std::size_t i = 0;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(slab.get(tokens[i]));
+    if (++i == tokens.size())
+      i = 0;
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_SlabLookup)->RangeMultiplier(16)->Range(16, 64 << 10);
+
+} // namespace
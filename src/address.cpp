@@ -6,6 +6,7 @@
 #include "neterr.hpp"
 #include "utility.hpp"
 #include <arpa/inet.h>
+#include <cstddef>
 #include <cstdint>
 #include <cstring>
 
@@ -13,7 +14,7 @@ using namespace std;
 
 namespace bsnet {
 
-invalid_address::invalid_address(const std::string &s) : runtime_error(s) {}
+invalid_address::invalid_address(const std::string &s) : errno_error(0, s) {}
 
 /*
  * Constructor:
@@ -100,6 +101,58 @@ AddrV6 AddrV6::from(const std::string &addr) {
   return ad;
 }
 
+AddrUnix::AddrUnix() : _len(sizeof(sa_family_t)) {
+  memset(&_addr, 0, sizeof(_addr));
+  _addr.sun_family = AF_UNIX;
+}
+
+/*
+ * Constructor:
+ *    a filesystem path, throws 'invalid_address' if the path is too long.
+ */
+AddrUnix::AddrUnix(const char *path) {
+  memset(&_addr, 0, sizeof(_addr));
+  _addr.sun_family = AF_UNIX;
+  size_t len = strlen(path);
+  if (len >= sizeof(_addr.sun_path))
+    throw invalid_address("unix socket path too long");
+  memcpy(_addr.sun_path, path, len);
+  _len = static_cast<socklen_t>(offsetof(struct sockaddr_un, sun_path) + len +
+                                1);
+}
+
+AddrUnix AddrUnix::abstract(const std::string &name) {
+  AddrUnix ad;
+  if (name.size() + 1 > sizeof(ad._addr.sun_path))
+    throw invalid_address("unix socket name too long");
+  // abstract names start with '\0', and are not null terminated.
+  memcpy(ad._addr.sun_path + 1, name.data(), name.size());
+  ad._len = static_cast<socklen_t>(offsetof(struct sockaddr_un, sun_path) +
+                                   name.size() + 1);
+  return ad;
+}
+
+AddrUnix AddrUnix::from(const std::string &addr) {
+  if (addr.empty())
+    throw invalid_address("empty unix socket address");
+  if (addr[0] == '@')
+    return abstract(addr.substr(1));
+  return AddrUnix(addr.c_str());
+}
+
+bool AddrUnix::is_abstract() const {
+  return !is_unnamed() && _addr.sun_path[0] == '\0';
+}
+
+std::string AddrUnix::path() const {
+  if (is_unnamed())
+    return std::string();
+  size_t len = _len - offsetof(struct sockaddr_un, sun_path);
+  if (is_abstract())
+    return std::string(_addr.sun_path + 1, len - 1);
+  return std::string(_addr.sun_path, strnlen(_addr.sun_path, len));
+}
+
 /**
  * Addr
  */
@@ -127,6 +180,9 @@ Addr::Addr(const AddrV4 &other) : _v(Version::V4), _addr(new _Addr) {
 Addr::Addr(const AddrV6 &other) : _v(Version::V6), _addr(new _Addr) {
   memcpy(&(_addr->v6._addr), &other._addr, sizeof(struct sockaddr_in6));
 }
+Addr::Addr(const AddrUnix &other) : _v(Version::Unix), _addr(new _Addr) {
+  memcpy(&(_addr->un), &other, sizeof(AddrUnix));
+}
 Addr &Addr::operator=(const AddrV4 &other) {
   _v = Version::V4;
   memcpy(&(_addr->v4._addr), &other._addr, sizeof(struct sockaddr_in));
@@ -138,6 +194,12 @@ Addr &Addr::operator=(const AddrV6 &other) {
   return *this;
 }
 
+Addr &Addr::operator=(const AddrUnix &other) {
+  _v = Version::Unix;
+  memcpy(&(_addr->un), &other, sizeof(AddrUnix));
+  return *this;
+}
+
 void Addr::swap(Addr &other) noexcept {
   using std::swap;
   _v = other._v;
@@ -159,6 +221,12 @@ const AddrV6 *Addr::as_ipv6() const {
   return nullptr;
 }
 
+const AddrUnix *Addr::as_unix() const {
+  if (is_unix())
+    return &_addr->un;
+  return nullptr;
+}
+
 const struct sockaddr *Addr::get_sockaddr() const {
   return pick([&](auto &_) { return _.get_sockaddr(); });
 }
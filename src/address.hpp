@@ -13,11 +13,13 @@
 #include <stdexcept>
 #include <string>
 #include <sys/socket.h>
+#include <sys/un.h>
 
 namespace bsnet {
 
 class AddrV4;
 class AddrV6;
+class AddrUnix;
 class Addr;
 
 class AddrV4 final {
@@ -67,10 +69,61 @@ private:
   struct sockaddr_in6 _addr;
 };
 
+/**
+ * Unix domain socket address, either a filesystem path, or a name in the
+ * linux abstract namespace (not bound to the filesystem).
+ */
+class AddrUnix final {
+public:
+  friend class Addr;
+  friend class UnixStream;
+  friend class UnixListener;
+  friend class UnixDatagram;
+
+  // an unnamed address.
+  AddrUnix();
+  explicit AddrUnix(const char *path);
+  explicit AddrUnix(const std::string &path) : AddrUnix(path.c_str()) {}
+
+  constexpr bool is_ipv4() const { return false; }
+  constexpr bool is_ipv6() const { return false; }
+  std::size_t size() const { return _len; }
+  const struct sockaddr *get_sockaddr() const {
+    return reinterpret_cast<const struct sockaddr *>(&_addr);
+  }
+  struct sockaddr *get_sockaddr() {
+    return reinterpret_cast<struct sockaddr *>(&_addr);
+  }
+
+  bool is_abstract() const;
+  bool is_unnamed() const { return _len <= sizeof(sa_family_t); }
+
+  /**
+   * the path, or the name without the leading '\0' for an abstract address.
+   */
+  std::string path() const;
+
+  /**
+   * Create an address in the abstract namespace.
+   */
+  static AddrUnix abstract(const std::string &name);
+
+  /**
+   * Create AddrUnix from string, ex. "/tmp/bsnet.sock", or "@bsnet" for an
+   * abstract address.
+   */
+  static AddrUnix from(const std::string &addr);
+
+private:
+  struct sockaddr_un _addr;
+  socklen_t _len;
+};
+
 class Addr {
 public:
   friend class TcpStream;
   friend class TcpListener;
+  friend class UdpSocket;
 
   Addr();
   ~Addr();
@@ -81,33 +134,44 @@ public:
 
   Addr(const AddrV4 &);
   Addr(const AddrV6 &);
+  Addr(const AddrUnix &);
   Addr &operator=(const AddrV4 &);
   Addr &operator=(const AddrV6 &);
+  Addr &operator=(const AddrUnix &);
 
   void swap(Addr &other) noexcept;
 
   bool is_ipv4() const { return _v == Version::V4; }
   bool is_ipv6() const { return _v == Version::V6; }
+  bool is_unix() const { return _v == Version::Unix; }
   std::size_t size() const;
 
   const AddrV4 *as_ipv4() const;
   const AddrV6 *as_ipv6() const;
+  const AddrUnix *as_unix() const;
   const struct sockaddr *get_sockaddr() const;
   struct sockaddr *get_sockaddr();
 
   enum struct Version : sa_family_t {
     V4 = AF_INET,
     V6 = AF_INET6,
+    Unix = AF_UNIX,
     UnSpec = AF_UNSPEC,
   };
 
-  typedef union {
+  union _Addr {
+    // an unnamed unix address, until one of the members is copied in.
+    _Addr() : un() {}
+
     AddrV4 v4;
     AddrV6 v6;
-  } _Addr;
+    AddrUnix un;
+  };
 
 private:
   template <typename Func> auto pick(Func &&f) const {
+    if (is_unix())
+      return f(_addr->un);
     return is_ipv4() ? f(_addr->v4) : f(_addr->v6);
   }
 
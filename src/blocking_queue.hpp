@@ -11,6 +11,7 @@
 #include <chrono>
 #include <condition_variable>
 #include <deque>
+#include <iterator>
 #include <mutex>
 #include <utility>
 #include <vector>
@@ -19,51 +20,97 @@ namespace bsnet {
 
 /**
  * A blocking queue with unlimited size.
+ *
+ * After 'close', puts fail and gets fail once the queue is drained, waiting
+ * getters are woken up.
  * @tparam T
  */
 template <typename T> class blocking_queue_t : public NonCopyable {
 public:
-  void get(T &t) {
+  /**
+   * Returns false if the queue is closed and empty.
+   */
+  bool get(T &t) {
     std::unique_lock<std::mutex> lk(_mtx);
+    _no_empty.wait(lk, [this] { return !_queue.empty() || _closed; });
+    return pop(t);
+  }
 
-    while (_queue.empty())
-      _no_empty.wait(lk);
-
-    t = std::move(_queue.front());
-    _queue.pop_front();
+  bool try_get(T &t) {
+    std::unique_lock<std::mutex> lk(_mtx);
+    return pop(t);
   }
 
-  void get_all(std::vector<T> &res) {
+  /**
+   * Returns false on timeout, or if the queue is closed and empty.
+   */
+  template <typename Rep, typename Period>
+  bool get_for(T &t, const std::chrono::duration<Rep, Period> &timeout) {
     std::unique_lock<std::mutex> lk(_mtx);
+    _no_empty.wait_for(lk, timeout,
+                       [this] { return !_queue.empty() || _closed; });
+    return pop(t);
+  }
 
-    while (_queue.empty())
-      _no_empty.wait(lk);
+  /**
+   * Wait until the queue is not empty, and move all the elements to 'res',
+   * returns the number of elements moved.
+   */
+  std::size_t get_all(std::vector<T> &res) {
+    std::deque<T> tmp;
+    {
+      std::unique_lock<std::mutex> lk(_mtx);
+      _no_empty.wait(lk, [this] { return !_queue.empty() || _closed; });
+      tmp.swap(_queue);
+    }
+    return move_all(tmp, res);
+  }
 
-    std::copy(_queue.begin(), _queue.end(), std::back_inserter(res));
-    _queue.clear();
+  std::size_t try_get_all(std::vector<T> &res) {
+    std::deque<T> tmp;
+    {
+      std::unique_lock<std::mutex> lk(_mtx);
+      tmp.swap(_queue);
+    }
+    return move_all(tmp, res);
   }
 
-  void put(const T &t) {
+  /**
+   * Returns false if the queue is closed.
+   */
+  bool put(const T &t) { return emplace(t); }
+  bool put(T &&t) { return emplace(std::move(t)); }
+
+  template <typename... Args> bool emplace(Args &&... args) {
     std::unique_lock<std::mutex> lk(_mtx);
-    _queue.push_back(t);
+    if (_closed)
+      return false;
+    _queue.emplace_back(std::forward<Args>(args)...);
+    lk.unlock();
     _no_empty.notify_one();
+    return true;
   }
-  void put(T &&t) {
+
+  bool put_all(std::vector<T> &vec) {
     std::unique_lock<std::mutex> lk(_mtx);
-    _queue.push_back(std::forward<T>(t));
-    _no_empty.notify_one();
+    if (_closed)
+      return false;
+    std::copy(vec.begin(), vec.end(), std::back_inserter(_queue));
+    lk.unlock();
+    _no_empty.notify_all();
+    return true;
   }
 
-  template <typename... Args> void emplace(Args &&... args) {
+  void close() {
     std::unique_lock<std::mutex> lk(_mtx);
-    _queue.emplace_back(std::forward<Args>(args)...);
-    _no_empty.notify_one();
+    _closed = true;
+    lk.unlock();
+    _no_empty.notify_all();
   }
 
-  void put_all(std::vector<T> &vec) {
+  bool closed() const {
     std::unique_lock<std::mutex> lk(_mtx);
-    std::copy(vec.begin(), vec.end(), std::back_inserter(_queue));
-    _no_empty.notify_one();
+    return _closed;
   }
 
   bool empty() const {
@@ -77,80 +124,156 @@ public:
   }
 
 private:
-  std::mutex _mtx;
+  bool pop(T &t) {
+    if (_queue.empty())
+      return false;
+    t = std::move(_queue.front());
+    _queue.pop_front();
+    return true;
+  }
+
+  static std::size_t move_all(std::deque<T> &from, std::vector<T> &to) {
+    to.insert(to.end(), std::make_move_iterator(from.begin()),
+              std::make_move_iterator(from.end()));
+    return from.size();
+  }
+
+  mutable std::mutex _mtx;
   std::condition_variable _no_empty;
   std::deque<T> _queue;
+  bool _closed = false;
 };
 
 /**
  * A blocking queue with fixed size.
+ *
+ * 'try_*' never block, '*_for' wait up to a timeout, so producers can shed
+ * load instead of hanging when the consumer stalls. After 'close', puts
+ * fail and gets fail once the queue is drained, all the waiters are woken
+ * up.
  * @tparam T
  */
 template <typename T> class bounded_blocking_queue_t : NonCopyable {
 public:
   explicit bounded_blocking_queue_t(std::size_t s) : _max_size(s) {}
 
-  void get(T &t) {
+  /**
+   * Returns false if the queue is closed and empty.
+   */
+  bool get(T &t) {
     std::unique_lock<std::mutex> lk(_mtx);
+    _no_empty.wait(lk, [this] { return !_queue.empty() || _closed; });
+    return pop(lk, t);
+  }
 
-    while (_queue.empty())
-      _no_empty.wait(lk);
-
-    t = std::move(_queue.front());
-    _queue.pop_front();
-    _no_full.notify_one();
+  bool try_get(T &t) {
+    std::unique_lock<std::mutex> lk(_mtx);
+    return pop(lk, t);
   }
 
-  std::size_t get_all(std::vector<T> &res) {
+  /**
+   * Returns false on timeout, or if the queue is closed and empty.
+   */
+  template <typename Rep, typename Period>
+  bool get_for(T &t, const std::chrono::duration<Rep, Period> &timeout) {
     std::unique_lock<std::mutex> lk(_mtx);
+    _no_empty.wait_for(lk, timeout,
+                       [this] { return !_queue.empty() || _closed; });
+    return pop(lk, t);
+  }
 
-    while (_queue.empty())
-      _no_empty.wait(lk);
+  /**
+   * Wait until the queue is not empty, and move all the elements to 'res',
+   * returns the number of elements moved.
+   */
+  std::size_t get_all(std::vector<T> &res) {
+    std::deque<T> tmp;
+    {
+      std::unique_lock<std::mutex> lk(_mtx);
+      _no_empty.wait(lk, [this] { return !_queue.empty() || _closed; });
+      tmp.swap(_queue);
+    }
+    _no_full.notify_all();
+    return move_all(tmp, res);
+  }
 
-    std::size_t n = _queue.end() - _queue.begin();
-    std::copy(_queue.begin(), _queue.end(), std::back_inserter(res));
-    _queue.clear();
-    _no_full.notify_one();
-    return n;
+  std::size_t try_get_all(std::vector<T> &res) {
+    std::deque<T> tmp;
+    {
+      std::unique_lock<std::mutex> lk(_mtx);
+      tmp.swap(_queue);
+    }
+    if (!tmp.empty())
+      _no_full.notify_all();
+    return move_all(tmp, res);
   }
 
-  void put(const T &t) {
-    std::unique_lock<std::mutex> lk(_mtx);
-    while (_queue.size() >= _max_size)
-      _no_full.wait(lk);
+  /**
+   * Returns false if the queue is closed.
+   */
+  bool put(const T &t) { return emplace(t); }
+  bool put(T &&t) { return emplace(std::move(t)); }
 
-    _queue.push_back(t);
-    _no_empty.notify_one();
+  template <typename... Args> bool emplace(Args &&... args) {
+    std::unique_lock<std::mutex> lk(_mtx);
+    _no_full.wait(lk, [this] { return _queue.size() < _max_size || _closed; });
+    return push(lk, std::forward<Args>(args)...);
   }
 
-  void put(T &&t) {
+  /**
+   * Returns false if the queue is full or closed.
+   */
+  bool try_put(const T &t) { return try_emplace(t); }
+  bool try_put(T &&t) { return try_emplace(std::move(t)); }
+
+  template <typename... Args> bool try_emplace(Args &&... args) {
     std::unique_lock<std::mutex> lk(_mtx);
-    while (_queue.size() >= _max_size)
-      _no_full.wait(lk);
+    if (_queue.size() >= _max_size)
+      return false;
+    return push(lk, std::forward<Args>(args)...);
+  }
 
-    _queue.push_back(std::forward<T>(t));
-    _no_empty.notify_one();
+  /**
+   * Returns false on timeout, or if the queue is closed.
+   */
+  template <typename Rep, typename Period>
+  bool put_for(T t, const std::chrono::duration<Rep, Period> &timeout) {
+    std::unique_lock<std::mutex> lk(_mtx);
+    _no_full.wait_for(lk, timeout, [this] {
+      return _queue.size() < _max_size || _closed;
+    });
+    if (_queue.size() >= _max_size)
+      return false;
+    return push(lk, std::move(t));
   }
 
+  /**
+   * Wait until the queue is not full, put as many elements as fit,
+   * returns the number of elements left.
+   */
   std::size_t put_all(const std::vector<T> &vec) {
     std::unique_lock<std::mutex> lk(_mtx);
-
-    while (_queue.size() >= _max_size)
-      _no_full.wait(lk);
-    std::size_t n = _max_size - _queue.size();
+    _no_full.wait(lk, [this] { return _queue.size() < _max_size || _closed; });
+    if (_closed)
+      return vec.size();
+    std::size_t n = std::min(_max_size - _queue.size(), vec.size());
     std::copy_n(vec.begin(), n, std::back_inserter(_queue));
-    _no_empty.notify_one();
-
+    lk.unlock();
+    _no_empty.notify_all();
     return vec.size() - n;
   }
 
-  template <typename... Args> void emplace(Args &&... args) {
+  void close() {
     std::unique_lock<std::mutex> lk(_mtx);
-    while (_queue.size() >= _max_size)
-      _no_full.wait(lk);
+    _closed = true;
+    lk.unlock();
+    _no_empty.notify_all();
+    _no_full.notify_all();
+  }
 
-    _queue.emplace_back(std::forward<Args>(args)...);
-    _no_empty.notify_one();
+  bool closed() const {
+    std::unique_lock<std::mutex> lk(_mtx);
+    return _closed;
   }
 
   bool empty() const {
@@ -168,11 +291,38 @@ public:
   }
 
 private:
+  bool pop(std::unique_lock<std::mutex> &lk, T &t) {
+    if (_queue.empty())
+      return false;
+    t = std::move(_queue.front());
+    _queue.pop_front();
+    lk.unlock();
+    _no_full.notify_one();
+    return true;
+  }
+
+  template <typename... Args>
+  bool push(std::unique_lock<std::mutex> &lk, Args &&... args) {
+    if (_closed)
+      return false;
+    _queue.emplace_back(std::forward<Args>(args)...);
+    lk.unlock();
+    _no_empty.notify_one();
+    return true;
+  }
+
+  static std::size_t move_all(std::deque<T> &from, std::vector<T> &to) {
+    to.insert(to.end(), std::make_move_iterator(from.begin()),
+              std::make_move_iterator(from.end()));
+    return from.size();
+  }
+
   mutable std::mutex _mtx;
   std::condition_variable _no_empty;
   std::condition_variable _no_full;
   std::deque<T> _queue;
   std::size_t _max_size;
+  bool _closed = false;
 };
 }
 
@@ -4,8 +4,14 @@
 //
 
 #include "bytebuffer.hpp"
+#include "logger.hpp"
+#include "probes.hpp"
 #include "ringbuf.hpp"
+#include <algorithm>
+#include <cerrno>
 #include <cstdint>
+#include <cstring>
+#include <limits>
 #include <string>
 
 using std::size_t;
@@ -29,6 +35,63 @@ void ByteBuffer::put(const void *data, size_t s) {
   _buf.append(data, static_cast<SizeType>(s));
 }
 
+SizeType ByteBuffer::find(Byte b, SizeType from) const {
+  struct iovec vio[2];
+  int len = readable_iovec(&vio[0]);
+  SizeType base = 0;
+  for (int i = 0; i < len; ++i) {
+    auto size = static_cast<SizeType>(vio[i].iov_len);
+    if (from < base + size) {
+      auto *start = static_cast<const Byte *>(vio[i].iov_base);
+      const Byte *p = start + (from - base);
+      auto *hit = static_cast<const Byte *>(
+          ::memchr(p, b, static_cast<size_t>(start + size - p)));
+      if (hit)
+        return base + static_cast<SizeType>(hit - start);
+      from = base + size;
+    }
+    base += size;
+  }
+  return -1;
+}
+
+void ByteBuffer::peek(void *data, size_t s, size_t offset) const {
+  assert(offset + s <= static_cast<size_t>(_buf.readable_size()));
+  BufferView v = view(offset, s);
+  v.copy_to(data);
+}
+
+BufferView ByteBuffer::view(size_t offset, size_t len) const {
+  assert(offset + len <= static_cast<size_t>(_buf.readable_size()));
+  BufferView v;
+  v._size = len;
+  struct iovec vio[2];
+  int n = readable_iovec(&vio[0]);
+  for (int i = 0; i < n && len > 0; ++i) {
+    if (offset >= vio[i].iov_len) {
+      offset -= vio[i].iov_len;
+      continue;
+    }
+    size_t part = std::min(len, vio[i].iov_len - offset);
+    v._vec[v._count].iov_base = static_cast<Byte *>(vio[i].iov_base) + offset;
+    v._vec[v._count].iov_len = part;
+    ++v._count;
+    len -= part;
+    offset = 0;
+  }
+  return v;
+}
+
+const Byte *ByteBuffer::linearize() {
+  if (_buf._end < _buf._begin) {
+    std::rotate(_buf._data, _buf._data + _buf._begin,
+                _buf._data + _buf._capacity);
+    _buf._end = _buf.readable_size();
+    _buf._begin = 0;
+  }
+  return _buf._data + _buf._begin;
+}
+
 string ByteBuffer::take_string() {
   std::string s;
   SizeType rsize = _buf.readable_size();
@@ -51,40 +114,82 @@ ByteBuffer ByteBuffer::split_at(size_t index) {
   return buffer;
 }
 
+int ByteBuffer::readable_iovec(struct iovec *vec) const {
+  if (_buf.readable_size() == 0)
+    return 0;
+  if (_buf._end < _buf._begin) {
+    vec[0].iov_base = _buf._data + _buf._begin;
+    vec[0].iov_len = _buf._capacity - _buf._begin;
+    vec[1].iov_base = _buf._data;
+    vec[1].iov_len = _buf._end;
+    return 2;
+  }
+  vec[0].iov_base = _buf._data + _buf._begin;
+  vec[0].iov_len = _buf._end - _buf._begin;
+  return 1;
+}
+
+int ByteBuffer::writable_iovec(struct iovec *vec) {
+  if (_buf._end < _buf._begin) {
+    vec[0].iov_base = _buf._data + _buf._end;
+    vec[0].iov_len = _buf._begin - _buf._end - 1;
+    return 1;
+  }
+  // the slot right before '_begin' always stays empty, so that a full buffer
+  // can be told from an empty one.
+  int len = 1;
+  vec[0].iov_base = _buf._data + _buf._end;
+  vec[0].iov_len = _buf._capacity - _buf._end - (_buf._begin == 0 ? 1 : 0);
+  if (_buf._begin > 1) {
+    vec[1].iov_base = _buf._data;
+    vec[1].iov_len = _buf._begin - 1;
+    len = 2;
+  }
+  return len;
+}
+
 SizeType ByteBuffer::read_from(int fd) {
+  return read_from(fd, std::numeric_limits<SizeType>::max());
+}
+
+SizeType ByteBuffer::read_from(int fd, SizeType max) {
   if (_buf.writable_size() == 0)
     _buf.expand();
 
   static constexpr SizeType BufSize = 65536 >> 1;
   Byte extrabuf[BufSize];
   struct iovec vio[3];
-  int len = 2;
-  if (_buf._end < _buf._begin) {
-    vio[0].iov_base = _buf._data + _buf._end;
-    vio[0].iov_len = _buf._begin - _buf._end - 1;
-    vio[1].iov_base = &extrabuf[0];
-    vio[1].iov_len = BufSize;
-  } else {
-    vio[0].iov_base = _buf._data + _buf._end;
-    vio[0].iov_len = _buf._capacity - _buf._end;
-    if (_buf._begin > 1) {
-      vio[1].iov_base = _buf._data;
-      vio[1].iov_len = _buf._begin - 1;
-      len = 3;
+  int len = writable_iovec(&vio[0]);
+  // only read 'max' bytes, the extra buffer takes what does not fit.
+  auto left = static_cast<size_t>(max);
+  for (int i = 0; i < len; ++i) {
+    if (vio[i].iov_len >= left) {
+      vio[i].iov_len = left;
+      len = i + 1;
+      left = 0;
+      break;
     }
-    vio[len - 1].iov_base = &extrabuf[0];
-    vio[len - 1].iov_len = BufSize;
+    left -= vio[i].iov_len;
   }
+  if (left > 0) {
+    vio[len].iov_base = &extrabuf[0];
+    vio[len].iov_len = std::min(left, static_cast<size_t>(BufSize));
+    ++len;
+  }
+
   int n = ::readv(fd, &vio[0], len);
+  BSNET_PROBE2(read, fd, n);
   if (n == -1) {
-    // TODO: replace perror with a logger
-    perror("readv in \"ByteBuffer::read_from\"");
+    // EAGAIN is routine on a nonblocking socket.
+    if (errno != EAGAIN && errno != EWOULDBLOCK)
+      BSNET_PLOG(LogLevel::Warn, "readv in ByteBuffer::read_from, fd %lld",
+                 fd);
     return n;
   }
   int rest = n - _buf.writable_size();
   if (rest > 0) {
     _buf.advance_write(_buf.writable_size());
-    _buf.append(&extrabuf[0], rest);
+    put(&extrabuf[0], rest);
   } else {
     _buf.advance_write(n);
   }
@@ -92,26 +197,68 @@ SizeType ByteBuffer::read_from(int fd) {
 }
 
 SizeType ByteBuffer::write_to(int fd) {
-  if (_buf.readable_size() == 0)
-    return 0;
   struct iovec vio[2];
-  int len;
-  if (_buf._end < _buf._begin) {
-    vio[0].iov_base = _buf._data + _buf._begin;
-    vio[0].iov_len = _buf._capacity - _buf._begin;
-    vio[1].iov_base = _buf._data;
-    vio[1].iov_len = _buf._end;
-    len = 2;
-  } else {
-    vio[0].iov_base = _buf._data + _buf._begin;
-    vio[0].iov_len = _buf._end - _buf._begin;
-    len = 1;
-  }
+  int len = readable_iovec(&vio[0]);
+  if (len == 0)
+    return 0;
   int n = ::writev(fd, &vio[0], len);
+  BSNET_PROBE2(write, fd, n);
   if (n != -1)
     _buf.advance_read(n);
-  else // TODO: replace perror with a logger
-    perror("writev in \"ByteBuffer::write_to\"");
+  else if (errno != EAGAIN && errno != EWOULDBLOCK)
+    BSNET_PLOG(LogLevel::Warn, "writev in ByteBuffer::write_to, fd %lld", fd);
+  return n;
+}
+
+SizeType ByteBuffer::recv_msg(int fd, struct msghdr *msg, int flags) {
+  // a datagram can be as large as an ip packet.
+  static constexpr SizeType BufSize = 65536;
+  Byte extrabuf[BufSize];
+  struct iovec vio[3];
+  int len = writable_iovec(&vio[0]);
+  vio[len].iov_base = &extrabuf[0];
+  vio[len].iov_len = BufSize;
+  ++len;
+  msg->msg_iov = &vio[0];
+  msg->msg_iovlen = static_cast<size_t>(len);
+
+  auto n = static_cast<int>(::recvmsg(fd, msg, flags));
+  msg->msg_iov = nullptr;
+  msg->msg_iovlen = 0;
+  if (n == -1)
+    return n;
+  int rest = n - _buf.writable_size();
+  if (rest > 0) {
+    _buf.advance_write(_buf.writable_size());
+    put(&extrabuf[0], rest);
+  } else {
+    _buf.advance_write(n);
+  }
+  return n;
+}
+
+SizeType ByteBuffer::send_msg(int fd, struct msghdr *msg, size_t len,
+                              int flags) {
+  struct iovec vio[2];
+  int iovlen = readable_iovec(&vio[0]);
+  // only send the first 'len' bytes.
+  size_t total = 0;
+  for (int i = 0; i < iovlen; ++i) {
+    if (total + vio[i].iov_len >= len) {
+      vio[i].iov_len = len - total;
+      iovlen = i + 1;
+      break;
+    }
+    total += vio[i].iov_len;
+  }
+  msg->msg_iov = &vio[0];
+  msg->msg_iovlen = static_cast<size_t>(iovlen);
+
+  auto n = static_cast<int>(::sendmsg(fd, msg, flags));
+  msg->msg_iov = nullptr;
+  msg->msg_iovlen = 0;
+  if (n > 0)
+    _buf.advance_read(n);
   return n;
 }
 
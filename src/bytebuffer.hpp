@@ -8,11 +8,95 @@
 
 #include "ringbuf.hpp"
 #include <cstdint>
+#include <cstring>
+#include <string>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <type_traits>
 
 namespace bsnet {
 
 using Byte = std::uint8_t;
 
+enum class Endian { Big, Little };
+
+namespace detail {
+
+inline std::uint8_t bswap(std::uint8_t v) { return v; }
+inline std::uint16_t bswap(std::uint16_t v) { return __builtin_bswap16(v); }
+inline std::uint32_t bswap(std::uint32_t v) { return __builtin_bswap32(v); }
+inline std::uint64_t bswap(std::uint64_t v) { return __builtin_bswap64(v); }
+
+template <std::size_t N> struct uint_of;
+template <> struct uint_of<1> { using type = std::uint8_t; };
+template <> struct uint_of<2> { using type = std::uint16_t; };
+template <> struct uint_of<4> { using type = std::uint32_t; };
+template <> struct uint_of<8> { using type = std::uint64_t; };
+
+/**
+ * Convert between the host byte order and 'e', both ways.
+ */
+template <typename T> T to_order(T v, Endian e) {
+  constexpr bool big_host = __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__;
+  if ((e == Endian::Big) == big_host)
+    return v;
+  typename uint_of<sizeof(T)>::type u;
+  std::memcpy(&u, &v, sizeof(v));
+  u = bswap(u);
+  std::memcpy(&v, &u, sizeof(v));
+  return v;
+}
+
+} // namespace detail
+
+/**
+ * A view of readable bytes of a ByteBuffer, in one or two regions as the
+ * buffer is a ring. It's valid until the buffer is modified.
+ */
+class BufferView {
+public:
+  BufferView() : _count(0), _size(0) {}
+
+  std::size_t size() const { return _size; }
+  bool empty() const { return _size == 0; }
+  bool contiguous() const { return _count <= 1; }
+
+  /**
+   * The regions, to gather them in a 'writev' without copying.
+   */
+  const struct iovec *iov() const { return _vec; }
+  int iovcnt() const { return _count; }
+
+  Byte operator[](std::size_t i) const {
+    auto first = _count ? _vec[0].iov_len : 0;
+    return i < first ? static_cast<const Byte *>(_vec[0].iov_base)[i]
+                     : static_cast<const Byte *>(_vec[1].iov_base)[i - first];
+  }
+
+  void copy_to(void *dst) const {
+    auto *p = static_cast<Byte *>(dst);
+    for (int i = 0; i < _count; ++i) {
+      std::memcpy(p, _vec[i].iov_base, _vec[i].iov_len);
+      p += _vec[i].iov_len;
+    }
+  }
+
+  std::string to_string() const {
+    std::string s;
+    s.reserve(_size);
+    for (int i = 0; i < _count; ++i)
+      s.append(static_cast<const char *>(_vec[i].iov_base), _vec[i].iov_len);
+    return s;
+  }
+
+private:
+  friend class ByteBuffer;
+
+  struct iovec _vec[2];
+  int _count;
+  std::size_t _size;
+};
+
 class ByteBuffer {
 public:
   using InnerBuf = ringbuf_t<Byte>;
@@ -26,6 +110,8 @@ public:
   ByteBuffer &operator=(const ByteBuffer &) = default;
   ByteBuffer(ByteBuffer &&other);
 
+  void swap(ByteBuffer &other) noexcept { _buf.swap(other._buf); }
+
   Byte operator[](std::size_t index) const { return _buf[index]; }
   Byte &operator[](std::size_t index) { return _buf[index]; }
 
@@ -34,6 +120,14 @@ public:
 
   void clear() { _buf.clear(); }
 
+  /**
+   * make sure at least 'n' bytes can be put without growing the buffer.
+   */
+  void ensure_writable(SizeType n) {
+    if (_buf.writable_size() < n)
+      _buf.reserve(_buf.readable_size() + n);
+  }
+
   void discard(SizeType n) {
     assert(n <= _buf.readable_size());
     _buf.advance_read(n);
@@ -55,16 +149,74 @@ public:
    */
   SizeType read_from(int fd);
 
+  /**
+   * read at most 'max' bytes from a file descriptor
+   */
+  SizeType read_from(int fd, SizeType max);
+
   /**
    * write bytes to a file descriptor
    */
   SizeType write_to(int fd);
 
+  /**
+   * receive a single message from a socket and append it to the buffer,
+   * 'msg' supplies the name and control fields, its iovecs are filled here.
+   * The buffer grows when the message exceeds the writable bytes.
+   */
+  SizeType recv_msg(int fd, struct msghdr *msg, int flags = 0);
+
+  /**
+   * send at most 'len' readable bytes to a socket, 'msg' supplies the name
+   * and control fields, its iovecs are filled here.
+   * Sent bytes are discarded from the buffer.
+   */
+  SizeType send_msg(int fd, struct msghdr *msg, std::size_t len,
+                    int flags = 0);
+
+  /**
+   * fill 'vec' with the readable regions of the buffer, at most 2 iovecs are
+   * used, return the number of iovecs filled.
+   */
+  int readable_iovec(struct iovec *vec) const;
+
+  /**
+   * fill 'vec' with the writable regions of the buffer, at most 2 iovecs are
+   * used, return the number of iovecs filled.
+   */
+  int writable_iovec(struct iovec *vec);
+
+  /**
+   * mark 'n' bytes, which were written through 'writable_iovec', as readable.
+   */
+  void commit(SizeType n) { _buf.advance_write(n); }
+
   /**
    * find specified byte, return 0-based index.
    */
   SizeType find(Byte b) const { return _buf.find(b); }
 
+  /**
+   * find specified byte from index 'from', return 0-based index or -1.
+   */
+  SizeType find(Byte b, SizeType from) const;
+
+  /**
+   * copy 's' bytes from index 'offset' into 'data', without taking them.
+   */
+  void peek(void *data, std::size_t s, std::size_t offset = 0) const;
+
+  /**
+   * view 'len' readable bytes from index 'offset', without copying.
+   */
+  BufferView view(std::size_t offset, std::size_t len) const;
+
+  /**
+   * make the readable bytes contiguous, in place, return the first one.
+   * Costs a rotation of the storage when they wrap around its end.
+   */
+  const Byte *linearize();
+
   // put methods
   void put(const void *data, std::size_t s);
 
@@ -75,11 +227,19 @@ public:
   void put_fast(const void *data, std::size_t s) { _buf.append(data, s); }
 
   /**
-   * put an arithmetic type into the buffer
+   * put an arithmetic value into the buffer, in the host byte order, or
+   * in the byte order 'e'.
    */
   template <typename T>
-  std::enable_if<std::is_arithmetic<T>::value, T> put(T t) {
-    put_arith(&t, sizeof(t));
+  typename std::enable_if<std::is_arithmetic<T>::value>::type put(T t) {
+    put(&t, sizeof(t));
+  }
+
+  template <typename T>
+  typename std::enable_if<std::is_arithmetic<T>::value>::type put(T t,
+                                                                  Endian e) {
+    t = detail::to_order(t, e);
+    put(&t, sizeof(t));
   }
 
   /**
@@ -95,15 +255,35 @@ public:
   }
 
   /**
-   * take a arithmetic value from the buffer
+   * take an arithmetic value from the buffer, in the host byte order, or in
+   * the byte order 'e'.
    */
-  template <typename T> std::enable_if<std::is_arithmetic<T>::value, T> take() {
-    assert(_buf.readable_size() >= sizeof(T));
+  template <typename T>
+  typename std::enable_if<std::is_arithmetic<T>::value, T>::type take() {
+    assert(static_cast<std::size_t>(_buf.readable_size()) >= sizeof(T));
     T v;
     take(&v, sizeof(v));
     return v;
   }
 
+  template <typename T>
+  typename std::enable_if<std::is_arithmetic<T>::value, T>::type
+  take(Endian e) {
+    return detail::to_order(take<T>(), e);
+  }
+
+  /**
+   * read an arithmetic value in the byte order 'e' at index 'offset',
+   * without taking it.
+   */
+  template <typename T>
+  typename std::enable_if<std::is_arithmetic<T>::value, T>::type
+  peek(std::size_t offset, Endian e) const {
+    T v;
+    peek(&v, sizeof(v), offset);
+    return detail::to_order(v, e);
+  }
+
   /**
    * take all the data in the buffer out, and return as a string
    */
@@ -115,17 +295,12 @@ public:
    */
   ByteBuffer split_at(std::size_t index);
 
-private:
-  void put_arith(const void *data, std::size_t s) {
-    if (_buf.writable_size() < s)
-      _buf.expand();
-    _buf.append(data, s);
-  }
-
 private:
   ringbuf_t<Byte> _buf;
 };
 
+inline void swap(ByteBuffer &lhs, ByteBuffer &rhs) noexcept { lhs.swap(rhs); }
+
 } // namespace bsnet
 
 #endif // BSNET_BYTEBUFFER_HPP
\ No newline at end of file
@@ -6,13 +6,19 @@
 #ifndef BSNET_EVENT_HPP
 #define BSNET_EVENT_HPP
 
+#include "token.hpp"
+#include "utility.hpp"
+#include <cerrno>
 #include <cstdint>
+#include <exception>
 #include <sys/epoll.h>
+#include <system_error>
 #include <utility>
 
 namespace bsnet {
 
-using Token = std::uint64_t;
+static_assert(sizeof(Token) == sizeof(epoll_data_t),
+              "Token must fill the epoll_data of an event");
 
 /**
  * PollOpt class has 4 base enum value, and can be combined by
@@ -94,6 +100,7 @@ class Ready {
 public:
   friend class Poller;
   friend class Event;
+  friend class Registration;
 
   static Ready empty() { return {Empty}; }
   static Ready readable() { return {Read}; }
@@ -149,16 +156,16 @@ public:
   Event(Ready rd, PollOpt opt, Token tok) {
     _ev.events =
         static_cast<std::uint32_t>(rd) | static_cast<std::uint32_t>(opt);
-    _ev.data.u64 = tok;
+    _ev.data.u64 = static_cast<std::uint64_t>(tok);
   }
 
   void set_events(Ready rd, PollOpt opt) {
     _ev.events =
         static_cast<std::uint32_t>(rd) | static_cast<std::uint32_t>(opt);
   }
-  void set_token(Token tok) { _ev.data.u64 = tok; }
+  void set_token(Token tok) { _ev.data.u64 = static_cast<std::uint64_t>(tok); }
   Ready readiness() const { return Ready{_ev.events}; }
-  Token token() const { return _ev.data.u64; }
+  Token token() const { return Token(_ev.data.u64); }
 
 private:
   struct epoll_event _ev;
@@ -173,7 +180,55 @@ public:
   virtual void reregister_on(Poller &poller, Token tok, Ready interest,
                              PollOpt opts) = 0;
   virtual void deregister_on(Poller &poller) = 0;
+
+  /**
+   * As above, but report a failure in 'ec' instead of throwing. The library
+   * types implement them without throwing, the defaults call the throwing
+   * ones and take the errno carried by the error, EINVAL if there is none.
+   */
+  virtual void register_on(Poller &poller, Token tok, Ready interest,
+                           PollOpt opts, std::error_code &ec) noexcept {
+    try {
+      register_on(poller, tok, interest, opts);
+      ec.clear();
+    } catch (...) {
+      ec = current_error();
+    }
+  }
+  virtual void reregister_on(Poller &poller, Token tok, Ready interest,
+                             PollOpt opts, std::error_code &ec) noexcept {
+    try {
+      reregister_on(poller, tok, interest, opts);
+      ec.clear();
+    } catch (...) {
+      ec = current_error();
+    }
+  }
+  virtual void deregister_on(Poller &poller, std::error_code &ec) noexcept {
+    try {
+      deregister_on(poller);
+      ec.clear();
+    } catch (...) {
+      ec = current_error();
+    }
+  }
+
   virtual ~Evented() noexcept {}
+
+protected:
+  // the error code of the exception being handled.
+  static std::error_code current_error() noexcept {
+    try {
+      throw;
+    } catch (std::system_error &e) {
+      return e.code();
+    } catch (errno_error &e) {
+      if (e.error())
+        return std::error_code(e.error(), std::system_category());
+    } catch (...) {
+    }
+    return std::error_code(EINVAL, std::system_category());
+  }
 };
 } // namespace bsnet
 
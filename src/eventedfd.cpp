@@ -15,28 +15,54 @@ namespace bsnet {
 
 void EventedFd::register_on(Poller &poller, Token tok, Ready interest,
                             PollOpt opts) {
+  std::error_code ec;
+  EventedFd::register_on(poller, tok, interest, opts, ec);
+  if (ec)
+    throw poller_error();
+}
+
+void EventedFd::reregister_on(Poller &poller, Token tok, Ready interest,
+                              PollOpt opts) {
+  std::error_code ec;
+  EventedFd::reregister_on(poller, tok, interest, opts, ec);
+  if (ec)
+    throw poller_error();
+}
+
+void EventedFd::deregister_on(Poller &poller) {
+  std::error_code ec;
+  EventedFd::deregister_on(poller, ec);
+  if (ec)
+    throw poller_error();
+}
+
+void EventedFd::register_on(Poller &poller, Token tok, Ready interest,
+                            PollOpt opts, std::error_code &ec) noexcept {
   Event evt(interest, opts, tok);
+  ec.clear();
 #ifdef __linux__
-  CHECKED(::epoll_ctl(poller.fd(), EPOLL_CTL_ADD, _fd,
-                      reinterpret_cast<struct epoll_event *>(&evt)) == 0,
-          poller_error);
+  if (::epoll_ctl(poller.fd(), EPOLL_CTL_ADD, _fd,
+                  reinterpret_cast<struct epoll_event *>(&evt)) != 0)
+    ec = last_error();
 #endif
 }
 
 void EventedFd::reregister_on(Poller &poller, Token tok, Ready interest,
-                              PollOpt opts) {
+                              PollOpt opts, std::error_code &ec) noexcept {
   Event evt(interest, opts, tok);
+  ec.clear();
 #ifdef __linux__
-  CHECKED(::epoll_ctl(poller.fd(), EPOLL_CTL_MOD, _fd,
-                      reinterpret_cast<struct epoll_event *>(&evt)) == 0,
-          poller_error);
+  if (::epoll_ctl(poller.fd(), EPOLL_CTL_MOD, _fd,
+                  reinterpret_cast<struct epoll_event *>(&evt)) != 0)
+    ec = last_error();
 #endif
 }
 
-void EventedFd::deregister_on(Poller &poller) {
+void EventedFd::deregister_on(Poller &poller, std::error_code &ec) noexcept {
+  ec.clear();
 #ifdef __linux__
-  CHECKED(::epoll_ctl(poller.fd(), EPOLL_CTL_DEL, _fd, nullptr) == 0,
-          poller_error);
+  if (::epoll_ctl(poller.fd(), EPOLL_CTL_DEL, _fd, nullptr) != 0)
+    ec = last_error();
 #endif
 }
 
@@ -23,7 +23,24 @@ public:
 
   void deregister_on(Poller &poller) override;
 
+  void register_on(Poller &poller, Token tok, Ready interest, PollOpt opts,
+                   std::error_code &ec) noexcept override;
+  void reregister_on(Poller &poller, Token tok, Ready interest, PollOpt opts,
+                     std::error_code &ec) noexcept override;
+  void deregister_on(Poller &poller, std::error_code &ec) noexcept override;
+
   int fd() const { return _fd; }
+
+  /**
+   * Give up the ownership of the file descriptor, it won't be closed by
+   * this object anymore.
+   */
+  int release() noexcept {
+    int fd = _fd;
+    _fd = -1;
+    return fd;
+  }
+
   ~EventedFd() noexcept override;
 
   void swap(EventedFd &other) noexcept;
@@ -0,0 +1,66 @@
+//
+// Created by byao on 1/26/18.
+// Copyright (c) 2018 byao. All rights reserved.
+//
+
+#ifndef BSNET_EXECUTOR_HPP
+#define BSNET_EXECUTOR_HPP
+
+#include "poller_epoll.hpp"
+#include "task.hpp"
+#include <utility>
+
+namespace bsnet {
+
+/**
+ * Executor runs tasks on a poller thread, ex. to send a reply computed by a
+ * worker pool.
+ *
+ *   Executor ex = poller->executor();
+ *   std::thread worker([ex]() mutable { ex.post([] { ... }); });
+ *
+ * Posting queues the task in a lock-free list and wakes up the poller with
+ * the eventfd of its user space events, the tasks are run in a batch by
+ * 'Poller::user_poll', in the order they are posted by a thread.
+ *
+ * Handles are cheap to copy and can outlive the poller, posting to a
+ * destroyed poller fails, and the task is dropped.
+ */
+class Executor {
+public:
+  Executor(const Executor &other) noexcept : _rq(other._rq) {
+    if (_rq)
+      _rq->retain();
+  }
+  Executor(Executor &&other) noexcept : _rq(nullptr) { this->swap(other); }
+  Executor &operator=(Executor other) noexcept {
+    this->swap(other);
+    return *this;
+  }
+  ~Executor() noexcept {
+    if (_rq)
+      _rq->release();
+  }
+
+  void swap(Executor &other) noexcept {
+    using std::swap;
+    swap(_rq, other._rq);
+  }
+
+  /**
+   * Returns false if the poller is gone, or the handle was moved from.
+   */
+  bool post(Task task) { return _rq && _rq->post(std::move(task)); }
+
+private:
+  friend class Poller;
+  explicit Executor(ReadinessQueue *rq) : _rq(rq) { _rq->retain(); }
+
+  ReadinessQueue *_rq;
+};
+
+inline void swap(Executor &lhs, Executor &rhs) noexcept { lhs.swap(rhs); }
+
+} // namespace bsnet
+
+#endif // BSNET_EXECUTOR_HPP
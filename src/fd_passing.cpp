@@ -0,0 +1,80 @@
+//
+// Created by byao on 1/12/18.
+// Copyright (c) 2018 byao. All rights reserved.
+//
+
+#include "fd_passing.hpp"
+#include <cerrno>
+#include <cstring>
+#include <unistd.h>
+
+using namespace std;
+
+namespace bsnet {
+
+ssize_t send_fds(int sock, ByteBuffer &buf, const int *fds, size_t nfds,
+                 const struct sockaddr *name, socklen_t namelen) {
+  if (nfds > MaxPassedFds) {
+    errno = EINVAL;
+    return -1;
+  }
+  struct msghdr msg;
+  memset(&msg, 0, sizeof(msg));
+  msg.msg_name = const_cast<struct sockaddr *>(name);
+  msg.msg_namelen = namelen;
+
+  char control[CMSG_SPACE(sizeof(int) * MaxPassedFds)];
+  if (nfds > 0) {
+    memset(&control[0], 0, CMSG_SPACE(sizeof(int) * nfds));
+    msg.msg_control = &control[0];
+    msg.msg_controllen = CMSG_SPACE(sizeof(int) * nfds);
+    struct cmsghdr *cm = CMSG_FIRSTHDR(&msg);
+    cm->cmsg_level = SOL_SOCKET;
+    cm->cmsg_type = SCM_RIGHTS;
+    cm->cmsg_len = CMSG_LEN(sizeof(int) * nfds);
+    memcpy(CMSG_DATA(cm), fds, sizeof(int) * nfds);
+  }
+  return buf.send_msg(sock, &msg, buf.readable_bytes(), MSG_NOSIGNAL);
+}
+
+ssize_t recv_fds(int sock, ByteBuffer &buf, vector<int> &fds,
+                 struct sockaddr *name, socklen_t *namelen) {
+  struct msghdr msg;
+  memset(&msg, 0, sizeof(msg));
+  msg.msg_name = name;
+  msg.msg_namelen = namelen ? *namelen : 0;
+
+  char control[CMSG_SPACE(sizeof(int) * MaxPassedFds)];
+  msg.msg_control = &control[0];
+  msg.msg_controllen = sizeof(control);
+
+  ssize_t n = buf.recv_msg(sock, &msg, MSG_CMSG_CLOEXEC);
+  if (n == -1)
+    return n;
+  if (namelen)
+    *namelen = msg.msg_namelen;
+
+  // a partial set of descriptors is useless to the caller.
+  bool truncated = (msg.msg_flags & MSG_CTRUNC) != 0;
+  for (struct cmsghdr *cm = CMSG_FIRSTHDR(&msg); cm != nullptr;
+       cm = CMSG_NXTHDR(&msg, cm)) {
+    if (cm->cmsg_level != SOL_SOCKET || cm->cmsg_type != SCM_RIGHTS)
+      continue;
+    size_t count = (cm->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+    const auto *data = reinterpret_cast<const unsigned char *>(CMSG_DATA(cm));
+    for (size_t i = 0; i < count; ++i) {
+      int fd;
+      memcpy(&fd, data + i * sizeof(int), sizeof(int));
+      if (truncated)
+        ::close(fd);
+      else
+        fds.push_back(fd);
+    }
+  }
+  if (truncated) {
+    errno = EMSGSIZE;
+    return -1;
+  }
+  return n;
+}
+} // namespace bsnet
@@ -0,0 +1,45 @@
+//
+// Created by byao on 1/12/18.
+// Copyright (c) 2018 byao. All rights reserved.
+//
+
+#ifndef BSNET_FDPASSING_HPP
+#define BSNET_FDPASSING_HPP
+
+#include "bytebuffer.hpp"
+#include <cstddef>
+#include <sys/socket.h>
+#include <vector>
+
+namespace bsnet {
+
+/**
+ * Max number of file descriptors carried by a single message (SCM_MAX_FD).
+ */
+constexpr std::size_t MaxPassedFds = 253;
+
+/**
+ * Send the readable bytes of 'buf' over the unix socket 'sock', along with
+ * 'fds' as SCM_RIGHTS ancillary data. The receiver gets duplicates of the
+ * descriptors, the caller still owns 'fds'.
+ * 'name' can be nullptr for a connected socket.
+ * Return the bytes sent or -1 on error, sent bytes are discarded from 'buf'.
+ */
+ssize_t send_fds(int sock, ByteBuffer &buf, const int *fds, std::size_t nfds,
+                 const struct sockaddr *name = nullptr,
+                 socklen_t namelen = 0);
+
+/**
+ * Receive bytes from the unix socket 'sock' into 'buf', descriptors passed
+ * along are appended to 'fds' (with close-on-exec set), the caller owns them.
+ * 'name' and 'namelen' can be nullptr.
+ * If the peer passed more than 'MaxPassedFds' descriptors, the kernel drops
+ * some of them: those received are closed, and it returns -1 with errno
+ * EMSGSIZE, the bytes are still appended to 'buf'.
+ */
+ssize_t recv_fds(int sock, ByteBuffer &buf, std::vector<int> &fds,
+                 struct sockaddr *name = nullptr,
+                 socklen_t *namelen = nullptr);
+} // namespace bsnet
+
+#endif // BSNET_FDPASSING_HPP
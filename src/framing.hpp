@@ -0,0 +1,222 @@
+//
+// Created by byao on 2/12/18.
+// Copyright (c) 2018 byao. All rights reserved.
+//
+
+#ifndef BSNET_FRAMING_HPP
+#define BSNET_FRAMING_HPP
+
+#include "bytebuffer.hpp"
+#include "neterr.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <type_traits>
+
+namespace bsnet {
+
+enum class DecodeResult { Frame, NeedMore, Invalid };
+
+/**
+ * A decoded frame, its payload is a view into the input buffer, valid until
+ * the buffer is modified. The caller consumes the frame with
+ * 'buf.discard(frame.size)', which covers the header and delimiters too.
+ */
+struct Frame {
+  BufferView payload;
+  std::size_t size = 0;
+};
+
+/**
+ * Frames prefixed by their payload length, as an unsigned 'Len' in the byte
+ * order 'E'.
+ *
+ * 'decode' only peeks at the buffer, it can be called again after more
+ * bytes are read, a payload larger than 'max_frame' is 'Invalid'.
+ */
+template <typename Len, Endian E = Endian::Big> class length_codec_t {
+  static_assert(std::is_unsigned<Len>::value, "length is an unsigned type");
+
+public:
+  static constexpr std::size_t HeaderSize = sizeof(Len);
+
+  explicit length_codec_t(
+      std::size_t max_frame = std::numeric_limits<Len>::max())
+      : _max_frame(max_frame) {}
+
+  std::size_t max_frame() const { return _max_frame; }
+
+  DecodeResult decode(const ByteBuffer &buf, Frame &frame) const {
+    auto avail = static_cast<std::size_t>(buf.readable_bytes());
+    if (avail < HeaderSize)
+      return DecodeResult::NeedMore;
+    auto len = static_cast<std::size_t>(buf.peek<Len>(0, E));
+    if (len > _max_frame)
+      return DecodeResult::Invalid;
+    // not 'HeaderSize + len', which wraps for a 64-bit length.
+    if (len > avail - HeaderSize)
+      return DecodeResult::NeedMore;
+    frame.payload = buf.view(HeaderSize, len);
+    frame.size = HeaderSize + len;
+    return DecodeResult::Frame;
+  }
+
+  /**
+   * put the header only, for a payload sent separately, ex. gathered.
+   * throws 'framing_error' if 'len' is over 'max_frame' or 'Len', nothing
+   * is put then.
+   */
+  void encode_header(ByteBuffer &buf, std::size_t len) const {
+    check_length(len);
+    buf.put(static_cast<Len>(len), E);
+  }
+
+  void encode(ByteBuffer &buf, const void *data, std::size_t len) const {
+    check_length(len);
+    buf.ensure_writable(static_cast<ByteBuffer::SizeType>(HeaderSize + len));
+    encode_header(buf, len);
+    buf.put(data, len);
+  }
+
+private:
+  void check_length(std::size_t len) const {
+    if (len > _max_frame || len > std::numeric_limits<Len>::max())
+      throw framing_error("frame too large");
+  }
+
+  std::size_t _max_frame;
+};
+
+template <typename Len, Endian E>
+constexpr std::size_t length_codec_t<Len, E>::HeaderSize;
+
+/**
+ * Frames terminated by '\n', and an optional '\r' before it. The payload
+ * excludes the terminator.
+ *
+ * The codec remembers how far it has searched, so a long line arriving in
+ * many reads is scanned once. It's meant for a single stream, 'reset' it
+ * if the buffer is consumed other than by discarding whole frames.
+ */
+class LineCodec {
+public:
+  explicit LineCodec(std::size_t max_line = 8192, bool strip_cr = true)
+      : _max_line(max_line), _strip_cr(strip_cr), _scanned(0) {}
+
+  std::size_t max_line() const { return _max_line; }
+
+  DecodeResult decode(const ByteBuffer &buf, Frame &frame) {
+    auto avail = static_cast<std::size_t>(buf.readable_bytes());
+    auto pos = buf.find('\n', static_cast<ByteBuffer::SizeType>(_scanned));
+    if (pos < 0) {
+      _scanned = avail;
+      return avail > _max_line ? DecodeResult::Invalid
+                               : DecodeResult::NeedMore;
+    }
+    _scanned = 0;
+    auto len = static_cast<std::size_t>(pos);
+    if (len > _max_line)
+      return DecodeResult::Invalid;
+    frame.size = len + 1;
+    if (_strip_cr && len > 0 && buf[len - 1] == '\r')
+      --len;
+    frame.payload = buf.view(0, len);
+    return DecodeResult::Frame;
+  }
+
+  void encode(ByteBuffer &buf, const void *data, std::size_t len) const {
+    buf.ensure_writable(static_cast<ByteBuffer::SizeType>(len + 2));
+    buf.put(data, len);
+    if (_strip_cr)
+      buf.put<Byte>('\r');
+    buf.put<Byte>('\n');
+  }
+
+  void reset() { _scanned = 0; }
+
+private:
+  std::size_t _max_line;
+  bool _strip_cr;
+  // bytes known to have no '\n'
+  std::size_t _scanned;
+};
+
+/**
+ * Frames prefixed by their payload length as a base 128 varint (LEB128),
+ * as used by protobuf streams.
+ */
+class VarintCodec {
+public:
+  static constexpr std::size_t MaxHeaderSize = 10;
+
+  explicit VarintCodec(std::size_t max_frame = 64 * 1024 * 1024)
+      : _max_frame(max_frame) {}
+
+  std::size_t max_frame() const { return _max_frame; }
+
+  DecodeResult decode(const ByteBuffer &buf, Frame &frame) const {
+    auto avail = static_cast<std::size_t>(buf.readable_bytes());
+    std::uint64_t len = 0;
+    std::size_t i = 0;
+    for (;; ++i) {
+      if (i == MaxHeaderSize)
+        return DecodeResult::Invalid;
+      if (i == avail)
+        return DecodeResult::NeedMore;
+      Byte b = buf[i];
+      // the 10th byte holds the 64th bit only.
+      if (i == MaxHeaderSize - 1 && b > 1)
+        return DecodeResult::Invalid;
+      len |= static_cast<std::uint64_t>(b & 0x7f) << (7 * i);
+      if (!(b & 0x80))
+        break;
+    }
+    std::size_t header = i + 1;
+    if (len > _max_frame)
+      return DecodeResult::Invalid;
+    if (len > avail - header)
+      return DecodeResult::NeedMore;
+    frame.payload = buf.view(header, static_cast<std::size_t>(len));
+    frame.size = header + static_cast<std::size_t>(len);
+    return DecodeResult::Frame;
+  }
+
+  /**
+   * throws 'framing_error' if 'len' is over 'max_frame', nothing is put
+   * then.
+   */
+  void encode_header(ByteBuffer &buf, std::size_t len) const {
+    check_length(len);
+    Byte header[MaxHeaderSize];
+    std::size_t n = 0;
+    std::uint64_t v = len;
+    do {
+      header[n] = static_cast<Byte>(v & 0x7f);
+      v >>= 7;
+      if (v)
+        header[n] |= 0x80;
+      ++n;
+    } while (v);
+    buf.put(header, n);
+  }
+
+  void encode(ByteBuffer &buf, const void *data, std::size_t len) const {
+    check_length(len);
+    buf.ensure_writable(
+        static_cast<ByteBuffer::SizeType>(MaxHeaderSize + len));
+    encode_header(buf, len);
+    buf.put(data, len);
+  }
+
+private:
+  void check_length(std::size_t len) const {
+    if (len > _max_frame)
+      throw framing_error("frame too large");
+  }
+
+  std::size_t _max_frame;
+};
+
+} // namespace bsnet
+
+#endif // BSNET_FRAMING_HPP
@@ -0,0 +1,248 @@
+//
+// Created by byao on 1/16/18.
+// Copyright (c) 2018 byao. All rights reserved.
+//
+
+#include "handoff.hpp"
+#include <cerrno>
+#include <cstring>
+#include <deque>
+#include <poll.h>
+#include <unistd.h>
+
+using namespace std;
+
+namespace bsnet {
+
+IMPL_ERR(handoff_error);
+
+namespace {
+
+enum Kind : uint8_t { End = 0, Listener = 1, Stream = 2 };
+
+// every item is sent as a header, followed by the name, the read buffer and
+// the write buffer, the descriptor travels with the first byte of the header.
+struct Header {
+  uint8_t kind;
+  uint8_t reserved;
+  uint16_t name_len;
+  uint32_t rbuf_len;
+  uint32_t wbuf_len;
+};
+
+const char Ack = 'A';
+
+int to_timeout(const Duration *timeout) {
+  return timeout ? static_cast<int>(timeout->count()) : -1;
+}
+
+void wait_for(int fd, short events, int timeout) {
+  struct pollfd pfd;
+  pfd.fd = fd;
+  pfd.events = events;
+  int n;
+  while ((n = ::poll(&pfd, 1, timeout)) == -1 && errno == EINTR)
+    ;
+  if (n == 0)
+    throw handoff_error("timeout");
+  if (n < 0)
+    throw handoff_error();
+}
+
+void put_buffer(ByteBuffer &msg, const ByteBuffer &buf) {
+  struct iovec vio[2];
+  int len = buf.readable_iovec(&vio[0]);
+  for (int i = 0; i < len; ++i)
+    msg.put(vio[i].iov_base, vio[i].iov_len);
+}
+
+ByteBuffer take_buffer(ByteBuffer &msg, size_t len) {
+  ByteBuffer buf(len);
+  vector<Byte> data(len);
+  if (len > 0) {
+    msg.take(data.data(), len);
+    buf.put(data.data(), len);
+  }
+  return buf;
+}
+
+void send_all(UnixStream &conn, ByteBuffer &msg, int fd, int timeout) {
+  bool fd_sent = fd < 0;
+  while (msg.readable_bytes() > 0) {
+    ssize_t n = fd_sent ? conn.send_fds(msg, nullptr, 0)
+                        : conn.send_fds(msg, &fd, 1);
+    if (n > 0) {
+      fd_sent = true;
+    } else if (n == -1 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+      wait_for(conn.fd(), POLLOUT, timeout);
+    } else {
+      throw handoff_error();
+    }
+  }
+}
+
+// fill 'buf' from 'conn', throws if the peer is gone.
+void recv_some(UnixStream &conn, ByteBuffer &buf, vector<int> &fds,
+               int timeout) {
+  while (true) {
+    ssize_t n = conn.recv_fds(buf, fds);
+    if (n > 0)
+      return;
+    if (n == 0)
+      throw handoff_error("connection closed during handoff");
+    if (errno != EAGAIN && errno != EWOULDBLOCK)
+      throw handoff_error();
+    wait_for(conn.fd(), POLLIN, timeout);
+  }
+}
+
+} // namespace
+
+void HandoffSender::add_listener(const string &name,
+                                 const EventedFd &listener) {
+  _items.push_back(Item{Listener, name, listener.fd(), ByteBuffer(0),
+                        ByteBuffer(0)});
+}
+
+void HandoffSender::add_stream(const string &name, const EventedFd &stream,
+                               const ByteBuffer &rbuf, const ByteBuffer &wbuf) {
+  _items.push_back(Item{Stream, name, stream.fd(), rbuf, wbuf});
+}
+
+void HandoffSender::send(UnixStream &conn, const Duration *timeout) {
+  int tm = to_timeout(timeout);
+  ByteBuffer msg;
+  for (auto &item : _items) {
+    if (item.name.size() > UINT16_MAX)
+      throw handoff_error("name too long: " + item.name);
+    Header hdr{item.kind, 0, static_cast<uint16_t>(item.name.size()),
+               static_cast<uint32_t>(item.rbuf.readable_bytes()),
+               static_cast<uint32_t>(item.wbuf.readable_bytes())};
+    msg.put(&hdr, sizeof(hdr));
+    msg.put_string(item.name);
+    put_buffer(msg, item.rbuf);
+    put_buffer(msg, item.wbuf);
+    send_all(conn, msg, item.fd, tm);
+  }
+  Header end{End, 0, 0, 0, 0};
+  msg.put(&end, sizeof(end));
+  send_all(conn, msg, -1, tm);
+
+  // the receiver owns the sockets only after the acknowledgement.
+  vector<int> fds;
+  recv_some(conn, msg, fds, tm);
+  if (msg.readable_bytes() != 1 || msg[0] != Ack)
+    throw handoff_error("invalid handoff acknowledgement");
+}
+
+HandoffReceiver::~HandoffReceiver() noexcept {
+  for (auto &kv : _items)
+    ::close(kv.second.fd);
+}
+
+void HandoffReceiver::receive(UnixStream &conn, const Duration *timeout) {
+  int tm = to_timeout(timeout);
+  ByteBuffer buf;
+  vector<int> received;
+  deque<int> fds;
+  try {
+    receive_items(conn, buf, received, fds, tm);
+  } catch (...) {
+    for (int fd : received)
+      ::close(fd);
+    for (int fd : fds)
+      ::close(fd);
+    throw;
+  }
+}
+
+void HandoffReceiver::receive_items(UnixStream &conn, ByteBuffer &buf,
+                                    vector<int> &received, deque<int> &fds,
+                                    int tm) {
+  while (true) {
+    recv_some(conn, buf, received, tm);
+    fds.insert(fds.end(), received.begin(), received.end());
+    received.clear();
+
+    // consume every complete item in the buffer.
+    while (static_cast<size_t>(buf.readable_bytes()) >= sizeof(Header)) {
+      Header hdr;
+      auto *p = reinterpret_cast<Byte *>(&hdr);
+      for (size_t i = 0; i < sizeof(hdr); ++i)
+        p[i] = buf[i];
+
+      if (hdr.kind == End) {
+        buf.discard(sizeof(hdr));
+        for (int fd : fds)
+          ::close(fd);
+        fds.clear();
+        ByteBuffer ack(1);
+        ack.put(&Ack, 1);
+        send_all(conn, ack, -1, tm);
+        return;
+      }
+      if (hdr.kind != Listener && hdr.kind != Stream)
+        throw handoff_error("invalid handoff item");
+
+      size_t total = sizeof(hdr) + hdr.name_len + hdr.rbuf_len + hdr.wbuf_len;
+      if (static_cast<size_t>(buf.readable_bytes()) < total)
+        break;
+      if (fds.empty())
+        throw handoff_error("handoff item without descriptor");
+
+      buf.discard(sizeof(hdr));
+      string name(hdr.name_len, '\0');
+      buf.take(&name[0], hdr.name_len);
+      Item item{hdr.kind, fds.front(), take_buffer(buf, hdr.rbuf_len),
+                take_buffer(buf, hdr.wbuf_len)};
+      fds.pop_front();
+
+      auto it = _items.find(name);
+      if (it != _items.end()) {
+        ::close(it->second.fd);
+        _items.erase(it);
+      }
+      _items.emplace(name, std::move(item));
+    }
+  }
+}
+
+vector<string> HandoffReceiver::names(uint8_t kind) const {
+  vector<string> res;
+  for (auto &kv : _items) {
+    if (kv.second.kind == kind)
+      res.push_back(kv.first);
+  }
+  return res;
+}
+
+vector<string> HandoffReceiver::listener_names() const {
+  return names(Listener);
+}
+
+vector<string> HandoffReceiver::stream_names() const { return names(Stream); }
+
+int HandoffReceiver::take_fd(const string &name, ByteBuffer *rbuf,
+                             ByteBuffer *wbuf) {
+  auto it = _items.find(name);
+  if (it == _items.end())
+    throw handoff_error("no such handoff item: " + name);
+  int fd = it->second.fd;
+  if (rbuf)
+    *rbuf = it->second.rbuf;
+  if (wbuf)
+    *wbuf = it->second.wbuf;
+  _items.erase(it);
+  return fd;
+}
+
+TcpListener HandoffReceiver::take_listener(const string &name) {
+  return TcpListener::from_fd(take_fd(name));
+}
+
+TcpStream HandoffReceiver::take_stream(const string &name, ByteBuffer *rbuf,
+                                       ByteBuffer *wbuf) {
+  return TcpStream::from_fd(take_fd(name, rbuf, wbuf));
+}
+
+} // namespace bsnet
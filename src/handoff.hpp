@@ -0,0 +1,114 @@
+//
+// Created by byao on 1/16/18.
+// Copyright (c) 2018 byao. All rights reserved.
+//
+
+#ifndef BSNET_HANDOFF_HPP
+#define BSNET_HANDOFF_HPP
+
+#include "bytebuffer.hpp"
+#include "eventedfd.hpp"
+#include "tcp_listener.hpp"
+#include "tcp_stream.hpp"
+#include "unix_stream.hpp"
+#include "utility.hpp"
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace bsnet {
+
+DECL_ERR(handoff_error);
+
+/**
+ * Hot restart:
+ *   The old process hands its listening sockets, and optionally established
+ *   connections with their buffered data, over to a new process through a
+ *   unix stream, so the new process starts serving without closing the
+ *   listening sockets, connections waiting in the accept queue are not lost.
+ *
+ *   old process                          new process
+ *   -----------                          -----------
+ *   UnixListener::bind(addr)
+ *                                        UnixStream::connect(addr)
+ *   accept()
+ *   HandoffSender::send(conn)    --->    HandoffReceiver::receive(conn)
+ *                                <---    (ack)
+ *   stop polling, drop sockets           register sockets on its Poller
+ *
+ * Every item is identified by a name chosen by the application.
+ * Descriptors are duplicated into the new process, the sender still owns its
+ * own copies and should drop them once 'send' returns. A stream must not be
+ * read or written by the old process after it is added.
+ */
+class HandoffSender : public NonCopyable {
+public:
+  void add_listener(const std::string &name, const EventedFd &listener);
+  void add_stream(const std::string &name, const EventedFd &stream,
+                  const ByteBuffer &rbuf, const ByteBuffer &wbuf);
+
+  /**
+   * Send all the items, and wait for the receiver's acknowledgement.
+   * throws 'handoff_error' exception.
+   */
+  void send(UnixStream &conn, const Duration *timeout = nullptr);
+
+private:
+  struct Item {
+    std::uint8_t kind;
+    std::string name;
+    int fd;
+    ByteBuffer rbuf;
+    ByteBuffer wbuf;
+  };
+  std::vector<Item> _items;
+};
+
+class HandoffReceiver : public NonCopyable {
+public:
+  HandoffReceiver() = default;
+  ~HandoffReceiver() noexcept;
+
+  /**
+   * Receive all the items sent by 'HandoffSender::send', and acknowledge.
+   * throws 'handoff_error' exception.
+   */
+  void receive(UnixStream &conn, const Duration *timeout = nullptr);
+
+  std::vector<std::string> listener_names() const;
+  std::vector<std::string> stream_names() const;
+
+  /**
+   * Take the ownership of a received socket,
+   * throws 'handoff_error' if there is no such item.
+   */
+  TcpListener take_listener(const std::string &name);
+  TcpStream take_stream(const std::string &name, ByteBuffer *rbuf = nullptr,
+                        ByteBuffer *wbuf = nullptr);
+
+  /**
+   * Take a received descriptor of any kind, ex. a unix listener.
+   */
+  int take_fd(const std::string &name, ByteBuffer *rbuf = nullptr,
+              ByteBuffer *wbuf = nullptr);
+
+private:
+  struct Item {
+    std::uint8_t kind;
+    int fd;
+    ByteBuffer rbuf;
+    ByteBuffer wbuf;
+  };
+  std::vector<std::string> names(std::uint8_t kind) const;
+  void receive_items(UnixStream &conn, ByteBuffer &buf,
+                     std::vector<int> &received, std::deque<int> &fds,
+                     int timeout);
+
+  std::map<std::string, Item> _items;
+};
+
+} // namespace bsnet
+
+#endif // BSNET_HANDOFF_HPP
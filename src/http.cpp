@@ -0,0 +1,542 @@
+//
+// Created by byao on 2/14/18.
+// Copyright (c) 2018 byao. All rights reserved.
+//
+
+#include "http.hpp"
+#include "tcp_stream.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+namespace bsnet {
+
+using std::size_t;
+using SizeType = ByteBuffer::SizeType;
+
+namespace {
+
+constexpr size_t MaxChunkLine = 1024;
+
+char lower(char c) { return c >= 'A' && c <= 'Z' ? c - 'A' + 'a' : c; }
+
+bool iequals(const char *a, size_t n, const char *b) {
+  for (size_t i = 0; i < n; ++i, ++b) {
+    if (*b == '\0' || lower(a[i]) != lower(*b))
+      return false;
+  }
+  return *b == '\0';
+}
+
+// token characters of RFC 7230
+bool is_tchar(char c) {
+  if ((c >= '0' && c <= '9') || (c >= 'a' && c <= 'z') ||
+      (c >= 'A' && c <= 'Z'))
+    return true;
+  return std::strchr("!#$%&'*+-.^_`|~", c) != nullptr && c != '\0';
+}
+
+bool is_ctl(char c) {
+  auto u = static_cast<unsigned char>(c);
+  return (u < ' ' && c != '\t') || u == 0x7f;
+}
+
+// skip a line end, a bare '\n' is accepted too.
+bool eol(const char *&p, const char *end) {
+  if (p < end && *p == '\n') {
+    ++p;
+    return true;
+  }
+  if (end - p >= 2 && p[0] == '\r' && p[1] == '\n') {
+    p += 2;
+    return true;
+  }
+  return false;
+}
+
+int hex_digit(Byte c) {
+  if (c >= '0' && c <= '9')
+    return c - '0';
+  if (c >= 'a' && c <= 'f')
+    return c - 'a' + 10;
+  if (c >= 'A' && c <= 'F')
+    return c - 'A' + 10;
+  return -1;
+}
+
+bool parse_length(const StringRef &v, size_t &len) {
+  if (v.empty() || v.size > 18)
+    return false;
+  len = 0;
+  for (size_t i = 0; i < v.size; ++i) {
+    if (v.data[i] < '0' || v.data[i] > '9')
+      return false;
+    len = len * 10 + static_cast<size_t>(v.data[i] - '0');
+  }
+  return true;
+}
+
+// apply the tokens of a 'Connection' header.
+void parse_connection(const StringRef &v, bool &keep_alive) {
+  const char *p = v.data, *end = v.data + v.size;
+  while (p < end) {
+    const char *comma = std::find(p, end, ',');
+    const char *s = p, *e = comma;
+    while (s < e && (*s == ' ' || *s == '\t'))
+      ++s;
+    while (e > s && (e[-1] == ' ' || e[-1] == '\t'))
+      --e;
+    auto n = static_cast<size_t>(e - s);
+    if (iequals(s, n, "close"))
+      keep_alive = false;
+    else if (iequals(s, n, "keep-alive"))
+      keep_alive = true;
+    p = comma == end ? end : comma + 1;
+  }
+}
+
+} // namespace
+
+bool StringRef::equals(const char *s) const {
+  return std::strlen(s) == size && std::memcmp(data, s, size) == 0;
+}
+
+bool StringRef::iequals(const char *s) const {
+  return bsnet::iequals(data, size, s);
+}
+
+const StringRef *HttpRequest::header(const char *name) const {
+  for (auto &h : headers) {
+    if (h.name.iequals(name))
+      return &h.value;
+  }
+  return nullptr;
+}
+
+void HttpRequest::clear() {
+  method = StringRef();
+  target = StringRef();
+  minor_version = 1;
+  headers.clear();
+  keep_alive = true;
+  chunked = false;
+  content_length = 0;
+  body = BufferView();
+}
+
+constexpr size_t HttpParser::DefaultMaxHead;
+constexpr size_t HttpParser::DefaultMaxHeaders;
+
+HttpResult HttpParser::parse(ByteBuffer &buf, HttpRequest &req) {
+  while (true) {
+    switch (_state) {
+    case State::Head:
+      return parse_head(buf, req);
+
+    case State::Body:
+      return parse_body(buf, req, State::End);
+
+    case State::ChunkSize: {
+      size_t len = next_line(buf);
+      if (len == 0)
+        return _scanned > MaxChunkLine ? fail() : HttpResult::NeedMore;
+      if (len > MaxChunkLine)
+        return fail();
+      size_t size = 0, i = 0;
+      for (; i < len; ++i) {
+        int d = hex_digit(buf[_pos + i]);
+        if (d < 0)
+          break;
+        // more than 60 bits
+        if (i == 15)
+          return fail();
+        size = size * 16 + static_cast<size_t>(d);
+      }
+      Byte c = buf[_pos + i];
+      if (i == 0 || (c != '\r' && c != '\n' && c != ';' && c != ' ' &&
+                     c != '\t'))
+        return fail();
+      _pos += len;
+      if (size == 0) {
+        _trailer = 0;
+        _state = State::Trailer;
+      } else {
+        _remaining = size;
+        _state = State::ChunkData;
+      }
+      break;
+    }
+
+    case State::ChunkData:
+      return parse_body(buf, req, State::ChunkEnd);
+
+    case State::ChunkEnd: {
+      auto avail = static_cast<size_t>(buf.readable_bytes()) - _pos;
+      if (avail == 0)
+        return HttpResult::NeedMore;
+      if (buf[_pos] == '\n') {
+        _pos += 1;
+      } else if (buf[_pos] == '\r') {
+        if (avail < 2)
+          return HttpResult::NeedMore;
+        if (buf[_pos + 1] != '\n')
+          return fail();
+        _pos += 2;
+      } else {
+        return fail();
+      }
+      _state = State::ChunkSize;
+      break;
+    }
+
+    case State::Trailer: {
+      // the trailer fields are skipped.
+      size_t len = next_line(buf);
+      if (len == 0)
+        return _trailer + _scanned > _max_head ? fail()
+                                               : HttpResult::NeedMore;
+      _trailer += len;
+      if (_trailer > _max_head)
+        return fail();
+      bool blank = len == 1 || (len == 2 && buf[_pos] == '\r');
+      _pos += len;
+      if (blank)
+        _state = State::End;
+      break;
+    }
+
+    case State::End:
+      req.body = BufferView();
+      _state = State::Head;
+      return HttpResult::Done;
+
+    case State::Invalid:
+      return HttpResult::Invalid;
+    }
+  }
+}
+
+void HttpParser::consume(ByteBuffer &buf) {
+  buf.discard(static_cast<SizeType>(_pos));
+  _pos = 0;
+}
+
+void HttpParser::reset() {
+  _state = State::Head;
+  _pos = 0;
+  _scanned = 0;
+  _remaining = 0;
+  _trailer = 0;
+}
+
+HttpResult HttpParser::parse_head(ByteBuffer &buf, HttpRequest &req) {
+  auto avail = static_cast<size_t>(buf.readable_bytes());
+  // empty lines before a request are ignored, RFC 7230 3.5.
+  while (_scanned == 0 && _pos < avail &&
+         (buf[_pos] == '\r' || buf[_pos] == '\n'))
+    ++_pos;
+
+  // the head ends with an empty line.
+  size_t end = 0;
+  auto from = static_cast<SizeType>(_pos + _scanned);
+  while (true) {
+    SizeType i = buf.find('\n', from);
+    if (i < 0) {
+      _scanned = avail - _pos;
+      return _scanned > _max_head ? fail() : HttpResult::NeedMore;
+    }
+    auto at = static_cast<size_t>(i);
+    if (at > _pos && (buf[at - 1] == '\n' ||
+                      (buf[at - 1] == '\r' && at - 1 > _pos &&
+                       buf[at - 2] == '\n'))) {
+      end = at + 1;
+      break;
+    }
+    from = i + 1;
+  }
+  _scanned = 0;
+  if (end - _pos > _max_head)
+    return fail();
+
+  const auto *base = reinterpret_cast<const char *>(buf.linearize());
+  req.clear();
+  if (!parse_head_fields(base + _pos, base + end, req))
+    return fail();
+  _pos = end;
+
+  if (req.chunked) {
+    _state = State::ChunkSize;
+  } else if (req.content_length > 0) {
+    _remaining = req.content_length;
+    _state = State::Body;
+  } else {
+    _state = State::End;
+  }
+  return HttpResult::Head;
+}
+
+bool HttpParser::parse_head_fields(const char *p, const char *end,
+                                   HttpRequest &req) {
+  // request line
+  const char *s = p;
+  while (p < end && is_tchar(*p))
+    ++p;
+  if (p == s || p == end || *p != ' ')
+    return false;
+  req.method = StringRef{s, static_cast<size_t>(p - s)};
+
+  s = ++p;
+  while (p < end && *p != ' ' && !is_ctl(*p))
+    ++p;
+  if (p == s || p == end || *p != ' ')
+    return false;
+  req.target = StringRef{s, static_cast<size_t>(p - s)};
+
+  ++p;
+  if (end - p < 8 || std::memcmp(p, "HTTP/1.", 7) != 0 ||
+      (p[7] != '0' && p[7] != '1'))
+    return false;
+  req.minor_version = p[7] - '0';
+  req.keep_alive = req.minor_version == 1;
+  p += 8;
+  if (!eol(p, end))
+    return false;
+
+  // header fields, until the empty line
+  bool has_length = false;
+  while (!eol(p, end)) {
+    s = p;
+    while (p < end && is_tchar(*p))
+      ++p;
+    // no space before the colon, nor obsolete line folding.
+    if (p == s || p == end || *p != ':')
+      return false;
+    StringRef name{s, static_cast<size_t>(p - s)};
+
+    ++p;
+    while (p < end && (*p == ' ' || *p == '\t'))
+      ++p;
+    s = p;
+    while (p < end && *p != '\r' && *p != '\n') {
+      if (is_ctl(*p))
+        return false;
+      ++p;
+    }
+    const char *e = p;
+    while (e > s && (e[-1] == ' ' || e[-1] == '\t'))
+      --e;
+    if (!eol(p, end))
+      return false;
+    StringRef value{s, static_cast<size_t>(e - s)};
+
+    if (req.headers.size() == _max_headers)
+      return false;
+    req.headers.push_back(HttpHeader{name, value});
+
+    if (name.iequals("content-length")) {
+      size_t len;
+      if (!parse_length(value, len) ||
+          (has_length && len != req.content_length))
+        return false;
+      has_length = true;
+      req.content_length = len;
+    } else if (name.iequals("transfer-encoding")) {
+      // no other coding is supported.
+      if (!value.iequals("chunked"))
+        return false;
+      req.chunked = true;
+    } else if (name.iequals("connection")) {
+      parse_connection(value, req.keep_alive);
+    }
+  }
+  // ambiguous framing, RFC 7230 3.3.3.
+  return !(req.chunked && has_length);
+}
+
+HttpResult HttpParser::parse_body(const ByteBuffer &buf, HttpRequest &req,
+                                  State next) {
+  auto avail = static_cast<size_t>(buf.readable_bytes()) - _pos;
+  if (avail == 0)
+    return HttpResult::NeedMore;
+  size_t n = std::min(avail, _remaining);
+  req.body = buf.view(_pos, n);
+  _pos += n;
+  _remaining -= n;
+  if (_remaining == 0)
+    _state = next;
+  return HttpResult::Body;
+}
+
+size_t HttpParser::next_line(const ByteBuffer &buf) {
+  SizeType i = buf.find('\n', static_cast<SizeType>(_pos + _scanned));
+  if (i < 0) {
+    _scanned = static_cast<size_t>(buf.readable_bytes()) - _pos;
+    return 0;
+  }
+  _scanned = 0;
+  return static_cast<size_t>(i) + 1 - _pos;
+}
+
+void HttpResponse::start(int status, const char *reason_phrase,
+                         int minor_version) {
+  clear_parts();
+  _head_done = false;
+  _has_length = false;
+  _chunked = false;
+
+  char line[32];
+  int n = snprintf(line, sizeof(line), "HTTP/1.%d %d ", minor_version, status);
+  _head.put(line, static_cast<size_t>(n));
+  if (!reason_phrase)
+    reason_phrase = reason(status);
+  _head.put(reason_phrase, std::strlen(reason_phrase));
+  _head.put("\r\n", 2);
+}
+
+void HttpResponse::header(const char *name, const char *value) {
+  put_header(name, value, std::strlen(value));
+}
+
+void HttpResponse::header(const char *name, const std::string &value) {
+  put_header(name, value.data(), value.size());
+}
+
+void HttpResponse::header(const char *name, size_t value) {
+  char num[24];
+  int n = snprintf(num, sizeof(num), "%zu", value);
+  put_header(name, num, static_cast<size_t>(n));
+}
+
+void HttpResponse::chunked() {
+  header("Transfer-Encoding", "chunked");
+  _chunked = true;
+}
+
+void HttpResponse::body(const void *data, size_t len) {
+  struct iovec v;
+  v.iov_base = const_cast<void *>(data);
+  v.iov_len = len;
+  add_body(&v, 1, len);
+}
+
+void HttpResponse::body(const BufferView &v) {
+  add_body(v.iov(), v.iovcnt(), v.size());
+}
+
+bool HttpResponse::send(TcpStream &stream, bool last) {
+  auto &iov = gather(last);
+  bool ok = stream.send(iov.data(), static_cast<int>(iov.size()));
+  clear_parts();
+  return ok;
+}
+
+void HttpResponse::write_to(ByteBuffer &out, bool last) {
+  for (auto &v : gather(last))
+    out.put(v.iov_base, v.iov_len);
+  clear_parts();
+}
+
+const char *HttpResponse::reason(int status) {
+  switch (status) {
+  case 100:
+    return "Continue";
+  case 200:
+    return "OK";
+  case 201:
+    return "Created";
+  case 204:
+    return "No Content";
+  case 206:
+    return "Partial Content";
+  case 301:
+    return "Moved Permanently";
+  case 302:
+    return "Found";
+  case 304:
+    return "Not Modified";
+  case 400:
+    return "Bad Request";
+  case 403:
+    return "Forbidden";
+  case 404:
+    return "Not Found";
+  case 405:
+    return "Method Not Allowed";
+  case 413:
+    return "Payload Too Large";
+  case 431:
+    return "Request Header Fields Too Large";
+  case 500:
+    return "Internal Server Error";
+  case 501:
+    return "Not Implemented";
+  case 503:
+    return "Service Unavailable";
+  default:
+    return "Unknown";
+  }
+}
+
+void HttpResponse::put_header(const char *name, const char *value,
+                              size_t len) {
+  if (StringRef{name, std::strlen(name)}.iequals("content-length"))
+    _has_length = true;
+  _head.put(name, std::strlen(name));
+  _head.put(": ", 2);
+  _head.put(value, len);
+  _head.put("\r\n", 2);
+}
+
+void HttpResponse::add_body(const struct iovec *iov, int iovcnt, size_t len) {
+  if (len == 0)
+    return;
+  if (_chunked) {
+    char line[24];
+    int n = snprintf(line, sizeof(line), "%zx\r\n", len);
+    put_meta(line, static_cast<size_t>(n));
+  }
+  for (int i = 0; i < iovcnt; ++i)
+    _slices.push_back(Slice{iov[i].iov_base, 0, iov[i].iov_len});
+  if (_chunked)
+    put_meta("\r\n", 2);
+  _body_size += len;
+}
+
+void HttpResponse::put_meta(const char *s, size_t len) {
+  _slices.push_back(
+      Slice{nullptr, static_cast<size_t>(_meta.readable_bytes()), len});
+  _meta.put(s, len);
+}
+
+const std::vector<struct iovec> &HttpResponse::gather(bool last) {
+  _iov.clear();
+  struct iovec v;
+  if (!_head_done) {
+    if (!_chunked && !_has_length)
+      header("Content-Length", _body_size);
+    _head.put("\r\n", 2);
+    _head_done = true;
+    v.iov_base = const_cast<Byte *>(_head.linearize());
+    v.iov_len = static_cast<size_t>(_head.readable_bytes());
+    _iov.push_back(v);
+  }
+  if (last && _chunked)
+    put_meta("0\r\n\r\n", 5);
+  // '_meta' is only appended to, its bytes stay in place from here.
+  const Byte *meta = _meta.linearize();
+  for (auto &s : _slices) {
+    v.iov_base = const_cast<void *>(s.data ? s.data : meta + s.off);
+    v.iov_len = s.len;
+    _iov.push_back(v);
+  }
+  return _iov;
+}
+
+void HttpResponse::clear_parts() {
+  _head.clear();
+  _meta.clear();
+  _slices.clear();
+  _body_size = 0;
+}
+
+} // namespace bsnet
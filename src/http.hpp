@@ -0,0 +1,213 @@
+//
+// Created by byao on 2/14/18.
+// Copyright (c) 2018 byao. All rights reserved.
+//
+
+#ifndef BSNET_HTTP_HPP
+#define BSNET_HTTP_HPP
+
+#include "bytebuffer.hpp"
+#include <cstddef>
+#include <string>
+#include <sys/uio.h>
+#include <vector>
+
+namespace bsnet {
+
+class TcpStream;
+
+/**
+ * A string owned by someone else, usually a view into a ByteBuffer.
+ */
+struct StringRef {
+  const char *data = nullptr;
+  std::size_t size = 0;
+
+  bool empty() const { return size == 0; }
+  std::string to_string() const { return std::string(data, size); }
+
+  bool equals(const char *s) const;
+  // ASCII case insensitive, as header names and tokens are compared.
+  bool iequals(const char *s) const;
+};
+
+struct HttpHeader {
+  StringRef name;
+  StringRef value;
+};
+
+/**
+ * A request parsed in place, the strings point into the input buffer, they
+ * are valid until the buffer is consumed or modified.
+ */
+struct HttpRequest {
+  StringRef method;
+  StringRef target;
+  int minor_version = 1;
+  std::vector<HttpHeader> headers;
+
+  bool keep_alive = true;
+  bool chunked = false;
+  std::size_t content_length = 0;
+
+  // the slice of the last 'Body' result
+  BufferView body;
+
+  /**
+   * The first header of 'name', nullptr if absent.
+   */
+  const StringRef *header(const char *name) const;
+
+  void clear();
+};
+
+enum class HttpResult { Head, Body, Done, NeedMore, Invalid };
+
+/**
+ * Incremental HTTP/1.1 request parser, working on the bytes of a ByteBuffer
+ * in place.
+ *
+ * 'parse' reports the head of a request, then its body as slices of what
+ * has arrived, de-chunked when it's chunked, then 'Done'. It returns
+ * 'NeedMore' when the buffer ends in the middle, call it again after the
+ * next read. The following request starts after 'Done', so pipelined
+ * requests are parsed one after another from the same buffer.
+ *
+ * The parser never takes bytes from the buffer, 'consume' discards what it
+ * has parsed, after the views of the request are no longer used. The head
+ * is made contiguous in the buffer, if it wraps around the end of the ring.
+ *
+ * 'Invalid' is final, the connection should be closed after a 400 response.
+ */
+class HttpParser {
+public:
+  static constexpr std::size_t DefaultMaxHead = 8192;
+  static constexpr std::size_t DefaultMaxHeaders = 64;
+
+  explicit HttpParser(std::size_t max_head = DefaultMaxHead,
+                      std::size_t max_headers = DefaultMaxHeaders)
+      : _max_head(max_head), _max_headers(max_headers) {}
+
+  HttpResult parse(ByteBuffer &buf, HttpRequest &req);
+
+  /**
+   * The bytes parsed and not consumed yet.
+   */
+  std::size_t parsed() const { return _pos; }
+
+  void consume(ByteBuffer &buf);
+
+  void reset();
+
+private:
+  enum class State {
+    Head,
+    Body,
+    ChunkSize,
+    ChunkData,
+    ChunkEnd,
+    Trailer,
+    End,
+    Invalid
+  };
+
+  HttpResult parse_head(ByteBuffer &buf, HttpRequest &req);
+  bool parse_head_fields(const char *p, const char *end, HttpRequest &req);
+  HttpResult parse_body(const ByteBuffer &buf, HttpRequest &req,
+                        State next);
+  // find the next line from '_pos', returns its length with the '\n', 0 if
+  // it's incomplete.
+  std::size_t next_line(const ByteBuffer &buf);
+
+  HttpResult fail() {
+    _state = State::Invalid;
+    return HttpResult::Invalid;
+  }
+
+  std::size_t _max_head;
+  std::size_t _max_headers;
+  State _state = State::Head;
+  // bytes of the buffer parsed
+  std::size_t _pos = 0;
+  // bytes after '_pos' searched for the end of a line or head
+  std::size_t _scanned = 0;
+  // bytes of the body or chunk to come
+  std::size_t _remaining = 0;
+  // bytes of the trailer
+  std::size_t _trailer = 0;
+};
+
+/**
+ * Response writer, the status line and headers are built into a buffer of
+ * the response, the body is gathered from the caller's memory, so a large
+ * body is never copied when the socket takes it.
+ *
+ * The body slices must live until 'send' returns, it copies into the queue
+ * of the stream what the socket didn't take. Without a 'Content-Length'
+ * header, nor 'chunked', it's set to the size of the body.
+ *
+ * A chunked response can be sent in parts, every 'body' is a chunk, and
+ * the last 'send' terminates the body.
+ */
+class HttpResponse {
+public:
+  HttpResponse() : _head(256), _meta(64) {}
+
+  void start(int status, const char *reason = nullptr, int minor_version = 1);
+
+  void header(const char *name, const char *value);
+  void header(const char *name, const std::string &value);
+  void header(const char *name, std::size_t value);
+
+  /**
+   * Send the body with the chunked transfer coding.
+   */
+  void chunked();
+
+  void body(const void *data, std::size_t len);
+  void body(const std::string &s) { body(s.data(), s.size()); }
+  void body(const BufferView &v);
+
+  /**
+   * Send the response, or the part since the previous 'send', 'last' ends
+   * a chunked body. Return false if the stream is write-blocked afterwards.
+   */
+  bool send(TcpStream &stream, bool last = true);
+
+  /**
+   * Copy the response, or its part, into 'out' instead.
+   */
+  void write_to(ByteBuffer &out, bool last = true);
+
+  static const char *reason(int status);
+
+private:
+  struct Slice {
+    // nullptr for bytes in '_meta', at 'off'
+    const void *data;
+    std::size_t off;
+    std::size_t len;
+  };
+
+  void put_header(const char *name, const char *value, std::size_t len);
+  void add_body(const struct iovec *iov, int iovcnt, std::size_t len);
+  void put_meta(const char *s, std::size_t len);
+  const std::vector<struct iovec> &gather(bool last);
+  // drop the parts gathered, once sent.
+  void clear_parts();
+
+  // the status line and headers, until sent
+  ByteBuffer _head;
+  // chunk sizes and delimiters, between the body slices
+  ByteBuffer _meta;
+  std::vector<Slice> _slices;
+  std::vector<struct iovec> _iov;
+  std::size_t _body_size = 0;
+  bool _head_done = false;
+  bool _has_length = false;
+  bool _chunked = false;
+};
+
+} // namespace bsnet
+
+#endif // BSNET_HTTP_HPP
@@ -0,0 +1,326 @@
+//
+// Created by byao on 1/30/18.
+// Copyright (c) 2018 byao. All rights reserved.
+//
+
+#ifndef BSNET_LOCKFREE_QUEUE_HPP
+#define BSNET_LOCKFREE_QUEUE_HPP
+
+#include "utility.hpp"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace bsnet {
+
+namespace detail {
+
+constexpr std::size_t CacheLine = 64;
+
+inline std::size_t round_pow2(std::size_t n) {
+  std::size_t cap = 2;
+  while (cap < n)
+    cap <<= 1;
+  return cap;
+}
+
+/**
+ * Spin with 'pause' a growing number of times, then yield the cpu.
+ */
+class Backoff {
+public:
+  void wait() {
+    if (_step <= 6) {
+      for (int i = 0; i < (1 << _step); ++i) {
+#if defined(__x86_64__) || defined(__i386__)
+        __builtin_ia32_pause();
+#endif
+      }
+      ++_step;
+    } else {
+      std::this_thread::yield();
+    }
+  }
+
+private:
+  int _step = 0;
+};
+
+template <typename T>
+using Storage = typename std::aligned_storage<sizeof(T), alignof(T)>::type;
+
+} // namespace detail
+
+/**
+ * Bounded lock-free queue of one producer and one consumer.
+ *
+ * Each side owns an index on its own cache line, and caches the other's,
+ * so an operation usually touches no line written by the other thread.
+ * The capacity is rounded up to a power of 2.
+ *
+ * 'try_*' never block, 'put' and 'get' spin and yield until they succeed.
+ */
+template <typename T> class spsc_queue_t : public NonCopyable {
+public:
+  explicit spsc_queue_t(std::size_t capacity)
+      : _mask(detail::round_pow2(capacity) - 1),
+        _slots(new detail::Storage<T>[_mask + 1]) {}
+
+  ~spsc_queue_t() {
+    std::size_t tail = _tail.load(std::memory_order_acquire);
+    for (std::size_t i = _head.load(std::memory_order_relaxed); i != tail; ++i)
+      slot(i)->~T();
+  }
+
+  template <typename... Args> bool try_emplace(Args &&... args) {
+    std::size_t tail = _tail.load(std::memory_order_relaxed);
+    if (tail - _head_cache > _mask) {
+      _head_cache = _head.load(std::memory_order_acquire);
+      if (tail - _head_cache > _mask)
+        return false;
+    }
+    new (&_slots[tail & _mask]) T(std::forward<Args>(args)...);
+    _tail.store(tail + 1, std::memory_order_release);
+    return true;
+  }
+
+  bool try_put(const T &t) { return try_emplace(t); }
+  bool try_put(T &&t) { return try_emplace(std::move(t)); }
+
+  bool try_get(T &t) {
+    std::size_t head = _head.load(std::memory_order_relaxed);
+    if (head == _tail_cache) {
+      _tail_cache = _tail.load(std::memory_order_acquire);
+      if (head == _tail_cache)
+        return false;
+    }
+    T *p = slot(head);
+    t = std::move(*p);
+    p->~T();
+    _head.store(head + 1, std::memory_order_release);
+    return true;
+  }
+
+  void put(T t) {
+    detail::Backoff backoff;
+    while (!try_put(std::move(t)))
+      backoff.wait();
+  }
+
+  void get(T &t) {
+    detail::Backoff backoff;
+    while (!try_get(t))
+      backoff.wait();
+  }
+
+  /**
+   * Put the first elements of [first, first + n) which fit, with a single
+   * publication, returns the number put.
+   */
+  template <typename It> std::size_t try_put_n(It first, std::size_t n) {
+    std::size_t tail = _tail.load(std::memory_order_relaxed);
+    _head_cache = _head.load(std::memory_order_acquire);
+    std::size_t room = _mask + 1 - (tail - _head_cache);
+    n = n < room ? n : room;
+    for (std::size_t i = 0; i < n; ++i, ++first)
+      new (&_slots[(tail + i) & _mask]) T(*first);
+    _tail.store(tail + n, std::memory_order_release);
+    return n;
+  }
+
+  /**
+   * Move up to 'max' elements to 'res', returns the number got.
+   */
+  std::size_t try_get_n(std::vector<T> &res, std::size_t max) {
+    std::size_t head = _head.load(std::memory_order_relaxed);
+    _tail_cache = _tail.load(std::memory_order_acquire);
+    std::size_t n = _tail_cache - head;
+    n = n < max ? n : max;
+    for (std::size_t i = 0; i < n; ++i) {
+      T *p = slot(head + i);
+      res.push_back(std::move(*p));
+      p->~T();
+    }
+    _head.store(head + n, std::memory_order_release);
+    return n;
+  }
+
+  std::size_t size() const {
+    return _tail.load(std::memory_order_acquire) -
+           _head.load(std::memory_order_acquire);
+  }
+  bool empty() const { return size() == 0; }
+  std::size_t capacity() const { return _mask + 1; }
+
+private:
+  T *slot(std::size_t i) { return reinterpret_cast<T *>(&_slots[i & _mask]); }
+
+  const std::size_t _mask;
+  const std::unique_ptr<detail::Storage<T>[]> _slots;
+  char _pad0[detail::CacheLine];
+
+  // consumer side
+  std::atomic<std::size_t> _head{0};
+  std::size_t _tail_cache = 0;
+  char _pad1[detail::CacheLine - sizeof(std::size_t) * 2];
+
+  // producer side
+  std::atomic<std::size_t> _tail{0};
+  std::size_t _head_cache = 0;
+  char _pad2[detail::CacheLine - sizeof(std::size_t) * 2];
+};
+
+/**
+ * Bounded lock-free queue of any number of producers and consumers
+ * (D. Vyukov's bounded MPMC queue).
+ *
+ * Every cell carries a sequence number telling whether it is ready to be
+ * written or read in the current lap, so producers and consumers only
+ * contend on their own index with a single CAS, and never on each other.
+ * The capacity is rounded up to a power of 2.
+ *
+ * 'try_*' never block, 'put' and 'get' spin and yield until they succeed.
+ */
+template <typename T> class mpmc_queue_t : public NonCopyable {
+public:
+  explicit mpmc_queue_t(std::size_t capacity)
+      : _mask(detail::round_pow2(capacity) - 1), _cells(new Cell[_mask + 1]) {
+    for (std::size_t i = 0; i <= _mask; ++i)
+      _cells[i].seq.store(i, std::memory_order_relaxed);
+  }
+
+  ~mpmc_queue_t() {
+    std::size_t tail = _tail.load(std::memory_order_acquire);
+    for (std::size_t i = _head.load(std::memory_order_relaxed); i != tail; ++i)
+      reinterpret_cast<T *>(&_cells[i & _mask].data)->~T();
+  }
+
+  template <typename... Args> bool try_emplace(Args &&... args) {
+    Cell *cell;
+    std::size_t pos = _tail.load(std::memory_order_relaxed);
+    while (true) {
+      cell = &_cells[pos & _mask];
+      std::size_t seq = cell->seq.load(std::memory_order_acquire);
+      auto diff = static_cast<std::intptr_t>(seq) -
+                  static_cast<std::intptr_t>(pos);
+      if (diff == 0) {
+        if (_tail.compare_exchange_weak(pos, pos + 1,
+                                        std::memory_order_relaxed))
+          break;
+      } else if (diff < 0) {
+        return false;
+      } else {
+        pos = _tail.load(std::memory_order_relaxed);
+      }
+    }
+    new (&cell->data) T(std::forward<Args>(args)...);
+    cell->seq.store(pos + 1, std::memory_order_release);
+    return true;
+  }
+
+  bool try_put(const T &t) { return try_emplace(t); }
+  bool try_put(T &&t) { return try_emplace(std::move(t)); }
+
+  bool try_get(T &t) {
+    return try_consume([&t](T &&v) { t = std::move(v); });
+  }
+
+  void put(T t) {
+    detail::Backoff backoff;
+    while (!try_put(std::move(t)))
+      backoff.wait();
+  }
+
+  void get(T &t) {
+    detail::Backoff backoff;
+    while (!try_get(t))
+      backoff.wait();
+  }
+
+  /**
+   * Put the first elements of [first, first + n) which fit, returns the
+   * number put.
+   */
+  template <typename It> std::size_t try_put_n(It first, std::size_t n) {
+    std::size_t i = 0;
+    for (; i < n && try_put(*first); ++i, ++first)
+      ;
+    return i;
+  }
+
+  /**
+   * Move up to 'max' elements to 'res', returns the number got. Elements
+   * are moved straight from the queue, T needn't be default constructible.
+   */
+  std::size_t try_get_n(std::vector<T> &res, std::size_t max) {
+    auto take = [&res](T &&v) { res.push_back(std::move(v)); };
+    std::size_t i = 0;
+    for (; i < max && try_consume(take); ++i)
+      ;
+    return i;
+  }
+
+  /**
+   * A hint, when the queue is used concurrently.
+   */
+  std::size_t size() const {
+    std::size_t tail = _tail.load(std::memory_order_acquire);
+    std::size_t head = _head.load(std::memory_order_acquire);
+    return tail > head ? tail - head : 0;
+  }
+  bool empty() const { return size() == 0; }
+  std::size_t capacity() const { return _mask + 1; }
+
+private:
+  struct Cell {
+    std::atomic<std::size_t> seq;
+    detail::Storage<T> data;
+  };
+
+  /*
+   * Claim the head cell, hand its element to 'f' as an rvalue, then
+   * release the cell to the producers.
+   */
+  template <typename F> bool try_consume(F &&f) {
+    Cell *cell;
+    std::size_t pos = _head.load(std::memory_order_relaxed);
+    while (true) {
+      cell = &_cells[pos & _mask];
+      std::size_t seq = cell->seq.load(std::memory_order_acquire);
+      auto diff = static_cast<std::intptr_t>(seq) -
+                  static_cast<std::intptr_t>(pos + 1);
+      if (diff == 0) {
+        if (_head.compare_exchange_weak(pos, pos + 1,
+                                        std::memory_order_relaxed))
+          break;
+      } else if (diff < 0) {
+        return false;
+      } else {
+        pos = _head.load(std::memory_order_relaxed);
+      }
+    }
+    T *p = reinterpret_cast<T *>(&cell->data);
+    f(std::move(*p));
+    p->~T();
+    cell->seq.store(pos + _mask + 1, std::memory_order_release);
+    return true;
+  }
+
+  const std::size_t _mask;
+  const std::unique_ptr<Cell[]> _cells;
+  char _pad0[detail::CacheLine];
+  std::atomic<std::size_t> _tail{0};
+  char _pad1[detail::CacheLine - sizeof(std::size_t)];
+  std::atomic<std::size_t> _head{0};
+  char _pad2[detail::CacheLine - sizeof(std::size_t)];
+};
+
+} // namespace bsnet
+
+#endif // BSNET_LOCKFREE_QUEUE_HPP
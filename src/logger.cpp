@@ -0,0 +1,172 @@
+//
+// Created by byao on 2/7/18.
+// Copyright (c) 2018 byao. All rights reserved.
+//
+
+#include "logger.hpp"
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <unistd.h>
+
+using namespace std;
+
+namespace bsnet {
+
+constexpr size_t Logger::MaxArgs;
+constexpr size_t Logger::QueueSize;
+constexpr uint32_t Logger::DefaultRateLimit;
+
+atomic<uint8_t> Logger::_level{static_cast<uint8_t>(LogLevel::Warn)};
+atomic<uint32_t> Logger::_rate{Logger::DefaultRateLimit};
+
+// how long the logging thread sleeps when the queue is empty.
+static constexpr chrono::milliseconds FlushInterval(20);
+
+static const char *level_name(LogLevel level) {
+  switch (level) {
+  case LogLevel::Trace:
+    return "TRACE";
+  case LogLevel::Debug:
+    return "DEBUG";
+  case LogLevel::Info:
+    return "INFO";
+  case LogLevel::Warn:
+    return "WARN";
+  case LogLevel::Error:
+    return "ERROR";
+  default:
+    return "";
+  }
+}
+
+static void write_stderr(const char *data, size_t len) {
+  while (len > 0) {
+    ssize_t n = ::write(STDERR_FILENO, data, len);
+    if (n == -1) {
+      if (errno == EINTR)
+        continue;
+      return;
+    }
+    data += n;
+    len -= static_cast<size_t>(n);
+  }
+}
+
+Logger &Logger::instance() {
+  static Logger logger;
+  return logger;
+}
+
+Logger::Logger() : _queue(QueueSize), _sink(write_stderr) {
+  _thread = thread([this] { run(); });
+}
+
+Logger::~Logger() {
+  {
+    lock_guard<mutex> lock(_mutex);
+    _stop = true;
+  }
+  _cond.notify_one();
+  _thread.join();
+  drain();
+}
+
+int64_t Logger::now() {
+  return chrono::duration_cast<chrono::nanoseconds>(
+             chrono::system_clock::now().time_since_epoch())
+      .count();
+}
+
+void Logger::push(const Record &r) {
+  if (!_queue.try_put(r))
+    _dropped.fetch_add(1, memory_order_relaxed);
+}
+
+void Logger::run() {
+  unique_lock<mutex> lock(_mutex);
+  while (!_stop) {
+    lock.unlock();
+    drain();
+    lock.lock();
+    _cond.wait_for(lock, FlushInterval, [this] { return _stop; });
+  }
+}
+
+void Logger::flush() { drain(); }
+
+void Logger::set_sink(Sink sink) {
+  lock_guard<mutex> lock(_drain);
+  _sink = sink ? std::move(sink) : Sink(write_stderr);
+}
+
+void Logger::drain() {
+  lock_guard<mutex> lock(_drain);
+  _out.clear();
+  Record r;
+  while (_queue.try_get(r))
+    format(r);
+  uint64_t dropped = _dropped.load(memory_order_relaxed);
+  if (dropped != _reported_drops) {
+    char line[64];
+    int n = snprintf(line, sizeof(line), "%llu log records dropped\n",
+                     static_cast<unsigned long long>(dropped - _reported_drops));
+    _out.append(line, static_cast<size_t>(n));
+    _reported_drops = dropped;
+  }
+  if (!_out.empty())
+    _sink(_out.data(), _out.size());
+}
+
+void Logger::format(const Record &r) {
+  char line[512];
+  time_t secs = static_cast<time_t>(r.time_ns / 1000000000);
+  struct tm tm;
+  ::localtime_r(&secs, &tm);
+  size_t n = strftime(line, sizeof(line), "%Y-%m-%d %H:%M:%S", &tm);
+  n += static_cast<size_t>(
+      snprintf(line + n, sizeof(line) - n, ".%06lld %-5s ",
+               static_cast<long long>(r.time_ns % 1000000000 / 1000),
+               level_name(r.level)));
+  _out.append(line, n);
+
+  int len = snprintf(line, sizeof(line), r.fmt, r.args[0], r.args[1],
+                     r.args[2], r.args[3]);
+  if (len > 0)
+    _out.append(line, min(static_cast<size_t>(len), sizeof(line) - 1));
+  if (r.err) {
+    _out += ": ";
+    char buf[128];
+    _out += ::strerror_r(r.err, buf, sizeof(buf));
+  }
+  if (r.suppressed) {
+    len = snprintf(line, sizeof(line), " (%u suppressed)", r.suppressed);
+    _out.append(line, static_cast<size_t>(len));
+  }
+  _out += '\n';
+}
+
+bool LogSite::admit(uint32_t &suppressed) {
+  uint32_t rate = Logger::rate_limit();
+  if (rate == 0) {
+    suppressed = _suppressed.exchange(0, memory_order_relaxed);
+    return true;
+  }
+  int64_t sec = chrono::duration_cast<chrono::seconds>(
+                    chrono::steady_clock::now().time_since_epoch())
+                    .count();
+  int64_t window = _window.load(memory_order_relaxed);
+  if (window != sec &&
+      _window.compare_exchange_strong(window, sec, memory_order_relaxed))
+    _count.store(0, memory_order_relaxed);
+  if (_count.fetch_add(1, memory_order_relaxed) < rate) {
+    suppressed = _suppressed.exchange(0, memory_order_relaxed);
+    return true;
+  }
+  _suppressed.fetch_add(1, memory_order_relaxed);
+  return false;
+}
+
+} // namespace bsnet
@@ -0,0 +1,183 @@
+//
+// Created by byao on 2/7/18.
+// Copyright (c) 2018 byao. All rights reserved.
+//
+
+#ifndef BSNET_LOGGER_HPP
+#define BSNET_LOGGER_HPP
+
+#include "lockfree_queue.hpp"
+#include "utility.hpp"
+#include <atomic>
+#include <cerrno>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+
+namespace bsnet {
+
+enum class LogLevel : std::uint8_t { Trace, Debug, Info, Warn, Error, Off };
+
+/**
+ * Asynchronous logger of the library diagnostics.
+ *
+ * A record is a fixed sized binary entry: the format string, up to
+ * 'MaxArgs' integers, errno and a timestamp. It is pushed on a lock-free
+ * bounded queue, the caller never formats, locks or makes a syscall. A
+ * background thread formats the records and hands them to the sink in
+ * batches. A record is dropped, and counted, when the queue is full.
+ *
+ * Use it through 'BSNET_LOG' and 'BSNET_PLOG', which skip the arguments
+ * below the level, and rate limit every call site.
+ */
+class Logger : public NonCopyable {
+public:
+  static constexpr std::size_t MaxArgs = 4;
+  static constexpr std::size_t QueueSize = 4096;
+  static constexpr std::uint32_t DefaultRateLimit = 100;
+
+  /**
+   * Called by the logging thread with a batch of formatted lines, writes to
+   * stderr by default.
+   */
+  using Sink = std::function<void(const char *data, std::size_t len)>;
+
+  struct Record {
+    // since the epoch.
+    std::int64_t time_ns;
+    // a string literal, the arguments are passed as 'long long'.
+    const char *fmt;
+    long long args[MaxArgs];
+    // errno, 0 if not logged.
+    int err;
+    // records of the call site dropped by the rate limit before this one.
+    std::uint32_t suppressed;
+    LogLevel level;
+  };
+
+  static Logger &instance();
+
+  static bool enabled(LogLevel level) {
+    return static_cast<std::uint8_t>(level) >=
+           _level.load(std::memory_order_relaxed);
+  }
+  static void set_level(LogLevel level) {
+    _level.store(static_cast<std::uint8_t>(level), std::memory_order_relaxed);
+  }
+  static LogLevel level() {
+    return static_cast<LogLevel>(_level.load(std::memory_order_relaxed));
+  }
+
+  /**
+   * Records per second of a call site, 0 for no limit.
+   */
+  static void set_rate_limit(std::uint32_t per_second) {
+    _rate.store(per_second, std::memory_order_relaxed);
+  }
+  static std::uint32_t rate_limit() {
+    return _rate.load(std::memory_order_relaxed);
+  }
+
+  ~Logger();
+
+  /**
+   * Queue a record, never blocks.
+   */
+  template <typename... Args>
+  void log(LogLevel level, int err, std::uint32_t suppressed, const char *fmt,
+           Args... args) {
+    static_assert(sizeof...(Args) <= MaxArgs, "too many log arguments");
+    Record r{now(), fmt, {static_cast<long long>(args)...}, err, suppressed,
+             level};
+    push(r);
+  }
+
+  /**
+   * Write the queued records, from the calling thread.
+   */
+  void flush();
+
+  void set_sink(Sink sink);
+
+  /**
+   * Records dropped since the start, the queue was full.
+   */
+  std::uint64_t dropped() const {
+    return _dropped.load(std::memory_order_relaxed);
+  }
+
+private:
+  Logger();
+
+  static std::int64_t now();
+  void push(const Record &r);
+  void run();
+  void drain();
+  void format(const Record &r);
+
+  static std::atomic<std::uint8_t> _level;
+  static std::atomic<std::uint32_t> _rate;
+
+  mpmc_queue_t<Record> _queue;
+  std::atomic<std::uint64_t> _dropped{0};
+
+  // consumer side, the producers never take the locks.
+  std::mutex _drain;
+  Sink _sink;
+  std::string _out;
+  std::uint64_t _reported_drops = 0;
+  std::mutex _mutex;
+  std::condition_variable _cond;
+  bool _stop = false;
+  std::thread _thread;
+};
+
+/**
+ * Rate limit of a call site, a fixed window of a second, racy but only
+ * touched by the records above the level.
+ */
+class LogSite {
+public:
+  /**
+   * Returns false if the record is over the rate, otherwise 'suppressed' is
+   * the records dropped since the last one admitted.
+   */
+  bool admit(std::uint32_t &suppressed);
+
+private:
+  std::atomic<std::int64_t> _window{0};
+  std::atomic<std::uint32_t> _count{0};
+  std::atomic<std::uint32_t> _suppressed{0};
+};
+
+} // namespace bsnet
+
+#define BSNET_LOG_IMPL(level, with_errno, ...)                                 \
+  do {                                                                         \
+    if (::bsnet::Logger::enabled(level)) {                                     \
+      int bsnet_errno = errno;                                                 \
+      static ::bsnet::LogSite bsnet_log_site;                                  \
+      std::uint32_t bsnet_suppressed;                                          \
+      if (bsnet_log_site.admit(bsnet_suppressed))                              \
+        ::bsnet::Logger::instance().log(level, with_errno ? bsnet_errno : 0,   \
+                                        bsnet_suppressed, __VA_ARGS__);        \
+      errno = bsnet_errno;                                                     \
+    }                                                                          \
+  } while (0)
+
+/**
+ * BSNET_LOG(level, "format", integer arguments...), the arguments are
+ * formatted as 'long long', ex. "fd %lld".
+ */
+#define BSNET_LOG(level, ...) BSNET_LOG_IMPL(level, false, __VA_ARGS__)
+
+/**
+ * As 'BSNET_LOG', followed by the description of errno.
+ */
+#define BSNET_PLOG(level, ...) BSNET_LOG_IMPL(level, true, __VA_ARGS__)
+
+#endif // BSNET_LOGGER_HPP
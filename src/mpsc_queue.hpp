@@ -0,0 +1,78 @@
+//
+// Created by byao on 1/24/18.
+// Copyright (c) 2018 byao. All rights reserved.
+//
+
+#ifndef BSNET_MPSC_QUEUE_HPP
+#define BSNET_MPSC_QUEUE_HPP
+
+#include "utility.hpp"
+#include <atomic>
+
+namespace bsnet {
+
+/**
+ * Link embedded in the elements of 'mpsc_queue_t'.
+ */
+struct mpsc_node_t {
+  std::atomic<mpsc_node_t *> _mpsc_next{nullptr};
+};
+
+/**
+ * Intrusive lock-free queue, any number of producers, one consumer
+ * (D. Vyukov's node based MPSC queue).
+ *
+ * T must derive from 'mpsc_node_t', and a node can be in one queue at most
+ * once at a time. Nothing is allocated, 'push' is a single exchange.
+ *
+ * 'pop' may return nullptr while the queue is not empty, if a producer is
+ * between its two steps. The producer completes shortly, a consumer woken
+ * up by the producer after 'push' returns always sees its node.
+ */
+template <typename T> class mpsc_queue_t : public NonCopyable {
+public:
+  mpsc_queue_t() : _head(&_stub), _tail(&_stub) {}
+
+  void push(T *node) noexcept { push_node(node); }
+
+  T *pop() noexcept {
+    mpsc_node_t *tail = _tail;
+    mpsc_node_t *next = tail->_mpsc_next.load(std::memory_order_acquire);
+    if (tail == &_stub) {
+      if (!next)
+        return nullptr;
+      _tail = tail = next;
+      next = next->_mpsc_next.load(std::memory_order_acquire);
+    }
+    if (next) {
+      _tail = next;
+      return static_cast<T *>(tail);
+    }
+    if (tail != _head.load(std::memory_order_acquire))
+      return nullptr;
+
+    // the last node, push the stub behind it so it can be unlinked.
+    push_node(&_stub);
+    next = tail->_mpsc_next.load(std::memory_order_acquire);
+    if (next) {
+      _tail = next;
+      return static_cast<T *>(tail);
+    }
+    return nullptr;
+  }
+
+private:
+  void push_node(mpsc_node_t *node) noexcept {
+    node->_mpsc_next.store(nullptr, std::memory_order_relaxed);
+    mpsc_node_t *prev = _head.exchange(node, std::memory_order_acq_rel);
+    prev->_mpsc_next.store(node, std::memory_order_release);
+  }
+
+  std::atomic<mpsc_node_t *> _head;
+  mpsc_node_t *_tail;
+  mpsc_node_t _stub;
+};
+
+} // namespace bsnet
+
+#endif // BSNET_MPSC_QUEUE_HPP
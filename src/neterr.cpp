@@ -5,6 +5,7 @@ namespace bsnet {
 IMPL_ERR(create_epoll_failed);
 IMPL_ERR(epoll_wait_failed);
 IMPL_ERR(poller_error);
+IMPL_MSG_ERR(registration_error)
 
 IMPL_ERR(socket_error);
 
@@ -15,4 +16,16 @@ IMPL_MSG_ERR(tcp_error)
 // tcp listener
 IMPL_ERR(creating_acceptor_failed);
 IMPL_ERR(binding_error);
+
+// udp socket
+IMPL_MSG_ERR(udp_error)
+
+// unix domain socket
+IMPL_MSG_ERR(unix_error)
+
+// framing codecs
+IMPL_ERR(framing_error)
+
+// tls stream
+IMPL_ERR(tls_error)
 }
\ No newline at end of file
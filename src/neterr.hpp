@@ -1,9 +1,11 @@
 #ifndef BSNET_NETERR_HPP
 #define BSNET_NETERR_HPP
 #include "utility.hpp"
+#include <cerrno>
 #include <cstring>
 #include <stdexcept>
 #include <string>
+#include <system_error>
 
 namespace bsnet {
 DECL_MSG_ERR(invalid_address);
@@ -12,6 +14,7 @@ DECL_MSG_ERR(invalid_address);
 DECL_ERR(poller_error);
 DECL_ERR(create_epoll_failed);
 DECL_ERR(epoll_wait_failed);
+DECL_MSG_ERR(registration_error);
 
 DECL_ERR(socket_error);
 
@@ -22,6 +25,26 @@ DECL_MSG_ERR(tcp_error);
 // tcp listener
 DECL_ERR(creating_acceptor_failed);
 DECL_ERR(binding_error);
+
+// udp socket
+DECL_MSG_ERR(udp_error);
+
+// unix domain socket
+DECL_MSG_ERR(unix_error);
+
+// framing codecs
+DECL_ERR(framing_error);
+
+// tls stream, the message carries the reason from the tls library
+DECL_ERR(tls_error);
+
+/**
+ * errno of the last failed call as an error code, for the non-throwing
+ * overloads.
+ */
+inline std::error_code last_error() noexcept {
+  return std::error_code(errno, std::system_category());
+}
 }
 
 #endif // !BSNET_NETERR_HPP
@@ -1,9 +1,13 @@
 #include "poller_epoll.hpp"
+#include "executor.hpp"
 #include "neterr.hpp"
+#include "probes.hpp"
 #include <cassert>
+#include <memory>
 #include <stdexcept>
 #include <sys/epoll.h>
 #include <sys/eventfd.h>
+#include <thread>
 #include <unistd.h>
 #include <utility>
 #include <vector>
@@ -13,16 +17,164 @@ using namespace std;
 namespace bsnet {
 
 ReadinessQueue::ReadinessQueue(size_t size, int notify)
-    : _rq(size), _notify(notify) {}
+    : _rq(size), _task_pool(TaskPoolSize), _notify(notify) {}
 
-void ReadinessQueue::put(const Event &evt) {
+constexpr std::size_t ReadinessQueue::MaxDrain;
+constexpr std::size_t ReadinessQueue::MaxTasks;
+constexpr std::size_t ReadinessQueue::TaskPoolSize;
+
+ReadinessQueue::~ReadinessQueue() {
+  if (_notify >= 0)
+    ::close(_notify);
+  TaskNode *node;
+  while (_task_pool.try_get(node))
+    delete node;
+}
+
+void ReadinessQueue::notify() {
   static int64_t buf = 1;
-  _rq.put(evt);
   ::write(_notify, &buf, sizeof(buf));
 }
 
+bool ReadinessQueue::put(const Event &evt) {
+  if (!_rq.put(evt))
+    return false;
+  BSNET_PROBE1(rq__put, static_cast<std::uint64_t>(evt.token()));
+  notify();
+  return true;
+}
+
+bool ReadinessQueue::try_put(const Event &evt) {
+  if (!_rq.try_put(evt))
+    return false;
+  BSNET_PROBE1(rq__put, static_cast<std::uint64_t>(evt.token()));
+  notify();
+  return true;
+}
+
+bool ReadinessQueue::put_for(const Event &evt, const Duration &timeout) {
+  if (!_rq.put_for(evt, timeout))
+    return false;
+  BSNET_PROBE1(rq__put, static_cast<std::uint64_t>(evt.token()));
+  notify();
+  return true;
+}
+
+void ReadinessQueue::requeue(const Event &evt) {
+  BSNET_PROBE1(rq__put, static_cast<std::uint64_t>(evt.token()));
+  _local.push_back(evt);
+  notify();
+}
+
+template <typename T>
+bool ReadinessQueue::push(mpsc_queue_t<T> &q, T *node) {
+  // 'close' waits for the producers seeing the queue open.
+  _producers.fetch_add(1);
+  if (_closed.load()) {
+    _producers.fetch_sub(1);
+    return false;
+  }
+  q.push(node);
+  _producers.fetch_sub(1, memory_order_release);
+  notify();
+  return true;
+}
+
+bool ReadinessQueue::enqueue(ReadinessNode *node) {
+  node->retain();
+  // read before the push, the poller may release the node right after.
+  std::uint64_t token = node->_token.load(memory_order_relaxed);
+  if (push(_nodes, node)) {
+    BSNET_PROBE1(rq__put, token);
+    return true;
+  }
+  node->release();
+  return false;
+}
+
+bool ReadinessQueue::post(Task &&task) {
+  TaskNode *node = nullptr;
+  if (!_task_pool.try_get(node))
+    node = new TaskNode();
+  node->task = std::move(task);
+  if (push(_tasks, node))
+    return true;
+  recycle(node);
+  return false;
+}
+
+void ReadinessQueue::recycle(TaskNode *node) noexcept {
+  node->task.reset();
+  if (!_task_pool.try_put(node))
+    delete node;
+}
+
+size_t ReadinessQueue::run_tasks() {
+  size_t n = 0;
+  for (; n < MaxTasks; ++n) {
+    TaskNode *node = _tasks.pop();
+    if (!node)
+      return n;
+    try {
+      node->task();
+    } catch (...) {
+      recycle(node);
+      // the rest runs on the next poll.
+      notify();
+      throw;
+    }
+    recycle(node);
+  }
+  notify();
+  return n;
+}
+
+void ReadinessQueue::close() {
+  if (_closed.exchange(true))
+    return;
+  _rq.close();
+  while (_producers.load(memory_order_acquire))
+    this_thread::yield();
+  while (ReadinessNode *node = _nodes.pop())
+    node->release();
+  while (TaskNode *node = _tasks.pop())
+    recycle(node);
+}
+
 std::size_t ReadinessQueue::get_all(std::vector<Event> &res) {
-  return _rq.get_all(res);
+  std::size_t n = _local.size();
+  res.insert(res.end(), _local.begin(), _local.end());
+  _local.clear();
+  n += _rq.try_get_all(res);
+
+  std::size_t i = 0;
+  for (; i < MaxDrain; ++i) {
+    ReadinessNode *node = _nodes.pop();
+    if (!node)
+      break;
+    // a producer setting readiness from now on queues the node again.
+    node->_queued.store(false);
+    Event evt;
+    bool requeue = false;
+    if (node->dequeue(evt, requeue)) {
+      res.push_back(evt);
+      ++n;
+    }
+    if (requeue)
+      _requeue.push_back(node);
+    else
+      node->release();
+  }
+  if (i == MaxDrain)
+    notify();
+
+  for (ReadinessNode *node : _requeue) {
+    if (!node->_queued.exchange(true))
+      enqueue(node);
+    node->release();
+  }
+  _requeue.clear();
+  return n;
 }
 
 Guard<Poller> Poller::new_instance() {
@@ -35,24 +187,36 @@ void Poller::swap(Poller &other) noexcept {
   swap(_epfd, other._epfd);
   swap(_rq_notify, other._rq_notify);
   swap(_rq, other._rq);
+#ifdef BSNET_POLLER_STATS
+  swap(_stats, other._stats);
+#endif
 }
 
 Poller::Poller() {
+#ifdef BSNET_POLLER_STATS
+  _stats.reset(new PollerCounters());
+#endif
   _epfd = ::epoll_create1(EPOLL_CLOEXEC);
   if (_epfd == -1)
     throw create_epoll_failed();
 
   _rq_notify = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
-  if (_rq_notify == -1)
+  if (_rq_notify == -1) {
+    ::close(_epfd);
     throw create_epoll_failed();
+  }
 
+  // the queue owns the eventfd from now on.
   _rq = new ReadinessQueue(1024, _rq_notify);
 
   struct epoll_event evt;
   evt.events = EPOLLIN | EPOLLET;
-  evt.data.u64 = 0;
-  if (-1 == ::epoll_ctl(_epfd, EPOLL_CTL_ADD, _rq_notify, &evt))
+  evt.data.u64 = static_cast<uint64_t>(Token(0));
+  if (-1 == ::epoll_ctl(_epfd, EPOLL_CTL_ADD, _rq_notify, &evt)) {
+    ::close(_epfd);
+    _rq->release();
     throw create_epoll_failed();
+  }
 }
 
 Poller::Poller(Poller &&other) noexcept
@@ -64,10 +228,10 @@ Poller::~Poller() {
   if (_epfd > 0) {
     ::close(_epfd);
   }
-  if (_rq_notify > 0) {
-    ::close(_rq_notify);
+  if (_rq) {
+    _rq->close();
+    _rq->release();
   }
-  delete _rq;
 }
 
 void Poller::register_evt(Evented &ev, Token tok, Ready interest,
@@ -82,31 +246,86 @@ void Poller::reregister_evt(Evented &ev, Token tok, Ready interest,
 
 void Poller::deregister_evt(Evented &ev) { ev.deregister_on(*this); }
 
+void Poller::register_evt(Evented &ev, Token tok, Ready interest, PollOpt opts,
+                          error_code &ec) noexcept {
+  ev.register_on(*this, tok, interest, opts, ec);
+}
+
+void Poller::reregister_evt(Evented &ev, Token tok, Ready interest,
+                            PollOpt opts, error_code &ec) noexcept {
+  ev.reregister_on(*this, tok, interest, opts, ec);
+}
+
+void Poller::deregister_evt(Evented &ev, error_code &ec) noexcept {
+  ev.deregister_on(*this, ec);
+}
+
+Executor Poller::executor() { return Executor(_rq); }
+
 int Poller::poll(vector<Event> &events, const Duration *timeout) {
+  error_code ec;
+  int n = poll(events, ec, timeout);
+  if (ec)
+    throw epoll_wait_failed();
+  return n;
+}
+
+int Poller::poll(vector<Event> &events, error_code &ec,
+                 const Duration *timeout) noexcept {
   static_assert(sizeof(Event) == sizeof(epoll_event),
                 "Event and epoll_event not match");
   int tm = timeout ? static_cast<int>(timeout->count()) : -1;
+  ec.clear();
+  BSNET_PROBE2(poll__entry, _epfd, tm);
   while (true) {
+#ifdef BSNET_POLLER_STATS
+    auto start = _stats->before_wait();
+#endif
     int num_evt = ::epoll_wait(
         _epfd, reinterpret_cast<struct epoll_event *>(events.data()),
         events.size(), tm);
+#ifdef BSNET_POLLER_STATS
+    if (num_evt >= 0) {
+      bool wakeup = false;
+      for (int i = 0; i < num_evt && !wakeup; ++i)
+        wakeup = events[i].token() == Token(0);
+      _stats->after_wait(start, num_evt, wakeup);
+    }
+#endif
 
     if (num_evt == -1) {
-      if (errno == EINTR) {
+      if (errno == EINTR)
         continue;
-      } else {
-        throw epoll_wait_failed();
-      }
-    } else
-      return num_evt;
+      ec = last_error();
+      BSNET_PROBE2(poll__return, _epfd, -1);
+      return 0;
+    }
+    BSNET_PROBE2(poll__return, _epfd, num_evt);
+    return num_evt;
   }
 }
 
 int Poller::user_poll(vector<Event> &events) {
-  assert(_rq->size() > 0);
-  int n = static_cast<int>(_rq->get_all(events));
+  // reset the notification first, so an event queued while draining wakes
+  // up the next poll.
   int64_t v;
   ::read(_rq_notify, &v, sizeof(v));
-  return n;
+#ifdef BSNET_POLLER_STATS
+  size_t tasks = _rq->run_tasks();
+  size_t n = _rq->get_all(events);
+  _stats->user_poll(n, tasks);
+  return static_cast<int>(n);
+#else
+  _rq->run_tasks();
+  return static_cast<int>(_rq->get_all(events));
+#endif
+}
+
+PollerStats Poller::stats() const {
+#ifdef BSNET_POLLER_STATS
+  if (_stats)
+    return _stats->snapshot();
+#endif
+  return PollerStats();
 }
 }
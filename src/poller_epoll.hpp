@@ -3,36 +3,163 @@
 
 #include "blocking_queue.hpp"
 #include "event.hpp"
+#include "lockfree_queue.hpp"
+#include "mpsc_queue.hpp"
+#include "poller_stats.hpp"
+#include "task.hpp"
 #include "utility.hpp"
+#include <atomic>
 #include <cassert>
 #include <chrono>
+#include <cstdint>
 #include <cstring>
+#include <memory>
 #include <stdexcept>
 #include <unistd.h>
 #include <vector>
 
 namespace bsnet {
 
+/**
+ * A user space event source queued in a 'ReadinessQueue' instead of an
+ * event, so it is queued at most once however often it becomes ready, and
+ * its event is built when the poller dequeues it.
+ */
+class ReadinessNode : public mpsc_node_t, public NonCopyable {
+public:
+  friend class ReadinessQueue;
+
+  virtual ~ReadinessNode() noexcept = default;
+
+  void retain() noexcept { _refs.fetch_add(1, std::memory_order_relaxed); }
+  void release() noexcept {
+    if (_refs.fetch_sub(1, std::memory_order_acq_rel) == 1)
+      delete this;
+  }
+
+protected:
+  /**
+   * Called by the poller thread, the node is already marked unqueued.
+   * returns false if there is no event, sets 'requeue' if the node should be
+   * queued again, ex. a level triggered source which is still ready.
+   */
+  virtual bool dequeue(Event &evt, bool &requeue) = 0;
+
+  // set from the transition to queued until dequeued.
+  std::atomic<bool> _queued{false};
+  // the token of its events, traced when it is queued.
+  std::atomic<std::uint64_t> _token{0};
+
+private:
+  std::atomic<std::size_t> _refs{1};
+};
+
+/**
+ * ReadinessQueue carries user space events to a poller, it is shared by the
+ * poller and the registrations on it, and freed by the last of them. It owns
+ * the notification eventfd, so a late producer never writes to a descriptor
+ * reused by something else.
+ */
 class ReadinessQueue {
 public:
   ReadinessQueue(std::size_t size, int notify);
+  ~ReadinessQueue();
+
+  void retain() noexcept { _refs.fetch_add(1, std::memory_order_relaxed); }
+  void release() noexcept {
+    if (_refs.fetch_sub(1, std::memory_order_acq_rel) == 1)
+      delete this;
+  }
 
-  template <typename... Args> void emplace(Args &&... args) {
-    static int64_t buf = 1;
-    _rq.emplace(std::forward<Args>(args)...);
-    ssize_t n = ::write(_notify, &buf, sizeof(buf));
-    assert(n == sizeof(buf));
+  /**
+   * Queue an event, waits while the queue is full.
+   * returns false if the poller is gone.
+   */
+  template <typename... Args> bool emplace(Args &&... args) {
+    if (!_rq.emplace(std::forward<Args>(args)...))
+      return false;
+    notify();
+    return true;
   }
 
-  void put(const Event &evt);
+  bool put(const Event &evt);
+
+  /**
+   * Returns false if the queue is full, or the poller is gone.
+   */
+  bool try_put(const Event &evt);
+
+  /**
+   * Returns false if the queue is still full after 'timeout', or the poller
+   * is gone.
+   */
+  bool put_for(const Event &evt, const Duration &timeout);
+
+  /**
+   * Queue an event from the poller thread itself, ex. a stream which ran out
+   * of its read budget, it never blocks.
+   */
+  void requeue(const Event &evt);
+
+  /**
+   * Queue a node which has been marked queued, it never blocks, the queue
+   * holds a reference of the node until it is dequeued.
+   * returns false if the poller is gone.
+   */
+  bool enqueue(ReadinessNode *node);
+
+  /**
+   * Queue a task to run on the poller thread, it never blocks. The nodes of
+   * the tasks run are recycled, a post only allocates while more tasks are
+   * in flight than the pool holds.
+   * returns false if the poller is gone.
+   */
+  bool post(Task &&task);
+
+  /**
+   * Run the queued tasks, 'MaxTasks' at most, on the poller thread.
+   */
+  std::size_t run_tasks();
+
+  /**
+   * Stop accepting events, nodes and tasks, drop the queued nodes and
+   * tasks, and wake up the producers waiting, called by the poller.
+   */
+  void close();
+
   std::size_t get_all(std::vector<Event> &res);
-  std::size_t size() const { return _rq.size(); }
+  std::size_t size() const { return _rq.size() + _local.size(); }
 
 private:
+  // nodes dequeued in a call at most, so busy producers can't hold it.
+  static constexpr std::size_t MaxDrain = 1024;
+  static constexpr std::size_t MaxTasks = 1024;
+  static constexpr std::size_t TaskPoolSize = 256;
+
+  struct TaskNode : public mpsc_node_t {
+    Task task;
+  };
+
+  template <typename T> bool push(mpsc_queue_t<T> &q, T *node);
+  void notify();
+  // drop the task, and keep the node for the next post.
+  void recycle(TaskNode *node) noexcept;
+
   bounded_blocking_queue_t<Event> _rq;
+  mpsc_queue_t<ReadinessNode> _nodes;
+  mpsc_queue_t<TaskNode> _tasks;
+  mpmc_queue_t<TaskNode *> _task_pool;
+  std::atomic<std::size_t> _producers{0};
+  std::atomic<bool> _closed{false};
+  // only touched by the poller thread.
+  std::vector<Event> _local;
+  std::vector<ReadinessNode *> _requeue;
   int _notify;
+  std::atomic<std::size_t> _refs{1};
 };
 
+class Executor;
+
 class Poller {
 public:
   friend class Registration;
@@ -49,9 +176,40 @@ public:
   void reregister_evt(Evented &ev, Token tok, Ready interest, PollOpt opts);
   void deregister_evt(Evented &ev);
 
+  /**
+   * Non-throwing registration, the failure is reported in 'ec'.
+   */
+  void register_evt(Evented &ev, Token tok, Ready interest, PollOpt opts,
+                    std::error_code &ec) noexcept;
+  void reregister_evt(Evented &ev, Token tok, Ready interest, PollOpt opts,
+                      std::error_code &ec) noexcept;
+  void deregister_evt(Evented &ev, std::error_code &ec) noexcept;
+
   int poll(std::vector<Event> &events, const Duration *timeout = nullptr);
+
+  /**
+   * Returns 0 and sets 'ec' if epoll_wait fails.
+   */
+  int poll(std::vector<Event> &events, std::error_code &ec,
+           const Duration *timeout = nullptr) noexcept;
+
+  /**
+   * Called when the event of token 0 is polled, runs the tasks posted to
+   * the executor, and gets the user space events.
+   */
   int user_poll(std::vector<Event> &events);
 
+  /**
+   * A handle to post tasks running on the poller thread, from any thread.
+   */
+  Executor executor();
+
+  /**
+   * Counters since the poller was created, can be called from any thread,
+   * all zero unless built with 'BSNET_POLLER_STATS'.
+   */
+  PollerStats stats() const;
+
 private:
   Poller();
   int fd() const { return _epfd; }
@@ -60,6 +218,9 @@ private:
   int _epfd;
   int _rq_notify;
   ReadinessQueue *_rq;
+#ifdef BSNET_POLLER_STATS
+  std::unique_ptr<PollerCounters> _stats;
+#endif
 };
 }
 
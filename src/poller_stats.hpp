@@ -0,0 +1,157 @@
+//
+// Created by byao on 2/5/18.
+// Copyright (c) 2018 byao. All rights reserved.
+//
+
+#ifndef BSNET_POLLER_STATS_HPP
+#define BSNET_POLLER_STATS_HPP
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+namespace bsnet {
+
+/**
+ * A snapshot of the counters of a poller.
+ *
+ * The counters are collected only when the library is built with
+ * 'BSNET_POLLER_STATS' defined (cmake -DBSNET_POLLER_STATS=ON), otherwise
+ * the snapshot is all zero and the poller records nothing.
+ */
+struct PollerStats {
+  // 'EventBuckets[i]' counts the polls returning [2^(i-1), 2^i) events, the
+  // first one the polls returning none, the last one 2^(N-2) and more.
+  static constexpr std::size_t EventBuckets = 12;
+
+  static constexpr bool enabled() {
+#ifdef BSNET_POLLER_STATS
+    return true;
+#else
+    return false;
+#endif
+  }
+
+  static std::size_t bucket(std::uint64_t events) {
+    if (events == 0)
+      return 0;
+    std::size_t b = 64 - __builtin_clzll(events);
+    return b < EventBuckets ? b : EventBuckets - 1;
+  }
+
+  // calls of 'poll', and the ones timing out without an event.
+  std::uint64_t polls = 0;
+  std::uint64_t timeouts = 0;
+  std::uint64_t events = 0;
+  std::uint64_t events_hist[EventBuckets] = {};
+  // time blocked in epoll_wait, and spent between two polls.
+  std::uint64_t wait_ns = 0;
+  std::uint64_t busy_ns = 0;
+  // polled events of the readiness queue eventfd.
+  std::uint64_t wakeups = 0;
+  // calls of 'user_poll', the events and tasks they took from the
+  // readiness queue, and the most events taken by a single call.
+  std::uint64_t user_polls = 0;
+  std::uint64_t user_events = 0;
+  std::uint64_t tasks = 0;
+  std::uint64_t max_user_events = 0;
+};
+
+#ifdef BSNET_POLLER_STATS
+
+/**
+ * Counters of a poller, written by the poller thread only and read by
+ * 'snapshot' from any thread.
+ *
+ * A single writer needs no read-modify-write, every update is a relaxed
+ * load and store of a counter on the poller's own cache lines, which costs
+ * the same as a plain increment.
+ */
+class PollerCounters {
+public:
+  using Clock = std::chrono::steady_clock;
+
+  PollerCounters() = default;
+  PollerCounters(const PollerCounters &) = delete;
+  PollerCounters &operator=(const PollerCounters &) = delete;
+
+  Clock::time_point before_wait() {
+    Clock::time_point now = Clock::now();
+    if (_last_return != Clock::time_point())
+      add(_busy_ns, nanos(now - _last_return));
+    return now;
+  }
+
+  void after_wait(Clock::time_point start, int num_evt, bool wakeup) {
+    _last_return = Clock::now();
+    auto n = static_cast<std::uint64_t>(num_evt);
+    add(_wait_ns, nanos(_last_return - start));
+    add(_polls, 1);
+    add(_events, n);
+    add(_events_hist[PollerStats::bucket(n)], 1);
+    if (n == 0)
+      add(_timeouts, 1);
+    if (wakeup)
+      add(_wakeups, 1);
+  }
+
+  void user_poll(std::size_t events, std::size_t tasks) {
+    add(_user_polls, 1);
+    add(_user_events, events);
+    add(_tasks, tasks);
+    if (events > _max_user_events.load(std::memory_order_relaxed))
+      _max_user_events.store(events, std::memory_order_relaxed);
+  }
+
+  PollerStats snapshot() const {
+    PollerStats s;
+    s.polls = get(_polls);
+    s.timeouts = get(_timeouts);
+    s.events = get(_events);
+    for (std::size_t i = 0; i < PollerStats::EventBuckets; ++i)
+      s.events_hist[i] = get(_events_hist[i]);
+    s.wait_ns = get(_wait_ns);
+    s.busy_ns = get(_busy_ns);
+    s.wakeups = get(_wakeups);
+    s.user_polls = get(_user_polls);
+    s.user_events = get(_user_events);
+    s.tasks = get(_tasks);
+    s.max_user_events = get(_max_user_events);
+    return s;
+  }
+
+private:
+  using Counter = std::atomic<std::uint64_t>;
+
+  static void add(Counter &c, std::uint64_t n) {
+    c.store(c.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+  }
+  static std::uint64_t get(const Counter &c) {
+    return c.load(std::memory_order_relaxed);
+  }
+  static std::uint64_t nanos(Clock::duration d) {
+    return static_cast<std::uint64_t>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(d).count());
+  }
+
+  Counter _polls{0};
+  Counter _timeouts{0};
+  Counter _events{0};
+  Counter _events_hist[PollerStats::EventBuckets] = {};
+  Counter _wait_ns{0};
+  Counter _busy_ns{0};
+  Counter _wakeups{0};
+  Counter _user_polls{0};
+  Counter _user_events{0};
+  Counter _tasks{0};
+  Counter _max_user_events{0};
+  // poller thread only.
+  Clock::time_point _last_return;
+};
+
+#endif // BSNET_POLLER_STATS
+
+} // namespace bsnet
+
+#endif // BSNET_POLLER_STATS_HPP
@@ -0,0 +1,53 @@
+//
+// Created by byao on 2/9/18.
+// Copyright (c) 2018 byao. All rights reserved.
+//
+
+#ifndef BSNET_PROBES_HPP
+#define BSNET_PROBES_HPP
+
+/**
+ * Statically defined tracepoints (USDT) of the provider 'bsnet'.
+ *
+ * A probe is a single nop in the code and a note in the binary, it costs
+ * nothing until a tracer attaches, ex.
+ *   bpftrace -l 'usdt:/path/to/server:bsnet:*'
+ *   bpftrace -e 'usdt:/path/to/server:bsnet:read { @[arg0] = sum(arg1); }'
+ *
+ * Probes, and their arguments:
+ *   poll__entry       epoll fd, timeout in ms (-1 for none)
+ *   poll__return      epoll fd, events returned
+ *   rq__put           token of the event queued to a readiness queue
+ *   accept            listening fd, accepted fd
+ *   read              fd, bytes read or -1
+ *   write             fd, bytes written or -1
+ *   buffer__expand    capacity before, capacity after
+ *
+ * They are compiled in when <sys/sdt.h> is found (systemtap-sdt-dev), and
+ * 'BSNET_NO_PROBES' is not defined, otherwise they expand to nothing.
+ */
+
+#if !defined(BSNET_NO_PROBES) && defined(__has_include)
+#if __has_include(<sys/sdt.h>)
+#include <sys/sdt.h>
+#define BSNET_HAVE_PROBES 1
+#endif
+#endif
+
+#ifdef BSNET_HAVE_PROBES
+#define BSNET_PROBE1(name, a) DTRACE_PROBE1(bsnet, name, a)
+#define BSNET_PROBE2(name, a, b) DTRACE_PROBE2(bsnet, name, a, b)
+#else
+// the arguments are not evaluated.
+#define BSNET_PROBE1(name, a)                                                  \
+  do {                                                                         \
+    (void)sizeof(a);                                                           \
+  } while (0)
+#define BSNET_PROBE2(name, a, b)                                               \
+  do {                                                                         \
+    (void)sizeof(a);                                                           \
+    (void)sizeof(b);                                                           \
+  } while (0)
+#endif
+
+#endif // BSNET_PROBES_HPP
@@ -1,59 +1,115 @@
 #include "registration.hpp"
+#include "neterr.hpp"
 #include "poller_epoll.hpp"
 
 namespace bsnet {
 
-void Registration::InnerRegistration::register_on(Poller &poller, Token tok,
-                                                  Ready interest,
-                                                  PollOpt opts) {
-  _rq = Registration::rq(poller);
-  _evt.set_events(interest, opts);
-  _evt.set_token(tok);
+Registration::InnerRegistration::~InnerRegistration() noexcept {
+  ReadinessQueue *q = _rq.load(std::memory_order_acquire);
+  if (q)
+    q->release();
 }
 
-void Registration::InnerRegistration::reregister_on(Poller &poller, Token tok,
-                                                    Ready interest,
-                                                    PollOpt opts) {
-  _rq = Registration::rq(poller);
-  _evt.set_events(interest, opts);
-  _evt.set_token(tok);
-}
+bool Registration::InnerRegistration::update(Poller &poller, Token tok,
+                                             Ready interest, PollOpt opts) {
+  ReadinessQueue *q = Registration::rq(poller);
+  ReadinessQueue *cur = nullptr;
+  if (_rq.compare_exchange_strong(cur, q, std::memory_order_acq_rel))
+    q->retain();
+  else if (cur != q)
+    return false;
 
-void Registration::InnerRegistration::deregister_on(Poller &poller) {
-  _rq = nullptr;
+  // the token first, a producer seeing the new interest sees the new token.
+  _token.store(static_cast<std::uint64_t>(tok), std::memory_order_relaxed);
+  _interest.store(static_cast<std::uint32_t>(interest) |
+                      static_cast<std::uint32_t>(opts),
+                  std::memory_order_release);
+  return true;
 }
 
 void Registration::InnerRegistration::set_readiness(Ready r) {
-  Ready evts = _evt.readiness();
-  if (evts.contains(r) && _rq) {
-    _rq->emplace(r, PollOpt::empty(), _evt.token());
+  auto ready = static_cast<std::uint32_t>(r);
+  _readiness.store(ready, std::memory_order_release);
+
+  std::uint32_t events = ready & _interest.load(std::memory_order_acquire);
+  if (!events)
+    return;
+  ReadinessQueue *q = _rq.load(std::memory_order_acquire);
+  if (!q)
+    return;
 
-    if (evts.contains(static_cast<uint32_t>(PollOpt::oneshot()))) {
-      _rq = nullptr;
-    }
-  }
+  // only the transition to queued enqueues, others merge their bits.
+  _pending.fetch_or(events);
+  if (!_queued.exchange(true))
+    q->enqueue(this);
+}
+
+bool Registration::InnerRegistration::dequeue(Event &evt, bool &requeue) {
+  static const auto edge = static_cast<std::uint32_t>(PollOpt::edge());
+  static const auto oneshot = static_cast<std::uint32_t>(PollOpt::oneshot());
+
+  std::uint32_t interest = _interest.load(std::memory_order_acquire);
+  std::uint32_t ready = _pending.exchange(0);
+  bool level = !(interest & (edge | oneshot));
+  if (level)
+    ready |= _readiness.load(std::memory_order_acquire);
+  ready &= interest;
+  if (!ready)
+    return false;
+
+  if ((interest & oneshot) &&
+      !_interest.compare_exchange_strong(interest, 0,
+                                         std::memory_order_acq_rel))
+    return false;
+
+  evt = Event(Ready(ready), PollOpt::empty(),
+              Token(_token.load(std::memory_order_relaxed)));
+  requeue = level && (_readiness.load(std::memory_order_acquire) & interest);
+  return true;
 }
 
 Registration::Registration() : _inner_node(new InnerRegistration()) {}
 
+Registration::~Registration() noexcept {
+  _inner_node->clear_interest();
+  _inner_node->release();
+}
+
 SetReadiness Registration::new_set_readiness() const {
-  SetReadiness sr;
-  sr._inner_node = _inner_node;
-  return sr;
+  _inner_node->retain();
+  return SetReadiness(_inner_node);
 }
 
 void Registration::register_on(Poller &poller, Token tok, Ready interest,
                                PollOpt opts) {
-  _inner_node->register_on(poller, tok, interest, opts);
+  if (!_inner_node->update(poller, tok, interest, opts))
+    throw registration_error("registered on another poller");
 }
 
 void Registration::reregister_on(Poller &poller, Token tok, Ready interest,
                                  PollOpt opts) {
-  _inner_node->reregister_on(poller, tok, interest, opts);
+  register_on(poller, tok, interest, opts);
+}
+
+void Registration::deregister_on(Poller &) {
+  _inner_node->clear_interest();
 }
 
-void Registration::deregister_on(Poller &poller) {
-  _inner_node->deregister_on(poller);
+void Registration::register_on(Poller &poller, Token tok, Ready interest,
+                               PollOpt opts, std::error_code &ec) noexcept {
+  ec.clear();
+  if (!_inner_node->update(poller, tok, interest, opts))
+    ec = std::make_error_code(std::errc::invalid_argument);
+}
+
+void Registration::reregister_on(Poller &poller, Token tok, Ready interest,
+                                 PollOpt opts, std::error_code &ec) noexcept {
+  register_on(poller, tok, interest, opts, ec);
+}
+
+void Registration::deregister_on(Poller &, std::error_code &ec) noexcept {
+  ec.clear();
+  _inner_node->clear_interest();
 }
 
 void SetReadiness::swap(SetReadiness &other) noexcept {
@@ -61,12 +117,23 @@ void SetReadiness::swap(SetReadiness &other) noexcept {
   swap(_inner_node, other._inner_node);
 }
 
+SetReadiness::SetReadiness(const SetReadiness &other) noexcept
+    : _inner_node(other._inner_node) {
+  if (_inner_node)
+    _inner_node->retain();
+}
+
 SetReadiness::SetReadiness(SetReadiness &&other) noexcept
     : _inner_node(nullptr) {
   this->swap(other);
 }
 
-SetReadiness::~SetReadiness() noexcept { delete _inner_node; }
+SetReadiness::~SetReadiness() noexcept {
+  if (_inner_node)
+    _inner_node->release();
+}
 
 void SetReadiness::set_readiness(Ready r) { _inner_node->set_readiness(r); }
-}
\ No newline at end of file
+
+Ready SetReadiness::readiness() const { return _inner_node->readiness(); }
+}
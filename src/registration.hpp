@@ -9,29 +9,62 @@
 #include "event.hpp"
 #include "poller_epoll.hpp"
 #include "utility.hpp"
+#include <atomic>
+#include <cstdint>
 
 namespace bsnet {
 
 class ReadinessQueue;
 class SetReadiness;
 
+/**
+ * Registration is a user space 'Evented', its readiness is set by the
+ * 'SetReadiness' handles it creates, from any thread, and delivered by
+ * 'Poller::user_poll'.
+ *
+ * The state is held in a node shared by the registration and all its
+ * handles, and freed by the last of them, in any order. Handles are cheap
+ * to copy, and setting readiness takes no lock.
+ *
+ * Readiness is coalesced: the node is queued on the transition to ready,
+ * bits set until the poller dequeues it are merged into one event. The
+ * options are honored when the node is dequeued:
+ *   - edge, the bits set since the last event are reported once.
+ *   - level, the node is reported on every 'user_poll' while the current
+ *     readiness intersects the interest, set 'Ready::empty()' to clear it.
+ *   - oneshot, the first event disarms the registration until reregistered.
+ *
+ * A registration can only be registered on one poller during its life,
+ * registering it on another one throws 'registration_error'.
+ */
 class Registration : public Evented, public NonCopyable {
-  struct InnerRegistration : public Evented {
-    friend class Registration;
-    friend class SetReadiness;
+  class InnerRegistration : public ReadinessNode {
+  public:
+    InnerRegistration() = default;
+    ~InnerRegistration() noexcept override;
 
-    void register_on(Poller &poller, Token tok, Ready interest,
-                     PollOpt opts) override;
-    void reregister_on(Poller &poller, Token tok, Ready interest,
-                       PollOpt opts) override;
-    void deregister_on(Poller &poller) override;
-    ~InnerRegistration() noexcept override = default;
+    // returns false if registered on another poller.
+    bool update(Poller &poller, Token tok, Ready interest, PollOpt opts);
+    void clear_interest() noexcept {
+      _interest.store(0, std::memory_order_release);
+    }
 
     void set_readiness(Ready r);
+    Ready readiness() const {
+      return Ready(_readiness.load(std::memory_order_acquire));
+    }
+
+  protected:
+    bool dequeue(Event &evt, bool &requeue) override;
 
   private:
-    ReadinessQueue *_rq;
-    Event _evt;
+    // set once, the node holds a reference of the queue.
+    std::atomic<ReadinessQueue *> _rq{nullptr};
+    // interest and options, like 'epoll_event::events', 0 when disarmed.
+    std::atomic<std::uint32_t> _interest{0};
+    std::atomic<std::uint32_t> _readiness{0};
+    // interesting bits set since the last event.
+    std::atomic<std::uint32_t> _pending{0};
   };
 
   static inline ReadinessQueue *rq(Poller &poller) { return poller.rq(); }
@@ -40,6 +73,8 @@ public:
   friend class SetReadiness;
 
   Registration();
+  ~Registration() noexcept override;
+
   SetReadiness new_set_readiness() const;
 
   void register_on(Poller &poller, Token tok, Ready interest,
@@ -47,25 +82,49 @@ public:
   void reregister_on(Poller &poller, Token tok, Ready interest,
                      PollOpt opts) override;
   void deregister_on(Poller &poller) override;
-  ~Registration() noexcept override = default;
+
+  void register_on(Poller &poller, Token tok, Ready interest, PollOpt opts,
+                   std::error_code &ec) noexcept override;
+  void reregister_on(Poller &poller, Token tok, Ready interest, PollOpt opts,
+                     std::error_code &ec) noexcept override;
+  void deregister_on(Poller &poller, std::error_code &ec) noexcept override;
 
 private:
   InnerRegistration *_inner_node;
 };
 
-class SetReadiness : public NonCopyable {
+class SetReadiness {
 public:
   friend class Registration;
+  SetReadiness(const SetReadiness &other) noexcept;
   SetReadiness(SetReadiness &&other) noexcept;
+  SetReadiness &operator=(SetReadiness other) noexcept {
+    this->swap(other);
+    return *this;
+  }
   ~SetReadiness() noexcept;
   void swap(SetReadiness &other) noexcept;
 
+  /**
+   * Set the current readiness, an event is delivered if it intersects the
+   * interest of the registration.
+   */
   void set_readiness(Ready r);
 
+  /**
+   * The readiness last set.
+   */
+  Ready readiness() const;
+
 private:
-  SetReadiness() = default;
+  explicit SetReadiness(Registration::InnerRegistration *node)
+      : _inner_node(node) {}
   Registration::InnerRegistration *_inner_node;
 };
+
+inline void swap(SetReadiness &lhs, SetReadiness &rhs) noexcept {
+  lhs.swap(rhs);
+}
 }
 
-#endif // !BSNET_REGISTRATION_HPP
\ No newline at end of file
+#endif // !BSNET_REGISTRATION_HPP
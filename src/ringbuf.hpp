@@ -6,6 +6,7 @@
 #ifndef BSNET_BUFFER_HPP
 #define BSNET_BUFFER_HPP
 
+#include "probes.hpp"
 #include <cassert>
 #include <cstdint>
 #include <cstring>
@@ -31,11 +32,15 @@ public:
   friend class TcpStream;
   friend class ByteBuffer;
 
+  /**
+   * A buffer of capacity 0 allocates nothing until it grows, ex. the queue
+   * of a stream which never had to queue.
+   */
   explicit ringbuf_t(std::size_t cap)
-      : _data(new value_type[cap + 1]), _capacity(cap + 1), _begin(0), _end(0) {
-  }
+      : _data(cap ? new value_type[cap + 1] : empty_data()),
+        _capacity(cap + 1), _begin(0), _end(0) {}
 
-  ~ringbuf_t() { delete[] _data; }
+  ~ringbuf_t() { free_data(); }
 
   ringbuf_t(const ringbuf_t &other)
       : _data(new value_type[other._capacity]), _capacity(other._capacity),
@@ -172,6 +177,7 @@ public:
     if (size <= capacity())
       return *this;
 
+    BSNET_PROBE2(buffer__expand, _capacity, size);
     value_type *new_data = new value_type[size + 1];
     auto rsize = readable_size();
     size_type part = std::min(rsize, _capacity - _begin);
@@ -185,7 +191,7 @@ public:
     _capacity = size + 1;
     _begin = 0;
     _end = rsize;
-    delete[] _data;
+    free_data();
     _data = new_data;
 
     return *this;
@@ -210,6 +216,17 @@ public:
   }
 
 private:
+  // the storage of every empty buffer, its single slot is never written.
+  static value_type *empty_data() noexcept {
+    static value_type empty[1];
+    return empty;
+  }
+
+  void free_data() noexcept {
+    if (_data != empty_data())
+      delete[] _data;
+  }
+
   /*
    * Update the begin index and size, after retrieve data of 'size'
    */
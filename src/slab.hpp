@@ -0,0 +1,189 @@
+//
+// Created by byao on 1/21/18.
+// Copyright (c) 2018 byao. All rights reserved.
+//
+
+#ifndef BSNET_SLAB_HPP
+#define BSNET_SLAB_HPP
+
+#include "token.hpp"
+#include "utility.hpp"
+#include <cassert>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace bsnet {
+
+/**
+ * Slab stores per-token state, ex. connections, indexed by the token
+ * allocated for it, so the event dispatch finds its state with an array
+ * index instead of a hash lookup.
+ *
+ * Entries live in fixed sized chunks, their addresses are stable until they
+ * are removed. Tokens come from a 'TokenPool', the lowest free slot is
+ * reused first, which keeps the live entries packed at the front. A lookup
+ * with a stale token, whose slot has been removed and maybe reused, returns
+ * nullptr.
+ */
+template <typename T> class Slab : public NonCopyable {
+public:
+  static constexpr std::uint32_t ChunkSize = 256;
+
+  using value_type = T;
+
+  explicit Slab(std::uint32_t size = ChunkSize,
+                std::uint32_t max_size = TokenPool::MaxSize)
+      : _pool(size, max_size) {}
+
+  ~Slab() { clear(); }
+
+  /**
+   * Construct an entry in place, returns its token.
+   * throws 'token_exhuasted' if the slab is full.
+   */
+  template <typename... Args> Token emplace(Args &&... args) {
+    Token tok = _pool.alloc_token();
+    std::uint32_t idx = tok.index();
+    try {
+      while (idx >= _chunks.size() * ChunkSize)
+        _chunks.emplace_back(new Entry[ChunkSize]);
+      Entry &e = entry(idx);
+      new (&e.value) T(std::forward<Args>(args)...);
+      e.gen = tok.generation();
+    } catch (...) {
+      _pool.free_token(tok);
+      throw;
+    }
+    return tok;
+  }
+
+  Token insert(T value) { return emplace(std::move(value)); }
+
+  /**
+   * Returns nullptr if 'tok' is not live.
+   */
+  T *get(Token tok) {
+    if (tok.index() >= _chunks.size() * ChunkSize)
+      return nullptr;
+    Entry &e = entry(tok.index());
+    return e.gen != 0 && e.gen == tok.generation() ? e.ptr() : nullptr;
+  }
+
+  const T *get(Token tok) const {
+    return const_cast<Slab *>(this)->get(tok);
+  }
+
+  bool contains(Token tok) const { return get(tok) != nullptr; }
+
+  /**
+   * The token must be live.
+   */
+  T &operator[](Token tok) {
+    T *p = get(tok);
+    assert(p);
+    return *p;
+  }
+
+  /**
+   * Destroy the entry, returns false if 'tok' is not live.
+   */
+  bool remove(Token tok) {
+    T *p = get(tok);
+    if (!p)
+      return false;
+    entry(tok.index()).gen = 0;
+    p->~T();
+    _pool.free_token(tok);
+    return true;
+  }
+
+  void clear() {
+    for (std::size_t i = 0; i < _chunks.size() * ChunkSize; ++i) {
+      Entry &e = entry(i);
+      if (e.gen) {
+        _pool.free_token(Token(static_cast<std::uint64_t>(e.gen) << 32 | i));
+        e.gen = 0;
+        e.ptr()->~T();
+      }
+    }
+  }
+
+  std::size_t size() const { return _pool.size(); }
+  bool empty() const { return _pool.size() == 0; }
+
+  /**
+   * Iterates live entries in token index order.
+   */
+  template <bool Const> class Iter {
+  public:
+    using SlabT = typename std::conditional<Const, const Slab, Slab>::type;
+    using reference = typename std::conditional<Const, const T &, T &>::type;
+
+    Token token() const {
+      return Token(static_cast<std::uint64_t>(_slab->entry(_idx).gen) << 32 |
+                   _idx);
+    }
+    reference operator*() const { return *_slab->entry(_idx).ptr(); }
+    typename std::remove_reference<reference>::type *operator->() const {
+      return _slab->entry(_idx).ptr();
+    }
+
+    Iter &operator++() {
+      ++_idx;
+      skip();
+      return *this;
+    }
+
+    bool operator==(const Iter &other) const { return _idx == other._idx; }
+    bool operator!=(const Iter &other) const { return _idx != other._idx; }
+
+  private:
+    friend class Slab;
+    Iter(SlabT *slab, std::size_t idx) : _slab(slab), _idx(idx) { skip(); }
+
+    void skip() {
+      std::size_t end = _slab->_chunks.size() * ChunkSize;
+      while (_idx < end && !_slab->entry(_idx).gen)
+        ++_idx;
+    }
+
+    SlabT *_slab;
+    std::size_t _idx;
+  };
+
+  using iterator = Iter<false>;
+  using const_iterator = Iter<true>;
+
+  iterator begin() { return iterator(this, 0); }
+  iterator end() { return iterator(this, _chunks.size() * ChunkSize); }
+  const_iterator begin() const { return const_iterator(this, 0); }
+  const_iterator end() const {
+    return const_iterator(this, _chunks.size() * ChunkSize);
+  }
+
+private:
+  struct Entry {
+    // generation of the live token, 0 if vacant
+    std::uint32_t gen = 0;
+    typename std::aligned_storage<sizeof(T), alignof(T)>::type value;
+
+    T *ptr() { return reinterpret_cast<T *>(&value); }
+  };
+
+  Entry &entry(std::size_t idx) const {
+    return _chunks[idx / ChunkSize][idx % ChunkSize];
+  }
+
+  TokenPool _pool;
+  std::vector<std::unique_ptr<Entry[]>> _chunks;
+};
+
+template <typename T> constexpr std::uint32_t Slab<T>::ChunkSize;
+
+} // namespace bsnet
+
+#endif // BSNET_SLAB_HPP
@@ -0,0 +1,136 @@
+//
+// Created by byao on 1/26/18.
+// Copyright (c) 2018 byao. All rights reserved.
+//
+
+#ifndef BSNET_TASK_HPP
+#define BSNET_TASK_HPP
+
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace bsnet {
+
+/**
+ * Task is a move-only 'void()' callable.
+ *
+ * Unlike std::function, a callable up to 'InlineSize' bytes, which is
+ * nothrow movable, is stored in the task itself, a task capturing a few
+ * pointers, a token and a small buffer never allocates.
+ */
+class Task {
+public:
+  static constexpr std::size_t InlineSize = 48;
+
+  Task() noexcept : _ops(nullptr) {}
+
+  template <typename F,
+            typename = typename std::enable_if<!std::is_same<
+                typename std::decay<F>::type, Task>::value>::type>
+  Task(F &&f) : _ops(nullptr) { // NOLINT
+    using Fn = typename std::decay<F>::type;
+    construct<Fn>(std::forward<F>(f),
+                  std::integral_constant<bool, fits<Fn>()>());
+  }
+
+  Task(Task &&other) noexcept : _ops(other._ops) {
+    if (_ops) {
+      _ops->move(&_buf, &other._buf);
+      other._ops = nullptr;
+    }
+  }
+
+  Task &operator=(Task &&other) noexcept {
+    if (this != &other) {
+      reset();
+      if (other._ops) {
+        other._ops->move(&_buf, &other._buf);
+        _ops = other._ops;
+        other._ops = nullptr;
+      }
+    }
+    return *this;
+  }
+
+  Task(const Task &) = delete;
+  Task &operator=(const Task &) = delete;
+
+  ~Task() { reset(); }
+
+  void operator()() { _ops->call(&_buf); }
+
+  explicit operator bool() const noexcept { return _ops != nullptr; }
+
+  bool is_inline() const noexcept { return _ops && _ops->is_inline; }
+
+  void reset() noexcept {
+    if (_ops) {
+      _ops->destroy(&_buf);
+      _ops = nullptr;
+    }
+  }
+
+  template <typename Fn> static constexpr bool fits() {
+    return sizeof(Fn) <= InlineSize &&
+           alignof(Fn) <= alignof(std::max_align_t) &&
+           std::is_nothrow_move_constructible<Fn>::value;
+  }
+
+private:
+  using Storage =
+      typename std::aligned_storage<InlineSize,
+                                    alignof(std::max_align_t)>::type;
+
+  template <typename Fn, typename F>
+  void construct(F &&f, std::true_type /* inline */) {
+    new (&_buf) Fn(std::forward<F>(f));
+    _ops = &InlineOps<Fn>::ops;
+  }
+
+  template <typename Fn, typename F>
+  void construct(F &&f, std::false_type /* inline */) {
+    *reinterpret_cast<Fn **>(&_buf) = new Fn(std::forward<F>(f));
+    _ops = &HeapOps<Fn>::ops;
+  }
+
+  struct Ops {
+    void (*call)(Storage *);
+    // move constructs 'dst' from 'src', and destroys 'src'.
+    void (*move)(Storage *dst, Storage *src) noexcept;
+    void (*destroy)(Storage *) noexcept;
+    bool is_inline;
+  };
+
+  template <typename Fn> struct InlineOps {
+    static Fn *get(Storage *s) { return reinterpret_cast<Fn *>(s); }
+    static void call(Storage *s) { (*get(s))(); }
+    static void move(Storage *dst, Storage *src) noexcept {
+      new (dst) Fn(std::move(*get(src)));
+      get(src)->~Fn();
+    }
+    static void destroy(Storage *s) noexcept { get(s)->~Fn(); }
+    static constexpr Ops ops{call, move, destroy, true};
+  };
+
+  template <typename Fn> struct HeapOps {
+    static Fn *&get(Storage *s) { return *reinterpret_cast<Fn **>(s); }
+    static void call(Storage *s) { (*get(s))(); }
+    static void move(Storage *dst, Storage *src) noexcept {
+      *reinterpret_cast<Fn **>(dst) = get(src);
+    }
+    static void destroy(Storage *s) noexcept { delete get(s); }
+    static constexpr Ops ops{call, move, destroy, false};
+  };
+
+  Storage _buf;
+  const Ops *_ops;
+};
+
+template <typename Fn> constexpr Task::Ops Task::InlineOps<Fn>::ops;
+template <typename Fn> constexpr Task::Ops Task::HeapOps<Fn>::ops;
+
+} // namespace bsnet
+
+#endif // BSNET_TASK_HPP
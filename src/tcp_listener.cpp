@@ -7,6 +7,7 @@
 #include "tcp_listener.hpp"
 #include "address.hpp"
 #include "neterr.hpp"
+#include "probes.hpp"
 #include "tcp_stream.hpp"
 #include <sys/socket.h>
 #include <unistd.h>
@@ -43,16 +44,35 @@ TcpListener::TcpListener(TcpListener &&other) noexcept : EventedFd(-1) {
 }
 
 TcpStream TcpListener::accept(Addr *addr) {
-  int sock;
+  error_code ec;
+  TcpStream conn = accept(ec, addr);
+  if (ec && ec != errc::resource_unavailable_try_again)
+    throw creating_acceptor_failed();
+  return conn;
+}
+
+void TcpListener::local_addr(Addr &addr) {
+  error_code ec;
+  local_addr(addr, ec);
+  if (ec)
+    throw tcp_error("getsockname");
+}
+
+TcpStream TcpListener::accept(error_code &ec, Addr *addr) noexcept {
   socklen_t socklen, *socklenp = nullptr;
   struct sockaddr *ad = nullptr;
   if (addr) {
     ad = addr->get_sockaddr();
+    socklen = sizeof(struct sockaddr_in6);
     socklenp = &socklen;
   }
-  CHECKED((sock = ::accept4(_fd, ad, socklenp, SOCK_NONBLOCK)) > 0 ||
-              errno == EAGAIN || errno == EWOULDBLOCK,
-          creating_acceptor_failed);
+  int sock = ::accept4(_fd, ad, socklenp, SOCK_NONBLOCK);
+  BSNET_PROBE2(accept, _fd, sock);
+  if (sock == -1) {
+    ec = last_error();
+    return TcpStream(-1);
+  }
+  ec.clear();
   if (socklenp) {
     addr->_v = socklen == sizeof(struct sockaddr_in) ? Addr::Version::V4
                                                      : Addr::Version::V6;
@@ -60,8 +80,13 @@ TcpStream TcpListener::accept(Addr *addr) {
   return TcpStream(sock);
 }
 
-void TcpListener::local_addr(Addr &addr) {
-  socklen_t socklen;
-  CHECKED_TCPOP(::getsockname(_fd, addr.get_sockaddr(), &socklen) != -1);
+void TcpListener::local_addr(Addr &addr, error_code &ec) noexcept {
+  socklen_t socklen = sizeof(struct sockaddr_in6);
+  ec.clear();
+  if (::getsockname(_fd, addr.get_sockaddr(), &socklen) == -1) {
+    ec = last_error();
+    return;
+  }
+  addr._v = static_cast<Addr::Version>(addr.get_sockaddr()->sa_family);
+}
 }
-}
\ No newline at end of file
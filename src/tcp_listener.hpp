@@ -10,6 +10,7 @@
 #include "eventedfd.hpp"
 #include "utility.hpp"
 #include <cstdint>
+#include <system_error>
 
 namespace bsnet {
 
@@ -20,6 +21,11 @@ class TcpListener : public EventedFd {
 public:
   static TcpListener bind(const Addr &addr, std::size_t listen_backlog);
 
+  /**
+   * Take the ownership of a listening nonblocking socket.
+   */
+  static TcpListener from_fd(int fd) { return TcpListener(fd); }
+
   TcpListener(TcpListener &&other) noexcept;
 
   ~TcpListener() noexcept override = default;
@@ -29,9 +35,20 @@ public:
     swap(_fd, other._fd);
   }
 
+  /**
+   * Returns a stream of fd -1 if there is no pending connection.
+   */
   TcpStream accept(Addr *peer = nullptr);
   void local_addr(Addr &addr);
 
+  /**
+   * Non-throwing accept, returns a stream of fd -1 and sets 'ec' on failure,
+   * 'std::errc::resource_unavailable_try_again' if there is no pending
+   * connection.
+   */
+  TcpStream accept(std::error_code &ec, Addr *peer = nullptr) noexcept;
+  void local_addr(Addr &addr, std::error_code &ec) noexcept;
+
 private:
   TcpListener(int sock) : EventedFd(sock) {}
 };
@@ -0,0 +1,67 @@
+//
+// Created by byao on 2/6/18.
+// Copyright (c) 2018 byao. All rights reserved.
+//
+
+#ifndef BSNET_TCP_STATS_HPP
+#define BSNET_TCP_STATS_HPP
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+namespace bsnet {
+
+/**
+ * I/O counters of a 'TcpStream', collected after 'enable_stats'.
+ */
+struct TcpStreamStats {
+  using Clock = std::chrono::steady_clock;
+
+  std::uint64_t bytes_in = 0;
+  std::uint64_t bytes_out = 0;
+  // read and write syscalls, and the ones failing with EAGAIN.
+  std::uint64_t read_calls = 0;
+  std::uint64_t write_calls = 0;
+  std::uint64_t read_eagain = 0;
+  std::uint64_t write_eagain = 0;
+  // writes taking less than offered, the socket buffer is full.
+  std::uint64_t partial_writes = 0;
+  // most bytes in the outbound queue, and readable in the buffer read into.
+  std::size_t outq_high_water = 0;
+  std::size_t inbuf_high_water = 0;
+  // when the stats were enabled, and the first byte read after it.
+  Clock::time_point since;
+  Clock::time_point first_byte;
+
+  bool has_first_byte() const { return first_byte != Clock::time_point(); }
+  Clock::duration time_to_first_byte() const {
+    return has_first_byte() ? first_byte - since : Clock::duration::zero();
+  }
+};
+
+/**
+ * A sample of the kernel's view of a connection, from TCP_INFO.
+ */
+struct TcpInfo {
+  std::uint8_t state = 0;
+  // retransmits of the current unacked segment, and of the connection.
+  std::uint8_t retransmits = 0;
+  std::uint32_t total_retrans = 0;
+  // smoothed rtt and its mean deviation, in microseconds.
+  std::uint32_t rtt_us = 0;
+  std::uint32_t rttvar_us = 0;
+  // congestion window and slow start threshold, in segments.
+  std::uint32_t snd_cwnd = 0;
+  std::uint32_t snd_ssthresh = 0;
+  std::uint32_t snd_mss = 0;
+  std::uint32_t rcv_mss = 0;
+  // segments sent and not acked, and considered lost.
+  std::uint32_t unacked = 0;
+  std::uint32_t lost = 0;
+  std::uint32_t rcv_space = 0;
+};
+
+} // namespace bsnet
+
+#endif // BSNET_TCP_STATS_HPP
@@ -7,8 +7,11 @@
 #include "address.hpp"
 #include "neterr.hpp"
 #include "poller.hpp"
+#include "probes.hpp"
 #include "utility.hpp"
+#include <algorithm>
 #include <cassert>
+#include <climits>
 #include <cstring>
 #include <netdb.h>
 #include <netinet/tcp.h>
@@ -23,32 +26,69 @@ using namespace std;
 
 namespace bsnet {
 
+constexpr size_t TcpStream::DefaultLowWatermark;
+constexpr size_t TcpStream::DefaultHighWatermark;
+constexpr size_t TcpStream::DefaultReadBudget;
+constexpr int TcpStream::DefaultReadCalls;
+constexpr size_t TcpStream::MinReadSize;
+constexpr size_t TcpStream::InitialReadSize;
+constexpr size_t TcpStream::MaxReadSize;
+
+TcpStream::TcpStream(int fd)
+    : EventedFd(fd), _poller(nullptr), _token(), _interest(Ready::empty()),
+      _opts(PollOpt::empty()), _write_armed(false), _outq(0),
+      _low_watermark(DefaultLowWatermark),
+      _high_watermark(DefaultHighWatermark), _write_blocked(false),
+      _send_error(0), _read_budget(DefaultReadBudget),
+      _read_calls(DefaultReadCalls), _read_hint(InitialReadSize),
+      _read_shrink(0) {}
+
 // use a nonblocking socket to connect to remote peer,
-void TcpStream::connect_nob(int sock, const struct sockaddr *addr,
-                            socklen_t len, int timeout) {
-  int r = ::connect(sock, addr, len);
-  if (r == 0)
-    return;
-  if (r == -1 && errno != EINPROGRESS)
-    throw connecting_failed();
+int TcpStream::connect_nob(int sock, const struct sockaddr *addr,
+                           socklen_t len, int timeout) noexcept {
+  if (::connect(sock, addr, len) == 0)
+    return 0;
+  if (errno != EINPROGRESS)
+    return errno;
   struct ::pollfd pfd;
   pfd.fd = sock;
   pfd.events = POLLOUT;
-  int n = ::poll(&pfd, 1, timeout);
+  int n;
+  while ((n = ::poll(&pfd, 1, timeout)) == -1 && errno == EINTR)
+    ;
   if (n == 0)
-    throw connecting_failed("timeout");
+    return ETIMEDOUT;
   if (n < 0)
-    throw connecting_failed();
-  assert(n == 1);
-  assert(pfd.revents & POLLOUT);
+    return errno;
+  // the result of the connection.
+  int err = 0;
+  socklen_t size = sizeof(err);
+  if (::getsockopt(sock, SOL_SOCKET, SO_ERROR, &err, &size) == -1)
+    return errno;
+  return err;
 }
 
 TcpStream TcpStream::connect(const Addr &addr, Duration *ms) {
+  error_code ec;
+  TcpStream conn = connect(addr, ec, ms);
+  if (ec == errc::timed_out)
+    throw connecting_failed("timeout");
+  if (ec) {
+    errno = ec.value();
+    throw connecting_failed();
+  }
+  return conn;
+}
+
+TcpStream TcpStream::connect(const Addr &addr, error_code &ec,
+                             Duration *ms) noexcept {
   int domain = addr.is_ipv4() ? AF_INET : AF_INET6;
   // create an non-blocking socket
   int sock = ::socket(domain, SOCK_STREAM | SOCK_NONBLOCK, 0);
-  if (sock == -1)
-    throw connecting_failed();
+  if (sock == -1) {
+    ec = last_error();
+    return TcpStream(-1);
+  }
 
   // when ms is not specified, ::poll will blocking.
   int timeout = -1;
@@ -56,16 +96,16 @@ TcpStream TcpStream::connect(const Addr &addr, Duration *ms) {
     timeout = static_cast<int>(ms->count());
 
   // connect the socket to the address
-  try {
-    connect_nob(sock, addr.get_sockaddr(), addr.size(), timeout);
-  } catch (connecting_failed &ex) {
+  int err = connect_nob(sock, addr.get_sockaddr(), addr.size(), timeout);
+  if (err) {
     ::close(sock);
-    throw;
+    ec.assign(err, system_category());
+    return TcpStream(-1);
   }
 
   // create a TcpStream using the connected socket.
-  TcpStream conn(sock);
-  return conn;
+  ec.clear();
+  return TcpStream(sock);
 }
 
 TcpStream TcpStream::connect(const char *host, const char *service) {
@@ -85,14 +125,9 @@ TcpStream TcpStream::connect(const char *host, const char *service) {
     if (s < 0)
       continue;
 
-    try {
-      connect_nob(s, rp->ai_addr, rp->ai_addrlen, -1);
-    } catch (connecting_failed &ex) {
-      ::close(s);
-      continue;
-    }
-
-    break;
+    if (connect_nob(s, rp->ai_addr, rp->ai_addrlen, -1) == 0)
+      break;
+    ::close(s);
   }
   ::freeaddrinfo(result);
   if (rp == nullptr)
@@ -105,68 +140,518 @@ TcpStream TcpStream::connect(const std::string &host,
   return connect(host.c_str(), service.c_str());
 }
 
-TcpStream::TcpStream(TcpStream &&other) noexcept : EventedFd(-1) {
+TcpStream::TcpStream(TcpStream &&other) noexcept : TcpStream(-1) {
   this->swap(other);
 }
 
+void TcpStream::swap(TcpStream &other) noexcept {
+  using std::swap;
+  swap(_fd, other._fd);
+  swap(_poller, other._poller);
+  swap(_token, other._token);
+  swap(_interest, other._interest);
+  swap(_opts, other._opts);
+  swap(_write_armed, other._write_armed);
+  swap(_outq, other._outq);
+  swap(_low_watermark, other._low_watermark);
+  swap(_high_watermark, other._high_watermark);
+  swap(_write_blocked, other._write_blocked);
+  swap(_send_error, other._send_error);
+  swap(_on_watermark, other._on_watermark);
+  swap(_read_budget, other._read_budget);
+  swap(_read_calls, other._read_calls);
+  swap(_read_hint, other._read_hint);
+  swap(_read_shrink, other._read_shrink);
+  swap(_stats, other._stats);
+}
+
+void TcpStream::register_on(Poller &poller, Token tok, Ready interest,
+                            PollOpt opts) {
+  error_code ec;
+  register_on(poller, tok, interest, opts, ec);
+  if (ec)
+    throw poller_error();
+}
+
+void TcpStream::reregister_on(Poller &poller, Token tok, Ready interest,
+                              PollOpt opts) {
+  error_code ec;
+  reregister_on(poller, tok, interest, opts, ec);
+  if (ec)
+    throw poller_error();
+}
+
+void TcpStream::deregister_on(Poller &poller) {
+  error_code ec;
+  deregister_on(poller, ec);
+  if (ec)
+    throw poller_error();
+}
+
+void TcpStream::register_on(Poller &poller, Token tok, Ready interest,
+                            PollOpt opts, error_code &ec) noexcept {
+  bool armed = _outq.readable_bytes() > 0;
+  Ready r = armed ? interest | Ready::writable() : interest;
+  EventedFd::register_on(poller, tok, r, opts, ec);
+  if (ec)
+    return;
+  _write_armed = armed;
+  _poller = &poller;
+  _token = tok;
+  _interest = interest;
+  _opts = opts;
+}
+
+void TcpStream::reregister_on(Poller &poller, Token tok, Ready interest,
+                              PollOpt opts, error_code &ec) noexcept {
+  bool armed = _outq.readable_bytes() > 0;
+  Ready r = armed ? interest | Ready::writable() : interest;
+  EventedFd::reregister_on(poller, tok, r, opts, ec);
+  if (ec)
+    return;
+  _write_armed = armed;
+  _poller = &poller;
+  _token = tok;
+  _interest = interest;
+  _opts = opts;
+}
+
+void TcpStream::deregister_on(Poller &poller, error_code &ec) noexcept {
+  EventedFd::deregister_on(poller, ec);
+  if (ec)
+    return;
+  _poller = nullptr;
+  _write_armed = false;
+}
+
 void TcpStream::peer_addr(Addr &addr) {
-  socklen_t socklen;
-  CHECKED_TCPOP(::getpeername(_fd, addr.get_sockaddr(), &socklen) != -1);
+  error_code ec;
+  peer_addr(addr, ec);
+  if (ec)
+    throw tcp_error("getpeername");
 }
 
 void TcpStream::local_addr(Addr &addr) {
-  socklen_t socklen;
-  CHECKED_TCPOP(::getsockname(_fd, addr.get_sockaddr(), &socklen) != -1);
+  error_code ec;
+  local_addr(addr, ec);
+  if (ec)
+    throw tcp_error("getsockname");
 }
 
 void TcpStream::shutdown(Shutdown s) {
-  CHECKED_TCPOP(::shutdown(_fd, static_cast<int>(s)) != -1);
+  error_code ec;
+  shutdown(s, ec);
+  if (ec)
+    throw tcp_error("shutdown");
 }
 
 void TcpStream::set_nodelay(bool on) {
-  int optval = on ? 1 : 0;
-  CHECKED_TCPOP(::setsockopt(_fd, IPPROTO_TCP, TCP_NODELAY, &optval,
-                             sizeof(optval)) != -1);
+  error_code ec;
+  set_nodelay(on, ec);
+  if (ec)
+    throw tcp_error("set TCP_NODELAY");
 }
 
 bool TcpStream::nodelay() const {
-  int on;
-  socklen_t size;
-  CHECKED_TCPOP(::getsockopt(_fd, IPPROTO_TCP, TCP_NODELAY, &on, &size) != -1);
-  return on == 1;
+  error_code ec;
+  bool on = nodelay(ec);
+  if (ec)
+    throw tcp_error("get TCP_NODELAY");
+  return on;
 }
 
 void TcpStream::set_keepalive(bool on, int idle, int interval, int maxpkt) {
-  int ion = on ? 1 : 0;
-  CHECKED_TCPOP(
-      ::setsockopt(_fd, SOL_SOCKET, SO_KEEPALIVE, &ion, sizeof(ion)) != -1);
-  CHECKED_TCPOP(
-      ::setsockopt(_fd, IPPROTO_TCP, TCP_KEEPIDLE, &idle, sizeof(idle)) != -1)
-  CHECKED_TCPOP(::setsockopt(_fd, IPPROTO_TCP, TCP_KEEPINTVL, &interval,
-                             sizeof(interval)) != -1);
-  CHECKED_TCPOP(::setsockopt(_fd, IPPROTO_TCP, TCP_KEEPCNT, &maxpkt,
-                             sizeof(maxpkt)) != -1);
+  error_code ec;
+  set_keepalive(on, idle, interval, maxpkt, ec);
+  if (ec)
+    throw tcp_error("set keepalive");
 }
 
 bool TcpStream::keepalive(int &idle, int &interval, int &maxpkt) const {
-  int on;
-  socklen_t size;
-  CHECKED_TCPOP(::getsockopt(_fd, SOL_SOCKET, SO_KEEPALIVE, &on, &size) != -1);
+  error_code ec;
+  bool on = keepalive(idle, interval, maxpkt, ec);
+  if (ec)
+    throw tcp_error("get keepalive");
+  return on;
+}
+
+void TcpStream::peer_addr(Addr &addr, error_code &ec) noexcept {
+  socklen_t socklen = sizeof(struct sockaddr_in6);
+  ec.clear();
+  if (::getpeername(_fd, addr.get_sockaddr(), &socklen) == -1) {
+    ec = last_error();
+    return;
+  }
+  addr._v = static_cast<Addr::Version>(addr.get_sockaddr()->sa_family);
+}
+
+void TcpStream::local_addr(Addr &addr, error_code &ec) noexcept {
+  socklen_t socklen = sizeof(struct sockaddr_in6);
+  ec.clear();
+  if (::getsockname(_fd, addr.get_sockaddr(), &socklen) == -1) {
+    ec = last_error();
+    return;
+  }
+  addr._v = static_cast<Addr::Version>(addr.get_sockaddr()->sa_family);
+}
+
+void TcpStream::shutdown(Shutdown s, error_code &ec) noexcept {
+  ec.clear();
+  if (::shutdown(_fd, static_cast<int>(s)) == -1)
+    ec = last_error();
+}
+
+void TcpStream::set_nodelay(bool on, error_code &ec) noexcept {
+  int optval = on ? 1 : 0;
+  ec.clear();
+  if (::setsockopt(_fd, IPPROTO_TCP, TCP_NODELAY, &optval, sizeof(optval)) ==
+      -1)
+    ec = last_error();
+}
+
+bool TcpStream::nodelay(error_code &ec) const noexcept {
+  int on = 0;
+  socklen_t size = sizeof(on);
+  ec.clear();
+  if (::getsockopt(_fd, IPPROTO_TCP, TCP_NODELAY, &on, &size) == -1)
+    ec = last_error();
+  return on != 0;
+}
+
+void TcpStream::set_keepalive(bool on, int idle, int interval, int maxpkt,
+                              error_code &ec) noexcept {
+  int ion = on ? 1 : 0;
+  ec.clear();
+  if (::setsockopt(_fd, SOL_SOCKET, SO_KEEPALIVE, &ion, sizeof(ion)) == -1 ||
+      ::setsockopt(_fd, IPPROTO_TCP, TCP_KEEPIDLE, &idle, sizeof(idle)) ==
+          -1 ||
+      ::setsockopt(_fd, IPPROTO_TCP, TCP_KEEPINTVL, &interval,
+                   sizeof(interval)) == -1 ||
+      ::setsockopt(_fd, IPPROTO_TCP, TCP_KEEPCNT, &maxpkt, sizeof(maxpkt)) ==
+          -1)
+    ec = last_error();
+}
+
+bool TcpStream::keepalive(int &idle, int &interval, int &maxpkt,
+                          error_code &ec) const noexcept {
+  int on = 0;
+  socklen_t size = sizeof(on);
+  ec.clear();
+  if (::getsockopt(_fd, SOL_SOCKET, SO_KEEPALIVE, &on, &size) == -1) {
+    ec = last_error();
+    return false;
+  }
   if (on == 0)
     return false;
 
   // keepalive is enabled
-  CHECKED_TCPOP(::getsockopt(_fd, IPPROTO_TCP, TCP_KEEPIDLE, &idle, &size) !=
-                -1);
-  CHECKED_TCPOP(
-      ::getsockopt(_fd, IPPROTO_TCP, TCP_KEEPINTVL, &interval, &size) != -1);
-  CHECKED_TCPOP(::getsockopt(_fd, IPPROTO_TCP, TCP_KEEPCNT, &maxpkt, &size) !=
-                -1);
+  size = sizeof(int);
+  if (::getsockopt(_fd, IPPROTO_TCP, TCP_KEEPIDLE, &idle, &size) == -1 ||
+      ::getsockopt(_fd, IPPROTO_TCP, TCP_KEEPINTVL, &interval, &size) == -1 ||
+      ::getsockopt(_fd, IPPROTO_TCP, TCP_KEEPCNT, &maxpkt, &size) == -1)
+    ec = last_error();
   return true;
 }
 
-ssize_t TcpStream::read(TcpStream::Buf &buf) { return buf.read_from(_fd); }
+ssize_t TcpStream::read(TcpStream::Buf &buf) {
+  ssize_t n = buf.read_from(_fd);
+  count_read(n, buf);
+  return n;
+}
+
+ssize_t TcpStream::write(TcpStream::Buf &buf) {
+  auto len = static_cast<size_t>(buf.readable_bytes());
+  ssize_t n = send_buf(buf);
+  count_write(n, len);
+  return n;
+}
+
+void TcpStream::set_read_budget(size_t bytes, int syscalls) {
+  assert(bytes > 0 && syscalls > 0);
+  _read_budget = bytes;
+  _read_calls = syscalls;
+}
+
+ssize_t TcpStream::read_some(Buf &buf) {
+  size_t total = 0;
+  bool drained = false;
+  for (int calls = 0; calls < _read_calls && total < _read_budget; ++calls) {
+    size_t want = std::min(_read_hint, _read_budget - total);
+    // read into the buffer directly, rather than through the extra buffer.
+    buf.ensure_writable(static_cast<Buf::SizeType>(want));
+    ssize_t n = buf.read_from(_fd, static_cast<Buf::SizeType>(want));
+    count_read(n, buf);
+    if (n <= 0) {
+      if (total == 0)
+        return n;
+      // report the end of stream or the error on the next call.
+      if (n == 0 || (errno != EAGAIN && errno != EWOULDBLOCK))
+        requeue_readable();
+      return static_cast<ssize_t>(total);
+    }
+    total += n;
+    adapt_read_size(static_cast<size_t>(n), want);
+    // a short read means the socket is drained.
+    if (static_cast<size_t>(n) < want) {
+      drained = true;
+      break;
+    }
+  }
+  if (!drained)
+    requeue_readable();
+  return static_cast<ssize_t>(total);
+}
+
+void TcpStream::adapt_read_size(size_t n, size_t want) {
+  // a read cut short by the budget tells nothing about the peer.
+  if (want < _read_hint)
+    return;
+  if (n == want) {
+    _read_hint = std::min(_read_hint << 1, MaxReadSize);
+    _read_shrink = 0;
+  } else if (n <= _read_hint >> 1) {
+    // shrink only after two small reads in a row.
+    if (++_read_shrink >= 2) {
+      _read_hint = std::max(_read_hint >> 1, MinReadSize);
+      _read_shrink = 0;
+    }
+  } else {
+    _read_shrink = 0;
+  }
+}
+
+void TcpStream::requeue_readable() {
+  // level-triggered registrations are reported by epoll again anyway.
+  if (_poller && _opts.is_edge())
+    _poller->rq()->requeue(Event(Ready::readable(), PollOpt::empty(), _token));
+}
+
+void TcpStream::set_write_watermarks(size_t low, size_t high) {
+  assert(low <= high);
+  _low_watermark = low;
+  _high_watermark = high;
+  check_watermarks();
+}
+
+ssize_t TcpStream::send_buf(Buf &buf) {
+  struct msghdr msg;
+  ::memset(&msg, 0, sizeof(msg));
+  ssize_t n = buf.send_msg(_fd, &msg, static_cast<size_t>(buf.readable_bytes()),
+                           MSG_NOSIGNAL);
+  BSNET_PROBE2(write, _fd, n);
+  return n;
+}
+
+bool TcpStream::check_send(ssize_t n) {
+  if (n != -1 || errno == EAGAIN || errno == EWOULDBLOCK)
+    return true;
+  // the peer is gone, nothing queued will ever be written.
+  int err = errno;
+  _send_error = err;
+  _outq.clear();
+  update_write_interest();
+  check_watermarks();
+  errno = err;
+  return false;
+}
+
+bool TcpStream::send(const void *data, size_t len) {
+  if (_send_error) {
+    errno = _send_error;
+    return false;
+  }
+  // nothing queued, write directly and only queue what is left.
+  if (_outq.readable_bytes() == 0 && !_write_armed) {
+    ssize_t n = ::send(_fd, data, len, MSG_NOSIGNAL);
+    BSNET_PROBE2(write, _fd, n);
+    count_write(n, len);
+    if (!check_send(n))
+      return false;
+    if (n > 0) {
+      data = static_cast<const Byte *>(data) + n;
+      len -= static_cast<size_t>(n);
+    }
+  }
+  if (len > 0)
+    _outq.put(data, len);
+  update_write_interest();
+  check_watermarks();
+  return !_write_blocked;
+}
+
+bool TcpStream::send(Buf &buf) {
+  if (_send_error) {
+    errno = _send_error;
+    return false;
+  }
+  if (_outq.readable_bytes() == 0 && !_write_armed) {
+    auto len = static_cast<size_t>(buf.readable_bytes());
+    ssize_t n = send_buf(buf);
+    count_write(n, len);
+    if (!check_send(n))
+      return false;
+  }
+  if (_outq.readable_bytes() == 0) {
+    _outq.swap(buf);
+  } else {
+    struct iovec vio[2];
+    int len = buf.readable_iovec(&vio[0]);
+    for (int i = 0; i < len; ++i)
+      _outq.put(vio[i].iov_base, vio[i].iov_len);
+    buf.clear();
+  }
+  update_write_interest();
+  check_watermarks();
+  return !_write_blocked;
+}
+
+bool TcpStream::send(const struct iovec *iov, int iovcnt) {
+  size_t len = 0;
+  for (int i = 0; i < iovcnt; ++i)
+    len += iov[i].iov_len;
+  size_t sent = 0;
+  if (_send_error) {
+    errno = _send_error;
+    return false;
+  }
+  if (_outq.readable_bytes() == 0 && !_write_armed) {
+    struct msghdr msg;
+    ::memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = const_cast<struct iovec *>(iov);
+    msg.msg_iovlen = static_cast<size_t>(std::min(iovcnt, IOV_MAX));
+    ssize_t n = ::sendmsg(_fd, &msg, MSG_NOSIGNAL);
+    BSNET_PROBE2(write, _fd, n);
+    count_write(n, len);
+    if (!check_send(n))
+      return false;
+    if (n > 0)
+      sent = static_cast<size_t>(n);
+  }
+  if (sent < len)
+    _outq.ensure_writable(static_cast<Buf::SizeType>(len - sent));
+  for (int i = 0; i < iovcnt; ++i) {
+    if (sent >= iov[i].iov_len) {
+      sent -= iov[i].iov_len;
+      continue;
+    }
+    _outq.put(static_cast<const Byte *>(iov[i].iov_base) + sent,
+              iov[i].iov_len - sent);
+    sent = 0;
+  }
+  update_write_interest();
+  check_watermarks();
+  return !_write_blocked;
+}
+
+ssize_t TcpStream::flush() {
+  ssize_t total = 0;
+  while (_outq.readable_bytes() > 0) {
+    auto queued = _outq.readable_bytes();
+    ssize_t n = send_buf(_outq);
+    count_write(n, static_cast<size_t>(queued));
+    if (!check_send(n))
+      return -1;
+    if (n == -1)
+      break;
+    total += n;
+    // a short write means the socket buffer is full.
+    if (n < queued)
+      break;
+  }
+  update_write_interest();
+  check_watermarks();
+  return total;
+}
+
+void TcpStream::update_write_interest() {
+  bool pending = _outq.readable_bytes() > 0;
+  if (_poller == nullptr || pending == _write_armed)
+    return;
+  Ready r = pending ? _interest | Ready::writable() : _interest;
+  EventedFd::reregister_on(*_poller, _token, r, _opts);
+  _write_armed = pending;
+}
+
+void TcpStream::check_watermarks() {
+  auto queued = queued_bytes();
+  if (_stats && queued > _stats->outq_high_water)
+    _stats->outq_high_water = queued;
+  if (!_write_blocked && queued >= _high_watermark) {
+    _write_blocked = true;
+    if (_on_watermark)
+      _on_watermark(*this, true);
+  } else if (_write_blocked && queued <= _low_watermark) {
+    _write_blocked = false;
+    if (_on_watermark)
+      _on_watermark(*this, false);
+  }
+}
+
+void TcpStream::enable_stats(bool on) {
+  if (!on) {
+    _stats.reset();
+    return;
+  }
+  _stats.reset(new TcpStreamStats());
+  _stats->since = TcpStreamStats::Clock::now();
+}
+
+void TcpStream::count_read(ssize_t n, const Buf &buf) {
+  if (!_stats)
+    return;
+  ++_stats->read_calls;
+  if (n > 0) {
+    if (_stats->bytes_in == 0)
+      _stats->first_byte = TcpStreamStats::Clock::now();
+    _stats->bytes_in += static_cast<uint64_t>(n);
+    auto readable = static_cast<size_t>(buf.readable_bytes());
+    if (readable > _stats->inbuf_high_water)
+      _stats->inbuf_high_water = readable;
+  } else if (n == -1 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+    ++_stats->read_eagain;
+  }
+}
+
+void TcpStream::count_write(ssize_t n, size_t len) {
+  if (!_stats)
+    return;
+  ++_stats->write_calls;
+  if (n >= 0) {
+    _stats->bytes_out += static_cast<uint64_t>(n);
+    if (static_cast<size_t>(n) < len)
+      ++_stats->partial_writes;
+  } else if (errno == EAGAIN || errno == EWOULDBLOCK) {
+    ++_stats->write_eagain;
+  }
+}
+
+void TcpStream::tcp_info(TcpInfo &info) const {
+  error_code ec;
+  tcp_info(info, ec);
+  if (ec)
+    throw tcp_error("get TCP_INFO");
+}
 
-ssize_t TcpStream::write(TcpStream::Buf &buf) { return buf.write_to(_fd); }
+void TcpStream::tcp_info(TcpInfo &info, error_code &ec) const noexcept {
+  struct tcp_info ti;
+  socklen_t size = sizeof(ti);
+  ec.clear();
+  if (::getsockopt(_fd, IPPROTO_TCP, TCP_INFO, &ti, &size) == -1) {
+    ec = last_error();
+    return;
+  }
+  info.state = ti.tcpi_state;
+  info.retransmits = ti.tcpi_retransmits;
+  info.total_retrans = ti.tcpi_total_retrans;
+  info.rtt_us = ti.tcpi_rtt;
+  info.rttvar_us = ti.tcpi_rttvar;
+  info.snd_cwnd = ti.tcpi_snd_cwnd;
+  info.snd_ssthresh = ti.tcpi_snd_ssthresh;
+  info.snd_mss = ti.tcpi_snd_mss;
+  info.rcv_mss = ti.tcpi_rcv_mss;
+  info.unacked = ti.tcpi_unacked;
+  info.lost = ti.tcpi_lost;
+  info.rcv_space = ti.tcpi_rcv_space;
+}
 
-} // namespace bsnet
\ No newline at end of file
+} // namespace bsnet
@@ -9,9 +9,14 @@
 #include "bytebuffer.hpp"
 #include "event.hpp"
 #include "eventedfd.hpp"
+#include "tcp_stats.hpp"
 #include "utility.hpp"
+#include <cstddef>
+#include <functional>
+#include <memory>
 #include <stdexcept>
 #include <sys/socket.h>
+#include <system_error>
 
 namespace bsnet {
 
@@ -30,6 +35,22 @@ public:
   friend class TcpListener;
   using Buf = ByteBuffer;
 
+  /**
+   * Called when the outbound queue grows to the high watermark
+   * ('blocked' is true), and when it drains back to the low watermark
+   * ('blocked' is false).
+   */
+  using WatermarkCallback = std::function<void(TcpStream &, bool blocked)>;
+
+  static constexpr std::size_t DefaultLowWatermark = 16 * 1024;
+  static constexpr std::size_t DefaultHighWatermark = 64 * 1024;
+
+  static constexpr std::size_t DefaultReadBudget = 64 * 1024;
+  static constexpr int DefaultReadCalls = 8;
+  static constexpr std::size_t MinReadSize = 512;
+  static constexpr std::size_t InitialReadSize = 4096;
+  static constexpr std::size_t MaxReadSize = 64 * 1024;
+
   /*
    * throws 'connecting_failed' exception
    */
@@ -37,13 +58,35 @@ public:
   static TcpStream connect(const char *host, const char *service);
   static TcpStream connect(const std::string &host, const std::string &service);
 
+  /**
+   * Non-throwing connect, returns a stream of fd -1 and sets 'ec' on
+   * failure, 'std::errc::timed_out' if the timeout passed.
+   */
+  static TcpStream connect(const Addr &addr, std::error_code &ec,
+                           Duration *ms = nullptr) noexcept;
+
+  /**
+   * Take the ownership of a connected nonblocking socket, ex. one passed from
+   * another process by 'recv_fds'.
+   */
+  static TcpStream from_fd(int fd) { return TcpStream(fd); }
+
   TcpStream(TcpStream &&other) noexcept;
   ~TcpStream() noexcept override = default;
 
-  void swap(TcpStream &other) noexcept {
-    using std::swap;
-    swap(_fd, other._fd);
-  }
+  void swap(TcpStream &other) noexcept;
+
+  void register_on(Poller &poller, Token tok, Ready interest,
+                   PollOpt opts) override;
+  void reregister_on(Poller &poller, Token tok, Ready interest,
+                     PollOpt opts) override;
+  void deregister_on(Poller &poller) override;
+
+  void register_on(Poller &poller, Token tok, Ready interest, PollOpt opts,
+                   std::error_code &ec) noexcept override;
+  void reregister_on(Poller &poller, Token tok, Ready interest, PollOpt opts,
+                     std::error_code &ec) noexcept override;
+  void deregister_on(Poller &poller, std::error_code &ec) noexcept override;
 
   /**
    * Folowing methods can throw 'tcp_error' exception
@@ -56,16 +99,152 @@ public:
   void set_keepalive(bool on, int idle, int interval, int maxpkt);
   bool keepalive(int &idle, int &interval, int &maxpkt) const;
 
+  /**
+   * Non-throwing variants, the failure is reported in 'ec'.
+   */
+  void peer_addr(Addr &addr, std::error_code &ec) noexcept;
+  void local_addr(Addr &addr, std::error_code &ec) noexcept;
+  void shutdown(Shutdown s, std::error_code &ec) noexcept;
+  void set_nodelay(bool on, std::error_code &ec) noexcept;
+  bool nodelay(std::error_code &ec) const noexcept;
+  void set_keepalive(bool on, int idle, int interval, int maxpkt,
+                     std::error_code &ec) noexcept;
+  bool keepalive(int &idle, int &interval, int &maxpkt,
+                 std::error_code &ec) const noexcept;
+
   ssize_t read(Buf &buf);
   ssize_t write(Buf &buf);
 
+  /**
+   * Managed outbound queue:
+   *   'send' queues the data and writes as much as the socket takes, what is
+   *   left is written by 'flush' when the stream becomes writable. The
+   *   stream registers the writable interest on its poller by itself while
+   *   the queue is not empty, and drops it once the queue is drained.
+   *
+   *   The stream is write-blocked from the moment the queue reaches the high
+   *   watermark until it drains to the low watermark, producers should stop
+   *   sending while it is blocked.
+   *
+   *   A write failing with another error than EAGAIN, ex. EPIPE, fails the
+   *   queue: what is queued is dropped, the error is kept in 'send_error',
+   *   and the following sends return false with errno set to it.
+   */
+  void set_write_watermarks(std::size_t low, std::size_t high);
+  void set_watermark_callback(WatermarkCallback cb) {
+    _on_watermark = std::move(cb);
+  }
+
+  /**
+   * Queue data to send, return false if the stream is write-blocked
+   * afterwards, the data is queued anyway, or if the queue failed.
+   * Can throw 'poller_error' exception.
+   */
+  bool send(const void *data, std::size_t len);
+  bool send(const std::string &s) { return send(s.data(), s.size()); }
+
+  /**
+   * Move all the readable bytes of 'buf' into the queue.
+   */
+  bool send(Buf &buf);
+
+  /**
+   * Gathered send, the regions are written by a single 'sendmsg' when
+   * nothing is queued, only what is left is copied into the queue.
+   */
+  bool send(const struct iovec *iov, int iovcnt);
+
+  /**
+   * Write the queued bytes, call it when the stream is writable.
+   * Return the bytes written, or -1 on error with errno set.
+   * Can throw 'poller_error' exception.
+   */
+  ssize_t flush();
+
+  // the error failing the queue, 0 if none.
+  int send_error() const { return _send_error; }
+
+  /**
+   * Fair reading:
+   *   'read_some' reads until the socket is drained, or the budget of bytes
+   *   or syscalls of a single call is used up. When the budget runs out on
+   *   an edge-triggered registration, a readable event of the stream is
+   *   queued on the readiness queue of its poller, so 'user_poll' reports
+   *   the stream again after the other ready streams had their turn.
+   *
+   *   Every read is sized by a hint adapting to what the peer sends, the
+   *   buffer grows for bulk senders and stays small for interactive ones.
+   *
+   * Return the bytes read, 0 on end of stream, -1 on error with errno set,
+   * an end of stream or error following some data is reported by the next
+   * call.
+   */
+  ssize_t read_some(Buf &buf);
+  void set_read_budget(std::size_t bytes, int syscalls);
+  std::size_t read_size_hint() const { return _read_hint; }
+
+  std::size_t queued_bytes() const {
+    return static_cast<std::size_t>(_outq.readable_bytes());
+  }
+  bool is_write_blocked() const { return _write_blocked; }
+
+  /**
+   * Per stream counters, off by default, a disabled stream pays a branch per
+   * syscall. Enabling resets the counters, 'stats' returns nullptr while
+   * disabled.
+   */
+  void enable_stats(bool on);
+  const TcpStreamStats *stats() const { return _stats.get(); }
+
+  /**
+   * Sample TCP_INFO of the socket, a single syscall.
+   * Can throw 'tcp_error' exception.
+   */
+  void tcp_info(TcpInfo &info) const;
+  void tcp_info(TcpInfo &info, std::error_code &ec) const noexcept;
+
 private:
-  TcpStream(int fd) : EventedFd(fd) {}
+  TcpStream(int fd);
   TcpStream(const TcpStream &) = delete;
   TcpStream &operator=(const TcpStream &) = delete;
 
-  static void connect_nob(int sock, const struct sockaddr *addr, socklen_t len,
-                          int timeout);
+  // returns 0, or the error of the connection.
+  static int connect_nob(int sock, const struct sockaddr *addr, socklen_t len,
+                         int timeout) noexcept;
+
+  // write the readable bytes of 'buf', without raising SIGPIPE.
+  ssize_t send_buf(Buf &buf);
+  // return false and fail the queue, if 'n' is a hard error.
+  bool check_send(ssize_t n);
+  void update_write_interest();
+  void check_watermarks();
+  void adapt_read_size(std::size_t n, std::size_t want);
+  void requeue_readable();
+  void count_read(ssize_t n, const Buf &buf);
+  void count_write(ssize_t n, std::size_t len);
+
+  // registration, kept to toggle the writable interest.
+  Poller *_poller;
+  Token _token;
+  Ready _interest;
+  PollOpt _opts;
+  bool _write_armed;
+
+  // outbound queue
+  Buf _outq;
+  std::size_t _low_watermark;
+  std::size_t _high_watermark;
+  bool _write_blocked;
+  int _send_error;
+  WatermarkCallback _on_watermark;
+
+  // fair reading
+  std::size_t _read_budget;
+  int _read_calls;
+  std::size_t _read_hint;
+  int _read_shrink;
+
+  std::unique_ptr<TcpStreamStats> _stats;
 };
 
 inline void swap(TcpStream &lhs, TcpStream &rhs) noexcept { lhs.swap(rhs); }
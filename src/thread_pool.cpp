@@ -0,0 +1,163 @@
+//
+// Created by byao on 1/28/18.
+// Copyright (c) 2018 byao. All rights reserved.
+//
+
+#include "thread_pool.hpp"
+#include <climits>
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+using namespace std;
+
+namespace bsnet {
+
+// tasks moved from the injection queue to a worker's deque at a time.
+static constexpr size_t InjectBatch = 32;
+// rounds of looking for work before parking.
+static constexpr int SpinRounds = 64;
+
+// the pool and index of the worker running on this thread.
+static thread_local ThreadPool *tl_pool = nullptr;
+static thread_local size_t tl_index = 0;
+
+static inline void futex_wait(atomic<uint32_t> *addr, uint32_t expected) {
+  ::syscall(SYS_futex, reinterpret_cast<uint32_t *>(addr),
+            FUTEX_WAIT_PRIVATE, expected, nullptr, nullptr, 0);
+}
+
+static inline void futex_wake(atomic<uint32_t> *addr, int n) {
+  ::syscall(SYS_futex, reinterpret_cast<uint32_t *>(addr),
+            FUTEX_WAKE_PRIVATE, n, nullptr, nullptr, 0);
+}
+
+ThreadPool::ThreadPool(size_t threads) {
+  if (threads == 0)
+    threads = 1;
+  for (size_t i = 0; i < threads; ++i) {
+    _workers.emplace_back(new Worker());
+    _workers.back()->seed = static_cast<uint32_t>(i * 2654435761u + 1);
+  }
+  for (size_t i = 0; i < threads; ++i)
+    _workers[i]->thread = thread([this, i] { run(i); });
+}
+
+ThreadPool::~ThreadPool() {
+  _stop.store(true);
+  _epoch.fetch_add(1);
+  futex_wake(&_epoch, INT_MAX);
+  for (auto &w : _workers)
+    w->thread.join();
+
+  Node *node;
+  for (auto &w : _workers) {
+    while (w->deque.take(node))
+      delete node;
+  }
+  while ((node = _injected.pop()))
+    delete node;
+}
+
+void ThreadPool::submit(Task task) {
+  auto *node = new Node(std::move(task));
+  if (tl_pool == this) {
+    _workers[tl_index]->deque.push(node);
+  } else {
+    _injected_size.fetch_add(1);
+    _injected.push(node);
+  }
+  wake_one();
+}
+
+void ThreadPool::wake_one() {
+  // pairs with the fence in 'park', either the sleeper sees the new work,
+  // or we see the sleeper.
+  atomic_thread_fence(memory_order_seq_cst);
+  if (_sleepers.load(memory_order_relaxed) > 0) {
+    _epoch.fetch_add(1);
+    futex_wake(&_epoch, 1);
+  }
+}
+
+void ThreadPool::run(size_t idx) {
+  tl_pool = this;
+  tl_index = idx;
+  Worker &self = *_workers[idx];
+
+  int idle = 0;
+  while (!_stop.load(memory_order_acquire)) {
+    Node *node = find_work(self);
+    if (!node) {
+      if (++idle < SpinRounds)
+        this_thread::yield();
+      else {
+        park();
+        idle = 0;
+      }
+      continue;
+    }
+    idle = 0;
+    // more work left behind, let a sleeper steal it.
+    if (!self.deque.empty())
+      wake_one();
+    unique_ptr<Node> owned(node);
+    owned->task();
+  }
+  tl_pool = nullptr;
+}
+
+ThreadPool::Node *ThreadPool::find_work(Worker &self) {
+  Node *node;
+  if (self.deque.take(node))
+    return node;
+  if ((node = drain_injected(self)))
+    return node;
+
+  // start from a random victim, so thieves spread out.
+  size_t n = _workers.size();
+  self.seed ^= self.seed << 13;
+  self.seed ^= self.seed >> 17;
+  self.seed ^= self.seed << 5;
+  size_t start = self.seed % n;
+  for (size_t i = 0; i < n; ++i) {
+    Worker &victim = *_workers[(start + i) % n];
+    if (&victim != &self && victim.deque.steal(node))
+      return node;
+  }
+  return nullptr;
+}
+
+ThreadPool::Node *ThreadPool::drain_injected(Worker &self) {
+  if (_injected_size.load(memory_order_relaxed) == 0 ||
+      _injected_busy.exchange(true, memory_order_acquire))
+    return nullptr;
+
+  Node *first = _injected.pop();
+  size_t n = first ? 1 : 0;
+  while (first && n < InjectBatch) {
+    Node *node = _injected.pop();
+    if (!node)
+      break;
+    self.deque.push(node);
+    ++n;
+  }
+  _injected_busy.store(false, memory_order_release);
+  _injected_size.fetch_sub(n);
+  return first;
+}
+
+void ThreadPool::park() {
+  uint32_t epoch = _epoch.load();
+  _sleepers.fetch_add(1);
+  atomic_thread_fence(memory_order_seq_cst);
+
+  bool has_work = _injected_size.load(memory_order_relaxed) > 0;
+  for (size_t i = 0; !has_work && i < _workers.size(); ++i)
+    has_work = !_workers[i]->deque.empty();
+  if (!has_work && !_stop.load())
+    futex_wait(&_epoch, epoch);
+  _sleepers.fetch_sub(1);
+}
+
+} // namespace bsnet
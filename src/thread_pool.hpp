@@ -0,0 +1,110 @@
+//
+// Created by byao on 1/28/18.
+// Copyright (c) 2018 byao. All rights reserved.
+//
+
+#ifndef BSNET_THREAD_POOL_HPP
+#define BSNET_THREAD_POOL_HPP
+
+#include "executor.hpp"
+#include "mpsc_queue.hpp"
+#include "task.hpp"
+#include "utility.hpp"
+#include "ws_deque.hpp"
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace bsnet {
+
+/**
+ * Work-stealing thread pool, to move CPU bound work, ex. parsing or
+ * compression, off the poller threads.
+ *
+ * Every worker has its own deque, a task submitted by a worker is pushed to
+ * its deque, a task submitted by any other thread goes to a lock-free
+ * injection queue, which idle workers drain in batches. A worker runs its
+ * own tasks LIFO, and steals from the others FIFO when it runs out. Idle
+ * workers park on a futex, and are woken up by new work.
+ *
+ *   ThreadPool pool(4);
+ *   pool.submit(poller->executor(), [req] { return compress(req); },
+ *               [](Buffer out) { ... on the poller thread ... });
+ *
+ * Tasks must not throw. Tasks still queued when the pool is destroyed are
+ * dropped.
+ */
+class ThreadPool : public NonCopyable {
+public:
+  explicit ThreadPool(
+      std::size_t threads = std::thread::hardware_concurrency());
+  ~ThreadPool();
+
+  void submit(Task task);
+
+  /**
+   * Run 'work' on the pool, then 'done' with its result on the poller of
+   * 'ex', 'done' is dropped if the poller is gone when the work completes.
+   */
+  template <typename Work, typename Done>
+  void submit(Executor ex, Work work, Done done) {
+    submit(Task([ ex = std::move(ex), work = std::move(work),
+                  done = std::move(done) ]() mutable {
+      complete(ex, work, done,
+               std::is_void<typename std::result_of<Work()>::type>());
+    }));
+  }
+
+  std::size_t size() const { return _workers.size(); }
+
+private:
+  struct Node : public mpsc_node_t {
+    explicit Node(Task &&t) : task(std::move(t)) {}
+    Task task;
+  };
+
+  struct Worker {
+    ws_deque_t<Node *> deque;
+    std::thread thread;
+    std::uint32_t seed;
+  };
+
+  template <typename Work, typename Done>
+  static void complete(Executor &ex, Work &work, Done &done, std::false_type) {
+    ex.post([ done = std::move(done), r = work() ]() mutable {
+      done(std::move(r));
+    });
+  }
+
+  template <typename Work, typename Done>
+  static void complete(Executor &ex, Work &work, Done &done, std::true_type) {
+    work();
+    ex.post(std::move(done));
+  }
+
+  void run(std::size_t idx);
+  Node *find_work(Worker &self);
+  Node *drain_injected(Worker &self);
+  void park();
+  void wake_one();
+
+  std::vector<std::unique_ptr<Worker>> _workers;
+
+  // injection queue, consumed by one worker at a time.
+  mpsc_queue_t<Node> _injected;
+  std::atomic<std::size_t> _injected_size{0};
+  std::atomic<bool> _injected_busy{false};
+
+  // futex word, bumped to wake up the parked workers.
+  std::atomic<std::uint32_t> _epoch{0};
+  std::atomic<std::size_t> _sleepers{0};
+  std::atomic<bool> _stop{false};
+};
+
+} // namespace bsnet
+
+#endif // BSNET_THREAD_POOL_HPP
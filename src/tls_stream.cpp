@@ -0,0 +1,672 @@
+//
+// Created by byao on 2/16/18.
+// Copyright (c) 2018 byao. All rights reserved.
+//
+
+#include "tls_stream.hpp"
+#include "logger.hpp"
+#include "neterr.hpp"
+#include "poller.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <list>
+#include <mutex>
+#include <openssl/bio.h>
+#include <openssl/err.h>
+#include <openssl/pem.h>
+#include <openssl/ssl.h>
+#include <openssl/x509v3.h>
+#include <sys/sendfile.h>
+#include <unistd.h>
+#include <unordered_map>
+#include <utility>
+
+namespace bsnet {
+
+using std::error_code;
+using std::size_t;
+using std::string;
+
+namespace {
+
+// a file is encrypted by chunks of this, without kTLS
+constexpr size_t FileChunk = 64 * 1024;
+
+using BioPtr = std::unique_ptr<BIO, decltype(&BIO_free)>;
+
+// the reason of the last failure in the tls library.
+string tls_reason(const char *what) {
+  string msg(what);
+  unsigned long e = ERR_get_error();
+  if (e) {
+    char buf[256];
+    ERR_error_string_n(e, buf, sizeof(buf));
+    msg += ": ";
+    msg += buf;
+  }
+  ERR_clear_error();
+  return msg;
+}
+
+BioPtr pem_bio(const string &pem) {
+  BioPtr bio(BIO_new_mem_buf(pem.data(), static_cast<int>(pem.size())),
+             &BIO_free);
+  if (!bio)
+    throw tls_error(tls_reason("BIO_new_mem_buf"));
+  return bio;
+}
+
+/*
+ * BIO over a ByteBuffer, OpenSSL reads the records from the buffer the
+ * socket is read into, and writes the records into the buffer handed to
+ * the tcp stream, instead of its own memory BIO in between.
+ */
+int buffer_write(BIO *bio, const char *data, int len) {
+  auto *buf = static_cast<ByteBuffer *>(BIO_get_data(bio));
+  BIO_clear_retry_flags(bio);
+  buf->put(data, static_cast<size_t>(len));
+  return len;
+}
+
+int buffer_read(BIO *bio, char *data, int len) {
+  auto *buf = static_cast<ByteBuffer *>(BIO_get_data(bio));
+  BIO_clear_retry_flags(bio);
+  int n = std::min(len, static_cast<int>(buf->readable_bytes()));
+  if (n == 0) {
+    BIO_set_retry_read(bio);
+    return -1;
+  }
+  buf->take(data, static_cast<size_t>(n));
+  return n;
+}
+
+long buffer_ctrl(BIO *bio, int cmd, long, void *) {
+  switch (cmd) {
+  case BIO_CTRL_FLUSH:
+    return 1;
+  case BIO_CTRL_PENDING:
+    return static_cast<ByteBuffer *>(BIO_get_data(bio))->readable_bytes();
+  default:
+    return 0;
+  }
+}
+
+int buffer_create(BIO *bio) {
+  BIO_set_init(bio, 1);
+  return 1;
+}
+
+BIO *new_buffer_bio(ByteBuffer *buf) {
+  static BIO_METHOD *method = [] {
+    BIO_METHOD *m = BIO_meth_new(BIO_get_new_index() | BIO_TYPE_SOURCE_SINK,
+                                 "bsnet buffer");
+    BIO_meth_set_write(m, buffer_write);
+    BIO_meth_set_read(m, buffer_read);
+    BIO_meth_set_ctrl(m, buffer_ctrl);
+    BIO_meth_set_create(m, buffer_create);
+    return m;
+  }();
+  BIO *bio = BIO_new(method);
+  if (!bio)
+    throw tls_error(tls_reason("BIO_new"));
+  BIO_set_data(bio, buf);
+  return bio;
+}
+
+} // namespace
+
+struct TlsContext::Inner {
+  explicit Inner(SSL_CTX *c) : ctx(c) {}
+
+  ~Inner() {
+    for (auto &s : sessions)
+      SSL_SESSION_free(s.second);
+    SSL_CTX_free(ctx);
+  }
+
+  // takes the reference of 's'
+  void put_session(const string &key, SSL_SESSION *s) {
+    std::lock_guard<std::mutex> lock(mu);
+    auto it = index.find(key);
+    if (it != index.end()) {
+      SSL_SESSION_free(it->second->second);
+      sessions.erase(it->second);
+      index.erase(it);
+    }
+    sessions.emplace_front(key, s);
+    index[key] = sessions.begin();
+    trim();
+  }
+
+  // returns a new reference, or nullptr
+  SSL_SESSION *get_session(const string &key) {
+    std::lock_guard<std::mutex> lock(mu);
+    auto it = index.find(key);
+    if (it == index.end())
+      return nullptr;
+    sessions.splice(sessions.begin(), sessions, it->second);
+    SSL_SESSION *s = it->second->second;
+    SSL_SESSION_up_ref(s);
+    return s;
+  }
+
+  // the least recently used sessions go first.
+  void trim() {
+    while (sessions.size() > cache_size) {
+      SSL_SESSION_free(sessions.back().second);
+      index.erase(sessions.back().first);
+      sessions.pop_back();
+    }
+  }
+
+  static int new_session(SSL *ssl, SSL_SESSION *s) {
+    auto *key = static_cast<const string *>(SSL_get_app_data(ssl));
+    auto *inner =
+        static_cast<Inner *>(SSL_CTX_get_app_data(SSL_get_SSL_CTX(ssl)));
+    if (!key || key->empty() || !inner)
+      return 0;
+    inner->put_session(*key, s);
+    return 1;
+  }
+
+  SSL_CTX *ctx;
+  bool ktls = false;
+
+  std::mutex mu;
+  std::size_t cache_size = DefaultSessionCacheSize;
+  // the most recently used first
+  std::list<std::pair<string, SSL_SESSION *>> sessions;
+  std::unordered_map<string, decltype(sessions)::iterator> index;
+};
+
+constexpr std::size_t TlsContext::DefaultSessionCacheSize;
+
+TlsContext TlsContext::client() {
+  SSL_CTX *ctx = SSL_CTX_new(TLS_client_method());
+  if (!ctx)
+    throw tls_error(tls_reason("SSL_CTX_new"));
+  auto inner = std::make_shared<Inner>(ctx);
+  SSL_CTX_set_app_data(ctx, inner.get());
+  SSL_CTX_set_min_proto_version(ctx, TLS1_2_VERSION);
+  SSL_CTX_set_verify(ctx, SSL_VERIFY_PEER, nullptr);
+  SSL_CTX_set_default_verify_paths(ctx);
+  SSL_CTX_set_session_cache_mode(ctx, SSL_SESS_CACHE_CLIENT |
+                                          SSL_SESS_CACHE_NO_INTERNAL_STORE);
+  SSL_CTX_sess_set_new_cb(ctx, Inner::new_session);
+  return TlsContext(std::move(inner));
+}
+
+TlsContext TlsContext::server(const string &cert_pem, const string &key_pem) {
+  SSL_CTX *ctx = SSL_CTX_new(TLS_server_method());
+  if (!ctx)
+    throw tls_error(tls_reason("SSL_CTX_new"));
+  auto inner = std::make_shared<Inner>(ctx);
+  SSL_CTX_set_app_data(ctx, inner.get());
+  SSL_CTX_set_min_proto_version(ctx, TLS1_2_VERSION);
+
+  // the certificate, then its chain
+  BioPtr bio = pem_bio(cert_pem);
+  X509 *cert = PEM_read_bio_X509(bio.get(), nullptr, nullptr, nullptr);
+  if (!cert)
+    throw tls_error(tls_reason("PEM_read_bio_X509"));
+  int ok = SSL_CTX_use_certificate(ctx, cert);
+  X509_free(cert);
+  if (ok != 1)
+    throw tls_error(tls_reason("SSL_CTX_use_certificate"));
+  while ((cert = PEM_read_bio_X509(bio.get(), nullptr, nullptr, nullptr)))
+    SSL_CTX_add0_chain_cert(ctx, cert);
+  ERR_clear_error();
+
+  bio = pem_bio(key_pem);
+  EVP_PKEY *key = PEM_read_bio_PrivateKey(bio.get(), nullptr, nullptr, nullptr);
+  if (!key)
+    throw tls_error(tls_reason("PEM_read_bio_PrivateKey"));
+  ok = SSL_CTX_use_PrivateKey(ctx, key);
+  EVP_PKEY_free(key);
+  if (ok != 1 || SSL_CTX_check_private_key(ctx) != 1)
+    throw tls_error(tls_reason("SSL_CTX_use_PrivateKey"));
+
+  static const unsigned char id[] = "bsnet";
+  SSL_CTX_set_session_id_context(ctx, id, sizeof(id) - 1);
+  return TlsContext(std::move(inner));
+}
+
+void TlsContext::add_ca(const string &pem) {
+  BioPtr bio = pem_bio(pem);
+  X509_STORE *store = SSL_CTX_get_cert_store(_inner->ctx);
+  int added = 0;
+  X509 *cert;
+  while ((cert = PEM_read_bio_X509(bio.get(), nullptr, nullptr, nullptr))) {
+    int ok = X509_STORE_add_cert(store, cert);
+    X509_free(cert);
+    if (ok != 1)
+      throw tls_error(tls_reason("X509_STORE_add_cert"));
+    ++added;
+  }
+  ERR_clear_error();
+  if (added == 0)
+    throw tls_error("add_ca: no certificate");
+}
+
+void TlsContext::set_verify(bool on) {
+  SSL_CTX_set_verify(_inner->ctx, on ? SSL_VERIFY_PEER : SSL_VERIFY_NONE,
+                     nullptr);
+}
+
+void TlsContext::set_ktls(bool on) {
+  _inner->ktls = on;
+#ifdef SSL_OP_ENABLE_KTLS
+  if (on)
+    SSL_CTX_set_options(_inner->ctx, SSL_OP_ENABLE_KTLS);
+  else
+    SSL_CTX_clear_options(_inner->ctx, SSL_OP_ENABLE_KTLS);
+#endif
+}
+
+bool TlsContext::ktls() const { return _inner->ktls; }
+
+void TlsContext::set_session_cache_size(std::size_t n) {
+  std::lock_guard<std::mutex> lock(_inner->mu);
+  _inner->cache_size = n;
+  _inner->trim();
+}
+
+std::size_t TlsContext::cached_sessions() const {
+  std::lock_guard<std::mutex> lock(_inner->mu);
+  return _inner->sessions.size();
+}
+
+ssl_ctx_st *TlsContext::native() const { return _inner->ctx; }
+
+struct TlsStream::Channel {
+  // records read from the socket
+  ByteBuffer in;
+  // records to hand to the tcp stream
+  ByteBuffer out;
+  // data sent before the handshake completed
+  ByteBuffer early;
+  // chunks of a file sent without kTLS
+  ByteBuffer file;
+  string session_key;
+  std::shared_ptr<TlsContext::Inner> ctx;
+};
+
+TlsStream::TlsStream(TcpStream tcp, const TlsContext &ctx, bool is_server)
+    : _tcp(std::move(tcp)), _ssl(nullptr), _chan(new Channel),
+      _established(false), _ktls_send(false), _closed(false),
+      _send_error(0), _poller(nullptr), _token(), _interest(Ready::empty()),
+      _opts(PollOpt::empty()), _write_armed(false) {
+  _chan->ctx = ctx._inner;
+  BioPtr rbio(new_buffer_bio(&_chan->in), &BIO_free);
+  // with kTLS, OpenSSL writes the handshake to the socket, and installs the
+  // keys in the kernel, it can't through another BIO.
+  BioPtr wbio(ctx._inner->ktls ? BIO_new_socket(_tcp.fd(), BIO_NOCLOSE)
+                               : new_buffer_bio(&_chan->out),
+              &BIO_free);
+  // nothing throws once '_ssl' is set, the destructor won't run otherwise.
+  if (!rbio || !wbio)
+    throw tls_error(tls_reason("BIO_new"));
+  _ssl = SSL_new(ctx._inner->ctx);
+  if (!_ssl)
+    throw tls_error(tls_reason("SSL_new"));
+  SSL_set_mode(_ssl, SSL_MODE_ENABLE_PARTIAL_WRITE |
+                         SSL_MODE_ACCEPT_MOVING_WRITE_BUFFER);
+  SSL_set_app_data(_ssl, &_chan->session_key);
+  SSL_set_bio(_ssl, rbio.release(), wbio.release());
+  if (is_server)
+    SSL_set_accept_state(_ssl);
+  else
+    SSL_set_connect_state(_ssl);
+}
+
+TlsStream TlsStream::client(TcpStream tcp, const TlsContext &ctx,
+                            const string &server_name,
+                            const string &session_key) {
+  TlsStream s(std::move(tcp), ctx, false);
+  if (!server_name.empty()) {
+    SSL_set_tlsext_host_name(s._ssl, server_name.c_str());
+    SSL_set1_host(s._ssl, server_name.c_str());
+  }
+  s._chan->session_key = session_key.empty() ? server_name : session_key;
+  if (!s._chan->session_key.empty()) {
+    SSL_SESSION *sess = s._chan->ctx->get_session(s._chan->session_key);
+    if (sess) {
+      SSL_set_session(s._ssl, sess);
+      SSL_SESSION_free(sess);
+    }
+  }
+  return s;
+}
+
+TlsStream TlsStream::server(TcpStream tcp, const TlsContext &ctx) {
+  return TlsStream(std::move(tcp), ctx, true);
+}
+
+TlsStream::TlsStream(TlsStream &&other) noexcept
+    : _tcp(std::move(other._tcp)), _ssl(other._ssl),
+      _chan(std::move(other._chan)), _established(other._established),
+      _ktls_send(other._ktls_send), _closed(other._closed),
+      _send_error(other._send_error), _poller(other._poller), _token(other._token),
+      _interest(other._interest), _opts(other._opts),
+      _write_armed(other._write_armed) {
+  other._ssl = nullptr;
+  other._poller = nullptr;
+}
+
+TlsStream &TlsStream::operator=(TlsStream &&other) noexcept {
+  if (this != &other) {
+    using std::swap;
+    _tcp.swap(other._tcp);
+    swap(_ssl, other._ssl);
+    swap(_chan, other._chan);
+    swap(_established, other._established);
+    swap(_ktls_send, other._ktls_send);
+    swap(_closed, other._closed);
+    swap(_send_error, other._send_error);
+    swap(_poller, other._poller);
+    swap(_token, other._token);
+    swap(_interest, other._interest);
+    swap(_opts, other._opts);
+    swap(_write_armed, other._write_armed);
+  }
+  return *this;
+}
+
+TlsStream::~TlsStream() noexcept {
+  if (_ssl)
+    SSL_free(_ssl);
+}
+
+void TlsStream::register_on(Poller &poller, Token tok, Ready interest,
+                            PollOpt opts) {
+  error_code ec;
+  register_on(poller, tok, interest, opts, ec);
+  if (ec)
+    throw poller_error();
+}
+
+void TlsStream::reregister_on(Poller &poller, Token tok, Ready interest,
+                              PollOpt opts) {
+  error_code ec;
+  reregister_on(poller, tok, interest, opts, ec);
+  if (ec)
+    throw poller_error();
+}
+
+void TlsStream::deregister_on(Poller &poller) {
+  error_code ec;
+  deregister_on(poller, ec);
+  if (ec)
+    throw poller_error();
+}
+
+void TlsStream::register_on(Poller &poller, Token tok, Ready interest,
+                            PollOpt opts, error_code &ec) noexcept {
+  Ready r = _write_armed ? interest | Ready::writable() : interest;
+  _tcp.register_on(poller, tok, r, opts, ec);
+  if (ec)
+    return;
+  _poller = &poller;
+  _token = tok;
+  _interest = interest;
+  _opts = opts;
+}
+
+void TlsStream::reregister_on(Poller &poller, Token tok, Ready interest,
+                              PollOpt opts, error_code &ec) noexcept {
+  Ready r = _write_armed ? interest | Ready::writable() : interest;
+  _tcp.reregister_on(poller, tok, r, opts, ec);
+  if (ec)
+    return;
+  _poller = &poller;
+  _token = tok;
+  _interest = interest;
+  _opts = opts;
+}
+
+void TlsStream::deregister_on(Poller &poller, error_code &ec) noexcept {
+  _tcp.deregister_on(poller, ec);
+  if (ec)
+    return;
+  _poller = nullptr;
+}
+
+bool TlsStream::handshake() {
+  if (_established)
+    return true;
+  ssize_t n = _tcp.read_some(_chan->in);
+  if (n == -1 && errno != EAGAIN && errno != EWOULDBLOCK)
+    throw tls_error(string("handshake: ") + ::strerror(errno));
+
+  ERR_clear_error();
+  int r = SSL_do_handshake(_ssl);
+  push_records();
+  if (r == 1) {
+    on_established();
+    return true;
+  }
+  switch (SSL_get_error(_ssl, r)) {
+  case SSL_ERROR_WANT_READ:
+    if (n == 0)
+      throw tls_error("handshake: connection closed by peer");
+    arm_write(false);
+    return false;
+  case SSL_ERROR_WANT_WRITE:
+    // only the socket BIO of kTLS blocks.
+    arm_write(true);
+    return false;
+  default:
+    long verify = SSL_get_verify_result(_ssl);
+    if (verify != X509_V_OK)
+      throw tls_error(string("handshake: ") +
+                      X509_verify_cert_error_string(verify));
+    throw tls_error(tls_reason("handshake"));
+  }
+}
+
+void TlsStream::on_established() {
+  _established = true;
+  arm_write(false);
+  start_ktls();
+  if (_chan->early.readable_bytes() > 0) {
+    ByteBuffer early;
+    early.swap(_chan->early);
+    send(early);
+  }
+}
+
+void TlsStream::start_ktls() {
+  BIO *wbio = SSL_get_wbio(_ssl);
+  if (BIO_method_type(wbio) != BIO_TYPE_SOCKET)
+    return;
+  // kTLS is there since OpenSSL 3.0.
+#ifdef BIO_get_ktls_send
+  _ktls_send = BIO_get_ktls_send(wbio);
+#endif
+  // not supported by the kernel or the cipher, encrypt in user space, and
+  // queue the records as usual.
+  if (!_ktls_send)
+    SSL_set0_wbio(_ssl, new_buffer_bio(&_chan->out));
+}
+
+bool TlsStream::push_records() {
+  if (_chan->out.readable_bytes() == 0)
+    return !_tcp.is_write_blocked();
+  return _tcp.send(_chan->out);
+}
+
+void TlsStream::arm_write(bool on) {
+  if (_write_armed == on)
+    return;
+  _write_armed = on;
+  if (_poller) {
+    Ready r = on ? _interest | Ready::writable() : _interest;
+    _tcp.reregister_on(*_poller, _token, r, _opts);
+  }
+}
+
+ssize_t TlsStream::read(Buf &buf) {
+  if (!_established && !handshake()) {
+    errno = EAGAIN;
+    return -1;
+  }
+  ssize_t n = _tcp.read_some(_chan->in);
+  if (n == -1 && errno != EAGAIN && errno != EWOULDBLOCK)
+    return -1;
+
+  ssize_t total = 0;
+  bool failed = false;
+  while (!_closed) {
+    buf.ensure_writable(4096);
+    struct iovec vec[2];
+    buf.writable_iovec(&vec[0]);
+    size_t got;
+    ERR_clear_error();
+    if (SSL_read_ex(_ssl, vec[0].iov_base, vec[0].iov_len, &got) == 1) {
+      buf.commit(static_cast<Buf::SizeType>(got));
+      total += static_cast<ssize_t>(got);
+      continue;
+    }
+    int err = SSL_get_error(_ssl, 0);
+    if (err == SSL_ERROR_ZERO_RETURN)
+      _closed = true;
+    else if (err != SSL_ERROR_WANT_READ)
+      failed = true;
+    break;
+  }
+  // post-handshake messages, ex. a key update
+  push_records();
+
+  if (total > 0)
+    return total;
+  if (failed) {
+    errno = EPROTO;
+    return -1;
+  }
+  if (_closed)
+    return 0;
+  // a FIN without close_notify, what was sent may have been truncated.
+  if (n == 0) {
+    errno = ECONNRESET;
+    return -1;
+  }
+  errno = EAGAIN;
+  return -1;
+}
+
+bool TlsStream::send(const void *data, size_t len) {
+  if (send_error()) {
+    errno = send_error();
+    return false;
+  }
+  if (!_established) {
+    _chan->early.put(data, len);
+    return !_tcp.is_write_blocked();
+  }
+  if (_ktls_send)
+    return _tcp.send(data, len);
+
+  ERR_clear_error();
+  const auto *p = static_cast<const char *>(data);
+  while (len > 0) {
+    size_t written;
+    // never blocks, the records go to the buffer, so it failed for good.
+    if (SSL_write_ex(_ssl, p, len, &written) != 1) {
+      BSNET_LOG(LogLevel::Warn, "SSL_write in TlsStream::send, fd %lld",
+                _tcp.fd());
+      _send_error = EPROTO;
+      // the records before the failure, ex. an alert, are still sent.
+      push_records();
+      errno = EPROTO;
+      return false;
+    }
+    p += written;
+    len -= written;
+  }
+  return push_records();
+}
+
+bool TlsStream::send(Buf &buf) {
+  if (_established && _ktls_send)
+    return _tcp.send(buf);
+  struct iovec vio[2];
+  int len = buf.readable_iovec(&vio[0]);
+  bool ok = true;
+  for (int i = 0; i < len && ok; ++i)
+    ok = send(vio[i].iov_base, vio[i].iov_len) || !send_error();
+  buf.clear();
+  if (send_error()) {
+    errno = send_error();
+    return false;
+  }
+  return !_tcp.is_write_blocked();
+}
+
+ssize_t TlsStream::flush() { return _tcp.flush(); }
+
+ssize_t TlsStream::sendfile(int in_fd, off_t *offset, size_t count) {
+  if (!_established) {
+    errno = EAGAIN;
+    return -1;
+  }
+  if (_ktls_send) {
+    // the data queued goes first.
+    if (_tcp.queued_bytes() > 0 &&
+        (_tcp.flush() == -1 || _tcp.queued_bytes() > 0)) {
+      errno = EAGAIN;
+      return -1;
+    }
+    ssize_t n = ::sendfile(_tcp.fd(), in_fd, offset, count);
+    int err = errno;
+    // wait for writable by ourselves, the queue of the stream is empty.
+    arm_write(n == -1 ? err == EAGAIN : static_cast<size_t>(n) < count);
+    errno = err;
+    return n;
+  }
+
+  // don't read more of the file than the queue takes.
+  if (_tcp.is_write_blocked()) {
+    errno = EAGAIN;
+    return -1;
+  }
+  size_t chunk = std::min(count, FileChunk);
+  ByteBuffer &file = _chan->file;
+  file.ensure_writable(static_cast<Buf::SizeType>(chunk));
+  struct iovec vec[2];
+  file.writable_iovec(&vec[0]);
+  chunk = std::min(chunk, vec[0].iov_len);
+  ssize_t n = offset ? ::pread(in_fd, vec[0].iov_base, chunk, *offset)
+                     : ::read(in_fd, vec[0].iov_base, chunk);
+  if (n <= 0)
+    return n;
+  if (!send(vec[0].iov_base, static_cast<size_t>(n)) && send_error()) {
+    errno = send_error();
+    return -1;
+  }
+  if (offset)
+    *offset += n;
+  return n;
+}
+
+bool TlsStream::shutdown() {
+  if (!_established)
+    return true;
+  // with kTLS the alert is written to the socket, behind the queue.
+  if (_ktls_send && _tcp.queued_bytes() > 0)
+    return false;
+  ERR_clear_error();
+  SSL_shutdown(_ssl);
+  push_records();
+  return true;
+}
+
+bool TlsStream::session_reused() const {
+  return SSL_session_reused(_ssl) == 1;
+}
+
+const char *TlsStream::version() const { return SSL_get_version(_ssl); }
+
+const char *TlsStream::cipher() const { return SSL_get_cipher_name(_ssl); }
+
+} // namespace bsnet
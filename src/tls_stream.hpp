@@ -0,0 +1,208 @@
+//
+// Created by byao on 2/16/18.
+// Copyright (c) 2018 byao. All rights reserved.
+//
+
+#ifndef BSNET_TLS_STREAM_HPP
+#define BSNET_TLS_STREAM_HPP
+
+#include "bytebuffer.hpp"
+#include "event.hpp"
+#include "tcp_stream.hpp"
+#include "utility.hpp"
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <sys/types.h>
+#include <system_error>
+
+// OpenSSL types, its headers stay out of ours.
+struct ssl_st;
+struct ssl_ctx_st;
+
+namespace bsnet {
+
+/**
+ * Configuration and certificates shared by TLS streams, a cheap handle,
+ * copies share the same context. Built on OpenSSL.
+ *
+ * A client context verifies the peer against the system CAs and the ones
+ * added, and keeps a session cache per server, so a reconnection resumes
+ * the session with an abbreviated handshake. A server context resumes with
+ * session tickets. A session is resumed only if its stream was shut down
+ * cleanly, OpenSSL drops it otherwise.
+ *
+ * Following methods can throw 'tls_error' exception.
+ */
+class TlsContext {
+public:
+  static constexpr std::size_t DefaultSessionCacheSize = 256;
+
+  static TlsContext client();
+  static TlsContext server(const std::string &cert_pem,
+                           const std::string &key_pem);
+
+  /**
+   * Trust the CA certificates of 'pem'.
+   */
+  void add_ca(const std::string &pem);
+  void set_verify(bool on);
+
+  /**
+   * Offload the encryption of sent records to the kernel (kTLS), when the
+   * kernel and the negotiated cipher support it, so 'sendfile' sends files
+   * without reading them into user space. Falls back silently.
+   */
+  void set_ktls(bool on);
+  bool ktls() const;
+
+  void set_session_cache_size(std::size_t n);
+  std::size_t cached_sessions() const;
+
+  ssl_ctx_st *native() const;
+
+private:
+  friend class TlsStream;
+  struct Inner;
+
+  explicit TlsContext(std::shared_ptr<Inner> inner)
+      : _inner(std::move(inner)) {}
+
+  std::shared_ptr<Inner> _inner;
+};
+
+/**
+ * TLS over a nonblocking TcpStream.
+ *
+ * The records go through ByteBuffers: what the socket reads is decrypted
+ * from the inbound buffer, and the encrypted records are handed to the
+ * managed queue of the stream, written directly when nothing is queued.
+ * With kTLS, the handshake is written to the socket by OpenSSL, which
+ * installs the keys in the kernel, then plain data is sent as is and
+ * encrypted by the kernel; the receive side stays in user space.
+ *
+ * The stream is registered like its TcpStream. 'handshake' advances the
+ * handshake on every readiness event until it returns true, 'read' and
+ * 'send' drive it too, data sent before it completes is queued.
+ */
+class TlsStream : public Evented {
+public:
+  using Buf = ByteBuffer;
+
+  /**
+   * 'server_name' is sent in SNI and verified against the certificate, it
+   * keys the session cache unless 'session_key' is given.
+   * Can throw 'tls_error' exception.
+   */
+  static TlsStream client(TcpStream tcp, const TlsContext &ctx,
+                          const std::string &server_name,
+                          const std::string &session_key = std::string());
+  static TlsStream server(TcpStream tcp, const TlsContext &ctx);
+
+  TlsStream(TlsStream &&other) noexcept;
+  TlsStream &operator=(TlsStream &&other) noexcept;
+  ~TlsStream() noexcept override;
+
+  void register_on(Poller &poller, Token tok, Ready interest,
+                   PollOpt opts) override;
+  void reregister_on(Poller &poller, Token tok, Ready interest,
+                     PollOpt opts) override;
+  void deregister_on(Poller &poller) override;
+
+  void register_on(Poller &poller, Token tok, Ready interest, PollOpt opts,
+                   std::error_code &ec) noexcept override;
+  void reregister_on(Poller &poller, Token tok, Ready interest, PollOpt opts,
+                     std::error_code &ec) noexcept override;
+  void deregister_on(Poller &poller, std::error_code &ec) noexcept override;
+
+  /**
+   * Return true once the handshake is done.
+   * Can throw 'tls_error' exception, if it fails.
+   */
+  bool handshake();
+  bool is_established() const { return _established; }
+
+  /**
+   * Read and decrypt into 'buf', return the bytes decrypted, 0 once the peer
+   * sent close_notify, -1 with errno set on error, EAGAIN if nothing
+   * arrived, EPROTO if the peer broke the protocol, ECONNRESET if the
+   * connection was closed without close_notify, as a truncation would.
+   * Can throw 'tls_error' exception, if the handshake fails.
+   */
+  ssize_t read(Buf &buf);
+
+  /**
+   * Encrypt and queue as 'TcpStream::send', return false if the stream is
+   * write-blocked afterwards, or failed: the data is dropped then, errno and
+   * 'send_error' are EPROTO if the TLS engine failed, ex. after a fatal
+   * alert or 'shutdown', or the error of the tcp stream.
+   */
+  bool send(const void *data, std::size_t len);
+  bool send(const std::string &s) { return send(s.data(), s.size()); }
+  bool send(Buf &buf);
+
+  /**
+   * Write the queued records, call it when the stream is writable.
+   */
+  ssize_t flush();
+
+  int send_error() const {
+    return _send_error ? _send_error : _tcp.send_error();
+  }
+
+  /**
+   * Send up to 'count' bytes of 'in_fd' from '*offset', and advance it, as
+   * 'sendfile(2)'. Straight from the page cache with kTLS, otherwise read
+   * and encrypted in chunks. Return the bytes sent or queued, -1 with errno
+   * set on error, EAGAIN while the queue is not drained with kTLS, or is
+   * above the high watermark without.
+   */
+  ssize_t sendfile(int in_fd, off_t *offset, std::size_t count);
+
+  /**
+   * Send the close_notify alert, return false if it must wait for the queue
+   * to drain, call it again after 'flush'.
+   */
+  bool shutdown();
+
+  bool session_reused() const;
+  bool ktls_send() const { return _ktls_send; }
+  // the negotiated protocol version and cipher, for logs.
+  const char *version() const;
+  const char *cipher() const;
+
+  TcpStream &tcp() { return _tcp; }
+  const TcpStream &tcp() const { return _tcp; }
+
+private:
+  struct Channel;
+
+  TlsStream(TcpStream tcp, const TlsContext &ctx, bool is_server);
+  TlsStream(const TlsStream &) = delete;
+  TlsStream &operator=(const TlsStream &) = delete;
+
+  void start_ktls();
+  void on_established();
+  // hand the encrypted records to the tcp stream.
+  bool push_records();
+  void arm_write(bool on);
+
+  TcpStream _tcp;
+  ssl_st *_ssl;
+  std::unique_ptr<Channel> _chan;
+  bool _established;
+  bool _ktls_send;
+  bool _closed;
+  int _send_error;
+
+  // the registration, to wait for writable in a kTLS handshake.
+  Poller *_poller;
+  Token _token;
+  Ready _interest;
+  PollOpt _opts;
+  bool _write_armed;
+};
+
+} // namespace bsnet
+
+#endif // BSNET_TLS_STREAM_HPP
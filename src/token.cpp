@@ -4,6 +4,8 @@
 //
 
 #include "token.hpp"
+#include <algorithm>
+#include <cassert>
 #include <cerrno>
 #include <cstring>
 
@@ -13,64 +15,99 @@ namespace bsnet {
 
 IMPL_ERR(token_exhuasted);
 
-static constexpr int BitsPerInt = sizeof(Int) << 3;
+static constexpr int BitsPerWord = 64;
+static constexpr int WordShift = 6;
 
-inline constexpr uint64_t FindOffset(size_t pos, int offset) {
-  return (pos << 5) + offset;
+inline constexpr uint64_t RoundUp(uint64_t v) {
+  return (v + BitsPerWord - 1) & ~static_cast<uint64_t>(BitsPerWord - 1);
 }
 
-inline constexpr uint32_t NextPowerOf2(uint32_t v) {
-  v--;
-  v |= v >> 1;
-  v |= v >> 2;
-  v |= v >> 4;
-  v |= v >> 8;
-  v |= v >> 16;
-  v++;
-  return v;
-}
+constexpr uint32_t TokenPool::MaxSize;
 
-inline constexpr uint32_t RoundNext(uint32_t value, uint32_t size) {
-  return (value + 1) & (size - 1);
+TokenPool::TokenPool(uint32_t size, uint32_t max_size)
+    : _capacity(static_cast<uint32_t>(RoundUp(max(size, 1u)))),
+      _max_size(static_cast<uint32_t>(RoundUp(max(max_size, 1u)))), _used(0),
+      _levels(1) {
+  _capacity = min(_capacity, _max_size);
+  _levels[0].assign(_capacity >> WordShift, ~Word(0));
+  _gens.assign(_capacity, 1);
+  build_summary();
 }
 
-Token::Token(std::uint64_t tok) : _tok(tok) {}
+void TokenPool::build_summary() {
+  _levels.resize(1);
+  while (_levels.back().size() > 1) {
+    const auto &below = _levels.back();
+    vector<Word> above((below.size() + BitsPerWord - 1) >> WordShift, 0);
+    for (size_t i = 0; i < below.size(); ++i) {
+      if (below[i] != 0)
+        above[i >> WordShift] |= Word(1) << (i & (BitsPerWord - 1));
+    }
+    _levels.push_back(std::move(above));
+  }
+}
 
-Token::operator std::uint64_t() const { return _tok; }
+void TokenPool::grow() {
+  if (_capacity >= _max_size)
+    throw token_exhuasted("token pool exhausted");
+  _capacity = static_cast<uint32_t>(
+      min(static_cast<uint64_t>(_capacity) << 1, uint64_t(_max_size)));
+  _levels[0].resize(_capacity >> WordShift, ~Word(0));
+  _gens.resize(_capacity, 1);
+  build_summary();
+}
 
-bool operator==(Token lhs, Token rhs) { return lhs._tok == rhs._tok; }
+Token TokenPool::alloc_token() {
+  if (_levels.back()[0] == 0)
+    grow();
 
-TokenPool::TokenPool(uint32_t size)
-    : _size(NextPowerOf2(((size - 1) >> 5) + 1)), _idx(0),
-      _mem(new Int[_size]()) {}
+  // walk down along the lowest set bits.
+  size_t idx = 0;
+  for (size_t l = _levels.size(); l-- > 0;) {
+    Word w = _levels[l][idx];
+    assert(w != 0);
+    idx = (idx << WordShift) + static_cast<size_t>(__builtin_ctzll(w));
+  }
 
-Token TokenPool::alloc_token() {
-  auto idx = _idx;
-  while (true) {
-    if (_mem[_idx] != std::numeric_limits<Int>::max()) {
-      Int v = ~_mem[_idx];
-      int count = 0;
-      for (; count < BitsPerInt; ++count) {
-        int mask = 1 << count;
-        if (v & mask) {
-          _mem[_idx] |= mask;
-          return Token(FindOffset(_idx, count));
-        }
-      }
-    } else {
-      if (RoundNext(_idx, _size) == idx) {
-        throw token_exhuasted();
-      }
-      _idx = RoundNext(_idx, _size);
-    }
+  // mark it used, and clear the summary bits of the words becoming full.
+  size_t pos = idx;
+  for (auto &level : _levels) {
+    Word &w = level[pos >> WordShift];
+    w &= ~(Word(1) << (pos & (BitsPerWord - 1)));
+    if (w != 0)
+      break;
+    pos >>= WordShift;
   }
+  ++_used;
+  return Token(static_cast<uint32_t>(idx), _gens[idx]);
 }
 
-void TokenPool::free_token(Token tok) {
-  auto v = static_cast<uint64_t>(tok);
-  auto off = static_cast<int>(v & (BitsPerInt - 1));
-  size_t pos = v >> 5;
-  Int mask = (~(1u << off));
-  _mem[pos] &= mask;
+bool TokenPool::valid(Token tok) const {
+  size_t pos = tok.index();
+  return pos < _capacity && _gens[pos] == tok.generation() &&
+         !(_levels[0][pos >> WordShift] &
+           (Word(1) << (pos & (BitsPerWord - 1))));
 }
+
+bool TokenPool::free_token(Token tok) {
+  if (!valid(tok))
+    return false;
+  size_t pos = tok.index();
+
+  // skip 0 on wrap around, so a token never becomes 0.
+  if (++_gens[pos] == 0)
+    _gens[pos] = 1;
+
+  // set the bit, and the summary bits of the words no longer full.
+  for (auto &level : _levels) {
+    Word &w = level[pos >> WordShift];
+    bool was_full = w == 0;
+    w |= Word(1) << (pos & (BitsPerWord - 1));
+    if (!was_full)
+      break;
+    pos >>= WordShift;
+  }
+  --_used;
+  return true;
 }
+} // namespace bsnet
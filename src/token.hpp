@@ -8,33 +8,101 @@
 #include "utility.hpp"
 #include <cstdint>
 #include <string>
+#include <type_traits>
+#include <vector>
 
 namespace bsnet {
 
 DECL_ERR(token_exhuasted);
 
-typedef std::uint32_t Int;
-
+/**
+ * A token handed out by 'TokenPool' packs the slot index in the low 32 bits
+ * and the generation of the slot in the high 32 bits, so it fits in the
+ * 'epoll_data' of an event. A slot gets a new generation whenever it is
+ * freed, so an event carrying a token of a released slot can be told apart
+ * from one for the new owner of the same slot.
+ */
 class Token {
   std::uint64_t _tok;
-  explicit Token(std::uint64_t tok);
+  constexpr Token(std::uint32_t index, std::uint32_t gen) noexcept
+      : _tok(static_cast<std::uint64_t>(gen) << 32 | index) {}
 
 public:
-  explicit operator std::uint64_t() const;
+  constexpr Token() noexcept : _tok(0) {}
+  constexpr explicit Token(std::uint64_t tok) noexcept : _tok(tok) {}
+  constexpr explicit operator std::uint64_t() const noexcept { return _tok; }
+
+  constexpr std::uint32_t index() const noexcept {
+    return static_cast<std::uint32_t>(_tok);
+  }
+  constexpr std::uint32_t generation() const noexcept {
+    return static_cast<std::uint32_t>(_tok >> 32);
+  }
+
   friend class TokenPool;
-  friend bool operator==(Token lhs, Token rhs);
+  friend constexpr bool operator==(Token lhs, Token rhs) noexcept {
+    return lhs._tok == rhs._tok;
+  }
+  friend constexpr bool operator!=(Token lhs, Token rhs) noexcept {
+    return lhs._tok != rhs._tok;
+  }
 };
 
+// a Token is passed in registers and stored as is in 'epoll_data'.
+static_assert(sizeof(Token) == sizeof(std::uint64_t) &&
+                  alignof(Token) == alignof(std::uint64_t),
+              "Token must have the layout of uint64_t");
+static_assert(std::is_trivially_copyable<Token>::value &&
+                  std::is_standard_layout<Token>::value,
+              "Token must be trivially copyable");
+
+/**
+ * TokenPool always hands out the lowest free token.
+ *
+ * Tokens are tracked by a hierarchical bitmap: a bit of the bottom level is
+ * set when the token is free, a bit of an upper level is set when the word
+ * below it has any free bit. Allocating and freeing touch a single word per
+ * level (4 levels for 16M tokens), whatever the occupancy is.
+ *
+ * The pool doubles when it is full, until 'max_size' is reached, then
+ * 'alloc_token' throws 'token_exhuasted'. Sizes are rounded up to a
+ * multiple of 64.
+ *
+ * Generations start at 1, a token handed out is never 0, which is reserved
+ * by 'Poller'.
+ */
 class TokenPool {
 public:
-  explicit TokenPool(std::uint32_t size);
+  static constexpr std::uint32_t MaxSize = 1u << 31;
+
+  explicit TokenPool(std::uint32_t size, std::uint32_t max_size = MaxSize);
   Token alloc_token();
-  void free_token(Token tok);
+
+  /**
+   * Release a token, returns false and does nothing if 'tok' is stale.
+   */
+  bool free_token(Token tok);
+
+  /**
+   * Whether 'tok' is currently allocated, and of the current generation.
+   */
+  bool valid(Token tok) const;
+
+  std::uint32_t capacity() const { return _capacity; }
+  std::uint32_t size() const { return _used; }
 
 private:
-  std::uint32_t _size;
-  std::uint32_t _idx;
-  Int *_mem;
+  using Word = std::uint64_t;
+
+  void grow();
+  void build_summary();
+
+  std::uint32_t _capacity;
+  std::uint32_t _max_size;
+  std::uint32_t _used;
+  std::vector<std::vector<Word>> _levels;
+  // generation of the current or next owner of each slot
+  std::vector<std::uint32_t> _gens;
 };
 }
 
@@ -0,0 +1,169 @@
+//
+// Created by byao on 1/8/18.
+// Copyright (c) 2018 byao. All rights reserved.
+//
+
+#include "udp_socket.hpp"
+#include "address.hpp"
+#include "neterr.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <netinet/in.h>
+#include <netinet/udp.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#ifndef SOL_UDP
+#define SOL_UDP 17
+#endif
+#ifndef UDP_SEGMENT
+#define UDP_SEGMENT 103
+#endif
+#ifndef UDP_GRO
+#define UDP_GRO 104
+#endif
+
+using namespace std;
+
+namespace bsnet {
+
+constexpr int UdpSocket::MaxSegments;
+constexpr size_t UdpSocket::MaxDatagram;
+
+UdpSocket UdpSocket::bind(const Addr &addr) {
+  int domain = addr.is_ipv4() ? AF_INET : AF_INET6;
+  int sock = ::socket(domain, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+  if (sock == -1)
+    throw socket_error();
+
+  if (::bind(sock, addr.get_sockaddr(), addr.size()) < 0) {
+    ::close(sock);
+    throw binding_error();
+  }
+  return UdpSocket(sock);
+}
+
+UdpSocket::UdpSocket(UdpSocket &&other) noexcept : EventedFd(-1) {
+  this->swap(other);
+}
+
+void UdpSocket::connect(const Addr &addr) {
+  CHECKED(::connect(_fd, addr.get_sockaddr(), addr.size()) != -1, udp_error);
+}
+
+void UdpSocket::local_addr(Addr &addr) {
+  socklen_t socklen = sizeof(struct sockaddr_in6);
+  CHECKED(::getsockname(_fd, addr.get_sockaddr(), &socklen) != -1, udp_error);
+  addr._v = static_cast<Addr::Version>(addr.get_sockaddr()->sa_family);
+}
+
+void UdpSocket::set_segment_size(uint16_t size) {
+  int val = size;
+  CHECKED(::setsockopt(_fd, SOL_UDP, UDP_SEGMENT, &val, sizeof(val)) != -1,
+          udp_error);
+}
+
+uint16_t UdpSocket::segment_size() const {
+  int val = 0;
+  socklen_t size = sizeof(val);
+  CHECKED(::getsockopt(_fd, SOL_UDP, UDP_SEGMENT, &val, &size) != -1,
+          udp_error);
+  return static_cast<uint16_t>(val);
+}
+
+void UdpSocket::set_gro(bool on) {
+  int val = on ? 1 : 0;
+  CHECKED(::setsockopt(_fd, SOL_UDP, UDP_GRO, &val, sizeof(val)) != -1,
+          udp_error);
+}
+
+bool UdpSocket::gro() const {
+  int val = 0;
+  socklen_t size = sizeof(val);
+  CHECKED(::getsockopt(_fd, SOL_UDP, UDP_GRO, &val, &size) != -1, udp_error);
+  return val != 0;
+}
+
+ssize_t UdpSocket::send(Buf &buf) {
+  return sendmsg(buf, buf.readable_bytes(), nullptr, 0);
+}
+
+ssize_t UdpSocket::send_to(Buf &buf, const Addr &addr) {
+  return sendmsg(buf, buf.readable_bytes(), &addr, 0);
+}
+
+ssize_t UdpSocket::send_segments(Buf &buf, uint16_t segment,
+                                 const Addr *addr) {
+  if (segment == 0) {
+    errno = EINVAL;
+    return -1;
+  }
+  size_t max_segments =
+      min(static_cast<size_t>(MaxSegments), MaxDatagram / segment);
+  size_t len = min(static_cast<size_t>(buf.readable_bytes()),
+                   max_segments * segment);
+  // a single segment does not need the offload.
+  return sendmsg(buf, len, addr, len > segment ? segment : 0);
+}
+
+ssize_t UdpSocket::sendmsg(Buf &buf, size_t len, const Addr *addr,
+                           uint16_t segment) {
+  struct msghdr msg;
+  memset(&msg, 0, sizeof(msg));
+  if (addr) {
+    msg.msg_name = const_cast<struct sockaddr *>(addr->get_sockaddr());
+    msg.msg_namelen = static_cast<socklen_t>(addr->size());
+  }
+
+  char control[CMSG_SPACE(sizeof(uint16_t))];
+  if (segment > 0) {
+    memset(&control[0], 0, sizeof(control));
+    msg.msg_control = &control[0];
+    msg.msg_controllen = sizeof(control);
+    struct cmsghdr *cm = CMSG_FIRSTHDR(&msg);
+    cm->cmsg_level = SOL_UDP;
+    cm->cmsg_type = UDP_SEGMENT;
+    cm->cmsg_len = CMSG_LEN(sizeof(uint16_t));
+    memcpy(CMSG_DATA(cm), &segment, sizeof(segment));
+  }
+  return buf.send_msg(_fd, &msg, len);
+}
+
+ssize_t UdpSocket::recv(Buf &buf, uint16_t *segment) {
+  return recv_from(buf, nullptr, segment);
+}
+
+ssize_t UdpSocket::recv_from(Buf &buf, Addr *peer, uint16_t *segment) {
+  struct msghdr msg;
+  memset(&msg, 0, sizeof(msg));
+  if (peer) {
+    msg.msg_name = peer->get_sockaddr();
+    msg.msg_namelen = sizeof(struct sockaddr_in6);
+  }
+  char control[CMSG_SPACE(sizeof(int))];
+  msg.msg_control = &control[0];
+  msg.msg_controllen = sizeof(control);
+
+  ssize_t n = buf.recv_msg(_fd, &msg);
+  if (n == -1)
+    return n;
+
+  if (peer)
+    peer->_v = static_cast<Addr::Version>(peer->get_sockaddr()->sa_family);
+
+  if (segment) {
+    *segment = static_cast<uint16_t>(n);
+    for (struct cmsghdr *cm = CMSG_FIRSTHDR(&msg); cm != nullptr;
+         cm = CMSG_NXTHDR(&msg, cm)) {
+      if (cm->cmsg_level == SOL_UDP && cm->cmsg_type == UDP_GRO) {
+        int gso_size;
+        memcpy(&gso_size, CMSG_DATA(cm), sizeof(gso_size));
+        *segment = static_cast<uint16_t>(gso_size);
+      }
+    }
+  }
+  return n;
+}
+
+} // namespace bsnet
@@ -0,0 +1,116 @@
+//
+// Created by byao on 1/8/18.
+// Copyright (c) 2018 byao. All rights reserved.
+//
+
+#ifndef BSNET_UDPSOCKET_HPP
+#define BSNET_UDPSOCKET_HPP
+
+#include "bytebuffer.hpp"
+#include "event.hpp"
+#include "eventedfd.hpp"
+#include "utility.hpp"
+#include <cstdint>
+#include <sys/socket.h>
+
+namespace bsnet {
+
+class Addr;
+
+/**
+ * Nonblocking udp socket, implemented 'Evented' interface.
+ *
+ * Supports udp segmentation offload on linux:
+ *   GSO (UDP_SEGMENT): a single send of a large buffer is split into
+ *   datagrams of 'segment' bytes by the kernel (or the nic).
+ *   GRO (UDP_GRO): consecutive datagrams of a flow may be coalesced into
+ *   a single receive, the segment size is reported by 'recv_from'.
+ */
+class UdpSocket : public EventedFd {
+public:
+  using Buf = ByteBuffer;
+
+  /**
+   * Max number of segments the kernel accepts in a single GSO send.
+   */
+  static constexpr int MaxSegments = 64;
+
+  /**
+   * Max payload of a single udp datagram (or a GSO send).
+   */
+  static constexpr std::size_t MaxDatagram = 65507;
+
+  /*
+   * throws 'socket_error' or 'binding_error' exception
+   */
+  static UdpSocket bind(const Addr &addr);
+
+  UdpSocket(UdpSocket &&other) noexcept;
+  ~UdpSocket() noexcept override = default;
+
+  void swap(UdpSocket &other) noexcept {
+    using std::swap;
+    swap(_fd, other._fd);
+  }
+
+  /**
+   * Following methods can throw 'udp_error' exception
+   */
+  void connect(const Addr &addr);
+  void local_addr(Addr &addr);
+
+  /**
+   * Set the GSO segment size for every send on this socket, 0 disables it.
+   * When enabled, the readable bytes of a send must not exceed
+   * 'MaxSegments' segments.
+   */
+  void set_segment_size(std::uint16_t size);
+  std::uint16_t segment_size() const;
+
+  /**
+   * Enable receiving coalesced datagrams.
+   */
+  void set_gro(bool on);
+  bool gro() const;
+
+  /**
+   * Send all the readable bytes of 'buf' as a single datagram, to the
+   * connected peer or to 'addr'.
+   * Return the bytes sent or -1 on error, sent bytes are discarded from 'buf'.
+   */
+  ssize_t send(Buf &buf);
+  ssize_t send_to(Buf &buf, const Addr &addr);
+
+  /**
+   * Send the readable bytes of 'buf' as datagrams of 'segment' bytes each
+   * (the last one can be shorter) in a single syscall. At most
+   * 'MaxSegments' segments are sent per call, so the caller should loop
+   * until 'buf' is drained.
+   * 'addr' can be nullptr for a connected socket.
+   */
+  ssize_t send_segments(Buf &buf, std::uint16_t segment,
+                        const Addr *addr = nullptr);
+
+  /**
+   * Receive a single datagram, or a batch of coalesced datagrams when GRO is
+   * enabled, and append it to 'buf'.
+   * If 'segment' is not nullptr, it is set to the size of each datagram in
+   * the batch (equal to the return value when nothing was coalesced).
+   */
+  ssize_t recv(Buf &buf, std::uint16_t *segment = nullptr);
+  ssize_t recv_from(Buf &buf, Addr *peer, std::uint16_t *segment = nullptr);
+
+private:
+  UdpSocket(int fd) : EventedFd(fd) {}
+  UdpSocket(const UdpSocket &) = delete;
+  UdpSocket &operator=(const UdpSocket &) = delete;
+
+  ssize_t sendmsg(Buf &buf, std::size_t len, const Addr *addr,
+                  std::uint16_t segment);
+};
+
+inline void swap(UdpSocket &lhs, UdpSocket &rhs) noexcept { lhs.swap(rhs); }
+
+} // namespace bsnet
+
+#endif // BSNET_UDPSOCKET_HPP
@@ -0,0 +1,99 @@
+//
+// Created by byao on 1/13/18.
+// Copyright (c) 2018 byao. All rights reserved.
+//
+
+#include "unix_datagram.hpp"
+#include "address.hpp"
+#include "fd_passing.hpp"
+#include "neterr.hpp"
+#include <cstring>
+#include <sys/socket.h>
+#include <unistd.h>
+
+using namespace std;
+
+namespace bsnet {
+
+UnixDatagram UnixDatagram::bind(const AddrUnix &addr) {
+  UnixDatagram sock = unbound();
+  if (::bind(sock._fd, addr.get_sockaddr(), addr._len) < 0)
+    throw binding_error();
+  return sock;
+}
+
+UnixDatagram UnixDatagram::unbound() {
+  int sock = ::socket(AF_UNIX, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+  if (sock == -1)
+    throw socket_error();
+  return UnixDatagram(sock);
+}
+
+pair<UnixDatagram, UnixDatagram> UnixDatagram::pair() {
+  int fds[2];
+  if (::socketpair(AF_UNIX, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0,
+                   fds) == -1)
+    throw socket_error();
+  return make_pair(UnixDatagram(fds[0]), UnixDatagram(fds[1]));
+}
+
+UnixDatagram::UnixDatagram(UnixDatagram &&other) noexcept : EventedFd(-1) {
+  this->swap(other);
+}
+
+void UnixDatagram::connect(const AddrUnix &addr) {
+  CHECKED(::connect(_fd, addr.get_sockaddr(), addr._len) != -1, unix_error);
+}
+
+void UnixDatagram::peer_addr(AddrUnix &addr) {
+  addr._len = sizeof(addr._addr);
+  CHECKED(::getpeername(_fd, addr.get_sockaddr(), &addr._len) != -1,
+          unix_error);
+}
+
+void UnixDatagram::local_addr(AddrUnix &addr) {
+  addr._len = sizeof(addr._addr);
+  CHECKED(::getsockname(_fd, addr.get_sockaddr(), &addr._len) != -1,
+          unix_error);
+}
+
+ssize_t UnixDatagram::send(Buf &buf) {
+  return ::bsnet::send_fds(_fd, buf, nullptr, 0);
+}
+
+ssize_t UnixDatagram::send_to(Buf &buf, const AddrUnix &addr) {
+  return ::bsnet::send_fds(_fd, buf, nullptr, 0, addr.get_sockaddr(),
+                           addr._len);
+}
+
+ssize_t UnixDatagram::recv(Buf &buf) { return recv_from(buf, nullptr); }
+
+ssize_t UnixDatagram::recv_from(Buf &buf, AddrUnix *peer) {
+  struct msghdr msg;
+  memset(&msg, 0, sizeof(msg));
+  if (peer) {
+    msg.msg_name = peer->get_sockaddr();
+    msg.msg_namelen = sizeof(peer->_addr);
+  }
+  ssize_t n = buf.recv_msg(_fd, &msg);
+  if (n != -1 && peer)
+    peer->_len = msg.msg_namelen;
+  return n;
+}
+
+ssize_t UnixDatagram::send_fds(Buf &buf, const int *fds, size_t nfds,
+                               const AddrUnix *addr) {
+  if (addr)
+    return ::bsnet::send_fds(_fd, buf, fds, nfds, addr->get_sockaddr(),
+                             addr->_len);
+  return ::bsnet::send_fds(_fd, buf, fds, nfds);
+}
+
+ssize_t UnixDatagram::recv_fds(Buf &buf, vector<int> &fds, AddrUnix *peer) {
+  if (!peer)
+    return ::bsnet::recv_fds(_fd, buf, fds);
+  peer->_len = sizeof(peer->_addr);
+  return ::bsnet::recv_fds(_fd, buf, fds, peer->get_sockaddr(), &peer->_len);
+}
+
+} // namespace bsnet
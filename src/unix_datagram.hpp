@@ -0,0 +1,90 @@
+//
+// Created by byao on 1/13/18.
+// Copyright (c) 2018 byao. All rights reserved.
+//
+
+#ifndef BSNET_UNIXDATAGRAM_HPP
+#define BSNET_UNIXDATAGRAM_HPP
+
+#include "bytebuffer.hpp"
+#include "event.hpp"
+#include "eventedfd.hpp"
+#include "utility.hpp"
+#include <utility>
+#include <vector>
+
+namespace bsnet {
+
+class AddrUnix;
+
+/**
+ * Nonblocking unix domain datagram socket, implemented 'Evented' interface.
+ * Every send is a single datagram, and every receive appends exactly one
+ * datagram to the buffer.
+ */
+class UnixDatagram : public EventedFd {
+public:
+  using Buf = ByteBuffer;
+
+  /*
+   * throws 'socket_error' or 'binding_error' exception
+   */
+  static UnixDatagram bind(const AddrUnix &addr);
+
+  /*
+   * Create a socket not bound to any address, throws 'socket_error'
+   */
+  static UnixDatagram unbound();
+
+  /*
+   * Create a pair of connected sockets, throws 'socket_error'
+   */
+  static std::pair<UnixDatagram, UnixDatagram> pair();
+
+  static UnixDatagram from_fd(int fd) { return UnixDatagram(fd); }
+
+  UnixDatagram(UnixDatagram &&other) noexcept;
+  ~UnixDatagram() noexcept override = default;
+
+  void swap(UnixDatagram &other) noexcept {
+    using std::swap;
+    swap(_fd, other._fd);
+  }
+
+  /**
+   * Following methods can throw 'unix_error' exception
+   */
+  void connect(const AddrUnix &addr);
+  void peer_addr(AddrUnix &addr);
+  void local_addr(AddrUnix &addr);
+
+  ssize_t send(Buf &buf);
+  ssize_t send_to(Buf &buf, const AddrUnix &addr);
+  ssize_t recv(Buf &buf);
+  ssize_t recv_from(Buf &buf, AddrUnix *peer);
+
+  /**
+   * Send the readable bytes of 'buf' as one datagram along with file
+   * descriptors, 'addr' can be nullptr for a connected socket.
+   */
+  ssize_t send_fds(Buf &buf, const int *fds, std::size_t nfds,
+                   const AddrUnix *addr = nullptr);
+
+  /**
+   * Receive one datagram, descriptors passed along are appended to 'fds'.
+   */
+  ssize_t recv_fds(Buf &buf, std::vector<int> &fds, AddrUnix *peer = nullptr);
+
+private:
+  UnixDatagram(int fd) : EventedFd(fd) {}
+  UnixDatagram(const UnixDatagram &) = delete;
+  UnixDatagram &operator=(const UnixDatagram &) = delete;
+};
+
+inline void swap(UnixDatagram &lhs, UnixDatagram &rhs) noexcept {
+  lhs.swap(rhs);
+}
+
+} // namespace bsnet
+
+#endif // BSNET_UNIXDATAGRAM_HPP
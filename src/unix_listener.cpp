@@ -0,0 +1,59 @@
+//
+// Created by byao on 1/12/18.
+// Copyright (c) 2018 byao. All rights reserved.
+//
+
+#include "unix_listener.hpp"
+#include "address.hpp"
+#include "neterr.hpp"
+#include "unix_stream.hpp"
+#include <sys/socket.h>
+#include <unistd.h>
+
+using namespace std;
+
+namespace bsnet {
+
+UnixListener UnixListener::bind(const AddrUnix &addr, size_t listen_backlog) {
+  int sock = ::socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+  if (sock == -1)
+    throw creating_acceptor_failed();
+
+  if (::bind(sock, addr.get_sockaddr(), addr._len) < 0) {
+    ::close(sock);
+    throw binding_error();
+  }
+
+  if (::listen(sock, static_cast<int>(listen_backlog)) < 0) {
+    ::close(sock);
+    throw creating_acceptor_failed();
+  }
+  return UnixListener(sock);
+}
+
+UnixListener::UnixListener(UnixListener &&other) noexcept : EventedFd(-1) {
+  this->swap(other);
+}
+
+UnixStream UnixListener::accept(AddrUnix *addr) {
+  int sock;
+  socklen_t *socklenp = nullptr;
+  struct sockaddr *ad = nullptr;
+  if (addr) {
+    ad = addr->get_sockaddr();
+    addr->_len = sizeof(addr->_addr);
+    socklenp = &addr->_len;
+  }
+  CHECKED((sock = ::accept4(_fd, ad, socklenp,
+                            SOCK_NONBLOCK | SOCK_CLOEXEC)) != -1 ||
+              errno == EAGAIN || errno == EWOULDBLOCK,
+          creating_acceptor_failed);
+  return UnixStream(sock);
+}
+
+void UnixListener::local_addr(AddrUnix &addr) {
+  addr._len = sizeof(addr._addr);
+  CHECKED(::getsockname(_fd, addr.get_sockaddr(), &addr._len) != -1,
+          unix_error);
+}
+} // namespace bsnet
@@ -0,0 +1,54 @@
+//
+// Created by byao on 1/12/18.
+// Copyright (c) 2018 byao. All rights reserved.
+//
+
+#ifndef BSNET_UNIXLISTENER_HPP
+#define BSNET_UNIXLISTENER_HPP
+
+#include "event.hpp"
+#include "eventedfd.hpp"
+#include "utility.hpp"
+#include <cstdint>
+
+namespace bsnet {
+
+class AddrUnix;
+class UnixStream;
+
+/**
+ * Nonblocking unix domain stream listener, implemented 'Evented' interface.
+ * Binding a filesystem path fails if the path exists, removing a stale
+ * socket file is up to the caller.
+ */
+class UnixListener : public EventedFd {
+public:
+  static UnixListener bind(const AddrUnix &addr, std::size_t listen_backlog);
+
+  /**
+   * Take the ownership of a listening nonblocking unix socket.
+   */
+  static UnixListener from_fd(int fd) { return UnixListener(fd); }
+
+  UnixListener(UnixListener &&other) noexcept;
+
+  ~UnixListener() noexcept override = default;
+
+  void swap(UnixListener &other) noexcept {
+    using std::swap;
+    swap(_fd, other._fd);
+  }
+
+  UnixStream accept(AddrUnix *peer = nullptr);
+  void local_addr(AddrUnix &addr);
+
+private:
+  UnixListener(int sock) : EventedFd(sock) {}
+};
+
+inline void swap(UnixListener &lhs, UnixListener &rhs) noexcept {
+  lhs.swap(rhs);
+}
+} // namespace bsnet
+
+#endif // BSNET_UNIXLISTENER_HPP
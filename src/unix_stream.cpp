@@ -0,0 +1,76 @@
+//
+// Created by byao on 1/12/18.
+// Copyright (c) 2018 byao. All rights reserved.
+//
+
+#include "unix_stream.hpp"
+#include "address.hpp"
+#include "fd_passing.hpp"
+#include "neterr.hpp"
+#include <cerrno>
+#include <sys/socket.h>
+#include <unistd.h>
+
+using namespace std;
+
+namespace bsnet {
+
+UnixStream UnixStream::connect(const AddrUnix &addr) {
+  int sock = ::socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+  if (sock == -1)
+    throw connecting_failed();
+
+  // connecting a unix socket never blocks, it either succeeds or fails with
+  // EAGAIN when the backlog of the listener is full.
+  if (::connect(sock, addr.get_sockaddr(), addr._len) == -1) {
+    ::close(sock);
+    throw connecting_failed();
+  }
+  return UnixStream(sock);
+}
+
+pair<UnixStream, UnixStream> UnixStream::pair() {
+  int fds[2];
+  if (::socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0,
+                   fds) == -1)
+    throw socket_error();
+  return make_pair(UnixStream(fds[0]), UnixStream(fds[1]));
+}
+
+UnixStream::UnixStream(UnixStream &&other) noexcept : EventedFd(-1) {
+  this->swap(other);
+}
+
+void UnixStream::peer_addr(AddrUnix &addr) {
+  addr._len = sizeof(addr._addr);
+  CHECKED(::getpeername(_fd, addr.get_sockaddr(), &addr._len) != -1,
+          unix_error);
+}
+
+void UnixStream::local_addr(AddrUnix &addr) {
+  addr._len = sizeof(addr._addr);
+  CHECKED(::getsockname(_fd, addr.get_sockaddr(), &addr._len) != -1,
+          unix_error);
+}
+
+void UnixStream::shutdown(Shutdown s) {
+  CHECKED(::shutdown(_fd, static_cast<int>(s)) != -1, unix_error);
+}
+
+ssize_t UnixStream::read(UnixStream::Buf &buf) { return buf.read_from(_fd); }
+
+ssize_t UnixStream::write(UnixStream::Buf &buf) { return buf.write_to(_fd); }
+
+ssize_t UnixStream::send_fds(Buf &buf, const int *fds, size_t nfds) {
+  if (buf.readable_bytes() == 0) {
+    errno = EINVAL;
+    return -1;
+  }
+  return ::bsnet::send_fds(_fd, buf, fds, nfds);
+}
+
+ssize_t UnixStream::recv_fds(Buf &buf, vector<int> &fds) {
+  return ::bsnet::recv_fds(_fd, buf, fds);
+}
+
+} // namespace bsnet
@@ -0,0 +1,83 @@
+//
+// Created by byao on 1/12/18.
+// Copyright (c) 2018 byao. All rights reserved.
+//
+
+#ifndef BSNET_UNIXSTREAM_HPP
+#define BSNET_UNIXSTREAM_HPP
+
+#include "bytebuffer.hpp"
+#include "event.hpp"
+#include "eventedfd.hpp"
+#include "tcp_stream.hpp"
+#include "utility.hpp"
+#include <utility>
+#include <vector>
+
+namespace bsnet {
+
+class AddrUnix;
+
+/**
+ * Nonblocking unix domain stream socket, implemented 'Evented' interface.
+ */
+class UnixStream : public EventedFd {
+public:
+  friend class UnixListener;
+  using Buf = ByteBuffer;
+
+  /*
+   * throws 'connecting_failed' exception
+   */
+  static UnixStream connect(const AddrUnix &addr);
+
+  /*
+   * Create a pair of connected streams, throws 'socket_error' exception
+   */
+  static std::pair<UnixStream, UnixStream> pair();
+
+  /**
+   * Take the ownership of a connected nonblocking unix stream socket.
+   */
+  static UnixStream from_fd(int fd) { return UnixStream(fd); }
+
+  UnixStream(UnixStream &&other) noexcept;
+  ~UnixStream() noexcept override = default;
+
+  void swap(UnixStream &other) noexcept {
+    using std::swap;
+    swap(_fd, other._fd);
+  }
+
+  /**
+   * Following methods can throw 'unix_error' exception
+   */
+  void peer_addr(AddrUnix &addr);
+  void local_addr(AddrUnix &addr);
+  void shutdown(Shutdown s);
+
+  ssize_t read(Buf &buf);
+  ssize_t write(Buf &buf);
+
+  /**
+   * Write the readable bytes of 'buf' along with file descriptors, 'buf'
+   * must not be empty, since the descriptors travel with the first byte.
+   */
+  ssize_t send_fds(Buf &buf, const int *fds, std::size_t nfds);
+
+  /**
+   * Read into 'buf', descriptors passed along are appended to 'fds'.
+   */
+  ssize_t recv_fds(Buf &buf, std::vector<int> &fds);
+
+private:
+  UnixStream(int fd) : EventedFd(fd) {}
+  UnixStream(const UnixStream &) = delete;
+  UnixStream &operator=(const UnixStream &) = delete;
+};
+
+inline void swap(UnixStream &lhs, UnixStream &rhs) noexcept { lhs.swap(rhs); }
+
+} // namespace bsnet
+
+#endif // BSNET_UNIXSTREAM_HPP
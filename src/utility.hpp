@@ -10,24 +10,38 @@ namespace bsnet {
 
 using Duration = std::chrono::milliseconds;
 
+/**
+ * Base of the errors of the library, carries errno at the point of the
+ * failure, 0 if there is none, ex. an error built from its message only.
+ */
+struct errno_error : std::runtime_error {
+  errno_error(int err, const std::string &msg)
+      : std::runtime_error(msg), _errno(err) {}
+
+  int error() const noexcept { return _errno; }
+
+private:
+  int _errno;
+};
+
 #define DECL_ERR(clsname)                                                      \
-  struct clsname : std::runtime_error {                                        \
+  struct clsname : errno_error {                                               \
     clsname();                                                                 \
     explicit clsname(const std::string &msg);                                  \
   }
 
 #define DECL_MSG_ERR(clsname)                                                  \
-  struct clsname : std::runtime_error {                                        \
+  struct clsname : errno_error {                                               \
     explicit clsname(const std::string &msg);                                  \
   }
 
 #define IMPL_ERR(clsname)                                                      \
-  clsname::clsname() : std::runtime_error(::strerror(errno)) {}                \
-  clsname::clsname(const std::string &msg) : std::runtime_error(msg) {}
+  clsname::clsname() : errno_error(errno, ::strerror(errno)) {}                \
+  clsname::clsname(const std::string &msg) : errno_error(0, msg) {}
 
 #define IMPL_MSG_ERR(clsname)                                                  \
   clsname::clsname(const std::string &msg)                                     \
-      : std::runtime_error(msg + ", " + ::strerror(errno)) {}
+      : errno_error(errno, msg + ", " + ::strerror(errno)) {}
 
 #define CHECKED_TCPOP(expr)                                                    \
   if (!(expr)) {                                                               \
@@ -0,0 +1,145 @@
+//
+// Created by byao on 1/28/18.
+// Copyright (c) 2018 byao. All rights reserved.
+//
+
+#ifndef BSNET_WS_DEQUE_HPP
+#define BSNET_WS_DEQUE_HPP
+
+#include "utility.hpp"
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <type_traits>
+#include <vector>
+
+namespace bsnet {
+
+/**
+ * Chase-Lev work-stealing deque (Le, Pop, Cohen, Zappa Nardelli, "Correct
+ * and Efficient Work-Stealing for Weak Memory Models", 2013).
+ *
+ * The owner thread pushes and takes at the bottom, LIFO, other threads steal
+ * from the top, FIFO. The owner never takes a lock, thieves race with a
+ * single CAS.
+ *
+ * T must be trivially copyable, usually a pointer. The array grows when it
+ * is full, old arrays are kept until the deque is destroyed, since a thief
+ * may still be reading them.
+ */
+template <typename T> class ws_deque_t : public NonCopyable {
+  static_assert(std::is_trivially_copyable<T>::value,
+                "ws_deque_t holds trivially copyable values");
+
+public:
+  explicit ws_deque_t(std::size_t capacity = 256) : _top(0), _bottom(0) {
+    std::size_t cap = 1;
+    while (cap < capacity)
+      cap <<= 1;
+    _arrays.emplace_back(new Array(cap));
+    _array.store(_arrays.back().get(), std::memory_order_relaxed);
+  }
+
+  /**
+   * Owner only.
+   */
+  void push(T value) {
+    std::int64_t b = _bottom.load(std::memory_order_relaxed);
+    std::int64_t t = _top.load(std::memory_order_acquire);
+    Array *a = _array.load(std::memory_order_relaxed);
+    if (b - t > static_cast<std::int64_t>(a->mask))
+      a = grow(a, t, b);
+    a->put(b, value);
+    // publishes the value to the thieves reading bottom.
+    _bottom.store(b + 1, std::memory_order_release);
+  }
+
+  /**
+   * Owner only, returns false if empty.
+   */
+  bool take(T &value) {
+    std::int64_t b = _bottom.load(std::memory_order_relaxed) - 1;
+    Array *a = _array.load(std::memory_order_relaxed);
+    _bottom.store(b, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    std::int64_t t = _top.load(std::memory_order_relaxed);
+
+    if (t > b) {
+      _bottom.store(b + 1, std::memory_order_relaxed);
+      return false;
+    }
+    value = a->get(b);
+    if (t == b) {
+      // the last one, race with thieves.
+      bool won = _top.compare_exchange_strong(
+          t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+      _bottom.store(b + 1, std::memory_order_relaxed);
+      return won;
+    }
+    return true;
+  }
+
+  /**
+   * Any thread, returns false if empty or lost a race.
+   */
+  bool steal(T &value) {
+    std::int64_t t = _top.load(std::memory_order_acquire);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    std::int64_t b = _bottom.load(std::memory_order_acquire);
+    if (t >= b)
+      return false;
+    Array *a = _array.load(std::memory_order_acquire);
+    value = a->get(t);
+    return _top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst,
+                                        std::memory_order_relaxed);
+  }
+
+  /**
+   * A hint, exact only when called by the owner without thieves.
+   */
+  std::size_t size() const {
+    std::int64_t b = _bottom.load(std::memory_order_relaxed);
+    std::int64_t t = _top.load(std::memory_order_relaxed);
+    return b > t ? static_cast<std::size_t>(b - t) : 0;
+  }
+
+  bool empty() const { return size() == 0; }
+
+private:
+  struct Array {
+    explicit Array(std::size_t cap) : mask(cap - 1), slots(new Slot[cap]) {}
+
+    void put(std::int64_t i, T v) {
+      slots[i & mask].store(v, std::memory_order_relaxed);
+    }
+    T get(std::int64_t i) const {
+      return slots[i & mask].load(std::memory_order_relaxed);
+    }
+
+    using Slot = std::atomic<T>;
+    std::size_t mask;
+    std::unique_ptr<Slot[]> slots;
+  };
+
+  Array *grow(Array *a, std::int64_t t, std::int64_t b) {
+    _arrays.emplace_back(new Array((a->mask + 1) << 1));
+    Array *bigger = _arrays.back().get();
+    for (std::int64_t i = t; i < b; ++i)
+      bigger->put(i, a->get(i));
+    _array.store(bigger, std::memory_order_release);
+    return bigger;
+  }
+
+  // top and bottom on their own cache lines.
+  std::atomic<std::int64_t> _top;
+  char _pad0[64 - sizeof(std::atomic<std::int64_t>)];
+  std::atomic<std::int64_t> _bottom;
+  char _pad1[64 - sizeof(std::atomic<std::int64_t>)];
+  std::atomic<Array *> _array;
+  // owner only, retired arrays live as long as the deque.
+  std::vector<std::unique_ptr<Array>> _arrays;
+};
+
+} // namespace bsnet
+
+#endif // BSNET_WS_DEQUE_HPP
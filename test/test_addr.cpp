@@ -85,3 +85,33 @@ TEST(AddrTest, test_conversion) { // NOLINT
   EXPECT_EQ(addr4.as_ipv6(), nullptr);
   EXPECT_EQ(addr6.as_ipv4(), nullptr);
 }
+
+TEST(AddrTest, test_unix) { // NOLINT
+  AddrUnix path("/tmp/bsnet.sock");
+  EXPECT_FALSE(path.is_abstract());
+  EXPECT_FALSE(path.is_unnamed());
+  EXPECT_EQ(path.path(), "/tmp/bsnet.sock");
+  EXPECT_TRUE(addr_equal(path, AddrUnix::from("/tmp/bsnet.sock")));
+
+  AddrUnix abstract = AddrUnix::from("@bsnet");
+  EXPECT_TRUE(abstract.is_abstract());
+  EXPECT_EQ(abstract.path(), "bsnet");
+  EXPECT_EQ(abstract.size(), offsetof(struct sockaddr_un, sun_path) + 6);
+  EXPECT_TRUE(addr_equal(abstract, AddrUnix::abstract("bsnet")));
+
+  Addr addr = abstract;
+  EXPECT_TRUE(addr.is_unix());
+  EXPECT_FALSE(addr.is_ipv4());
+  EXPECT_EQ(addr.as_ipv4(), nullptr);
+  EXPECT_TRUE(addr_equal(*addr.as_unix(), abstract));
+  EXPECT_EQ(addr.size(), abstract.size());
+
+  AddrUnix unnamed;
+  EXPECT_TRUE(unnamed.is_unnamed());
+  EXPECT_FALSE(unnamed.is_abstract());
+  EXPECT_EQ(unnamed.size(), sizeof(sa_family_t));
+  EXPECT_EQ(unnamed.path(), "");
+
+  EXPECT_THROW(AddrUnix(std::string(200, 'a')), invalid_address);
+  EXPECT_THROW(AddrUnix::from(""), invalid_address);
+}
@@ -0,0 +1,113 @@
+//
+// Created by byao on 2/1/18.
+// Copyright (c) 2018 byao. All rights reserved.
+//
+
+#include "../src/blocking_queue.hpp"
+#include "../src/poller_epoll.hpp"
+#include <chrono>
+#include <gtest/gtest.h>
+#include <memory>
+#include <sys/eventfd.h>
+#include <thread>
+#include <vector>
+
+using namespace std;
+using namespace bsnet;
+using namespace std::chrono_literals;
+
+TEST(BlockingQueueTest, try_and_timed) {
+  bounded_blocking_queue_t<int> q(2);
+  EXPECT_TRUE(q.try_put(1));
+  EXPECT_TRUE(q.put_for(2, 10ms));
+  EXPECT_FALSE(q.try_put(3));
+
+  auto start = chrono::steady_clock::now();
+  EXPECT_FALSE(q.put_for(3, 20ms));
+  EXPECT_GE(chrono::steady_clock::now() - start, 20ms);
+
+  int v;
+  EXPECT_TRUE(q.try_get(v));
+  EXPECT_EQ(v, 1);
+  EXPECT_TRUE(q.get_for(v, 10ms));
+  EXPECT_EQ(v, 2);
+  EXPECT_FALSE(q.try_get(v));
+  EXPECT_FALSE(q.get_for(v, 10ms));
+}
+
+TEST(BlockingQueueTest, close) {
+  bounded_blocking_queue_t<int> q(1);
+  q.put(1);
+  thread producer([&] { EXPECT_FALSE(q.put(2)); });
+  this_thread::sleep_for(10ms);
+  q.close();
+  producer.join();
+
+  // drained after close, then gets fail without blocking.
+  int v;
+  EXPECT_TRUE(q.get(v));
+  EXPECT_FALSE(q.get(v));
+  EXPECT_FALSE(q.try_put(3));
+
+  blocking_queue_t<int> unbounded;
+  thread consumer([&] {
+    int v;
+    EXPECT_FALSE(unbounded.get(v));
+  });
+  this_thread::sleep_for(10ms);
+  unbounded.close();
+  consumer.join();
+  EXPECT_FALSE(unbounded.put(1));
+}
+
+TEST(BlockingQueueTest, get_all_moves) {
+  bounded_blocking_queue_t<unique_ptr<int>> q(4);
+  q.emplace(new int(1));
+  q.put(unique_ptr<int>(new int(2)));
+  vector<unique_ptr<int>> res;
+  EXPECT_EQ(q.get_all(res), 2);
+  EXPECT_EQ(*res[1], 2);
+  EXPECT_TRUE(q.empty());
+  EXPECT_EQ(q.try_get_all(res), 0);
+
+  blocking_queue_t<unique_ptr<int>> unbounded;
+  unbounded.emplace(new int(3));
+  EXPECT_EQ(unbounded.get_all(res), 1);
+  EXPECT_EQ(*res.back(), 3);
+}
+
+TEST(BlockingQueueTest, get_all_wakes_producers) {
+  bounded_blocking_queue_t<int> q(1);
+  q.put(0);
+  vector<thread> producers;
+  for (int i = 1; i <= 3; ++i)
+    producers.emplace_back([&q, i] { q.put(i); });
+
+  vector<int> res;
+  while (res.size() < 4)
+    q.get_all(res);
+  for (auto &th : producers)
+    th.join();
+}
+
+TEST(ReadinessQueueTest, shed_load) {
+  int fd = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+  ASSERT_NE(fd, -1);
+  auto *rq = new ReadinessQueue(2, fd);
+  Event evt(Ready::readable(), PollOpt::empty(), Token(1));
+  EXPECT_TRUE(rq->try_put(evt));
+  EXPECT_TRUE(rq->put_for(evt, Duration(10)));
+  EXPECT_FALSE(rq->try_put(evt));
+  EXPECT_FALSE(rq->put_for(evt, Duration(10)));
+
+  // a producer blocked on the full queue returns when the poller goes.
+  thread producer([rq, evt] { EXPECT_FALSE(rq->put(evt)); });
+  this_thread::sleep_for(10ms);
+  rq->close();
+  producer.join();
+  EXPECT_FALSE(rq->try_put(evt));
+
+  vector<Event> events;
+  EXPECT_EQ(rq->get_all(events), 2);
+  rq->release();
+}
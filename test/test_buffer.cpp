@@ -45,6 +45,24 @@ TEST_F(BufferFixture, construct) // NOLINT
   EXPECT_EQ(buf.writable_size(), cap);
 }
 
+TEST_F(BufferFixture, zero_capacity) // NOLINT
+{
+  ringbuf_t<byte_t> buf(0);
+  EXPECT_EQ(buf.capacity(), 0);
+  EXPECT_TRUE(buf.empty());
+  EXPECT_EQ(buf.writable_size(), 0);
+
+  ringbuf_t<byte_t> copy(buf);
+  ringbuf_t<byte_t> moved(std::move(buf));
+  EXPECT_TRUE(copy.empty());
+  EXPECT_TRUE(moved.empty());
+
+  moved.reserve(s.size());
+  moved.append(s.data(), s.size());
+  EXPECT_EQ(moved.readable_size(), s.size());
+  EXPECT_EQ(moved[0], 'a');
+}
+
 TEST_F(BufferFixture, append_retrieve) // NOLINT
 {
   byte_t inputbuf[default_buffer_size];
@@ -126,3 +144,56 @@ TEST(BufferTest, test_byte_buffer) {
   EXPECT_EQ(msg1, "Hello, World!");
   EXPECT_EQ(msg2, "Yaobo");
 }
+
+TEST(BufferTest, put_take_arith) {
+  ByteBuffer buf(0);
+  buf.put<std::uint8_t>(0x12);
+  buf.put<std::int32_t>(-2);
+  buf.put(3.5);
+  buf.put<std::uint16_t>(0x1234, Endian::Big);
+  buf.put<std::uint32_t>(0x12345678, Endian::Little);
+  buf.put<std::uint64_t>(0x0102030405060708ULL, Endian::Big);
+  EXPECT_EQ(buf.readable_bytes(), 1 + 4 + 8 + 2 + 4 + 8);
+
+  EXPECT_EQ(buf.take<std::uint8_t>(), 0x12);
+  EXPECT_EQ(buf.take<std::int32_t>(), -2);
+  EXPECT_EQ(buf.take<double>(), 3.5);
+  EXPECT_EQ(buf[0], 0x12);
+  EXPECT_EQ(buf[1], 0x34);
+  EXPECT_EQ(buf.peek<std::uint16_t>(0, Endian::Big), 0x1234);
+  EXPECT_EQ(buf.take<std::uint16_t>(Endian::Big), 0x1234);
+  EXPECT_EQ(buf[0], 0x78);
+  EXPECT_EQ(buf.take<std::uint32_t>(Endian::Little), 0x12345678u);
+  EXPECT_EQ(buf[0], 0x01);
+  EXPECT_EQ(buf[7], 0x08);
+  EXPECT_EQ(buf.take<std::uint64_t>(Endian::Big), 0x0102030405060708ULL);
+  EXPECT_EQ(buf.readable_bytes(), 0);
+}
+
+TEST(BufferTest, view_across_wrap) {
+  ByteBuffer buf(16);
+  string head(10, 'x');
+  buf.put_string(head);
+  buf.discard(10);
+  // wraps around the end of the ring.
+  string msg = "0123456789ab";
+  buf.put_string(msg);
+
+  BufferView all = buf.view(0, msg.size());
+  EXPECT_EQ(all.size(), msg.size());
+  EXPECT_FALSE(all.contiguous());
+  EXPECT_EQ(all.to_string(), msg);
+  for (size_t i = 0; i < msg.size(); ++i)
+    EXPECT_EQ(all[i], msg[i]);
+
+  EXPECT_EQ(buf.view(2, 5).to_string(), "23456");
+  EXPECT_EQ(buf.view(8, 4).to_string(), "89ab");
+  EXPECT_EQ(buf.find('3', 0), 3);
+  EXPECT_EQ(buf.find('9', 4), 9);
+  EXPECT_EQ(buf.find('1', 2), -1);
+
+  char out[4];
+  buf.peek(out, 4, 7);
+  EXPECT_EQ(string(out, 4), "789a");
+  EXPECT_EQ(buf.readable_bytes(), static_cast<int>(msg.size()));
+}
@@ -55,3 +55,18 @@ TEST(ReadyTest, construct) { // NOLINT
   EXPECT_TRUE(r.is_writable());
   EXPECT_FALSE(r.is_readable());
 }
+
+TEST(EventTest, token) { // NOLINT
+  TokenPool pool(64);
+  Token tok = pool.alloc_token();
+  Event evt(Ready::readable(), PollOpt::edge(), tok);
+  EXPECT_EQ(evt.token(), tok);
+  EXPECT_TRUE(pool.valid(evt.token()));
+
+  pool.free_token(tok);
+  EXPECT_FALSE(pool.valid(evt.token()));
+
+  constexpr Token reserved(0);
+  static_assert(reserved.index() == 0 && reserved.generation() == 0, "");
+  EXPECT_EQ(Token(), reserved);
+}
@@ -0,0 +1,159 @@
+//
+// Created by byao on 1/26/18.
+// Copyright (c) 2018 byao. All rights reserved.
+//
+
+#include "../src/executor.hpp"
+#include "../src/poller_epoll.hpp"
+#include "../src/task.hpp"
+#include <array>
+#include <atomic>
+#include <cstdlib>
+#include <gtest/gtest.h>
+#include <memory>
+#include <new>
+#include <thread>
+#include <vector>
+
+using namespace std;
+using namespace bsnet;
+
+// counts the allocations of the test binary.
+static atomic<size_t> allocations{0};
+
+void *operator new(size_t size) {
+  ++allocations;
+  if (void *p = malloc(size ? size : 1))
+    return p;
+  throw bad_alloc();
+}
+
+void operator delete(void *p) noexcept { free(p); }
+void operator delete(void *p, size_t) noexcept { free(p); }
+
+TEST(TaskTest, small_buffer) {
+  int n = 0;
+  Task small([&n] { ++n; });
+  EXPECT_TRUE(small.is_inline());
+  small();
+  EXPECT_EQ(n, 1);
+
+  array<char, 40> payload{};
+  Task fits([&n, payload] { n += payload.size(); });
+  EXPECT_TRUE(fits.is_inline());
+
+  array<char, 64> big{};
+  Task large([&n, big] { n += big.size(); });
+  EXPECT_FALSE(large.is_inline());
+
+  Task moved(std::move(large));
+  EXPECT_FALSE(large);
+  moved();
+  EXPECT_EQ(n, 65);
+
+  // move-only captures.
+  unique_ptr<int> p(new int(3));
+  Task owner([p = std::move(p), &n] { n += *p; });
+  Task other;
+  other = std::move(owner);
+  other();
+  EXPECT_EQ(n, 68);
+}
+
+TEST(TaskTest, destroy) {
+  auto counter = make_shared<int>(0);
+  {
+    Task t([counter] {});
+    EXPECT_EQ(counter.use_count(), 2);
+    Task u(std::move(t));
+    EXPECT_EQ(counter.use_count(), 2);
+  }
+  EXPECT_EQ(counter.use_count(), 1);
+}
+
+static int poll_tasks(Poller *poller) {
+  vector<Event> events(16);
+  Duration timeout(1000);
+  int n = poller->poll(events, &timeout);
+  for (int i = 0; i < n; ++i) {
+    if (events[i].token() == Token(0)) {
+      vector<Event> user;
+      poller->user_poll(user);
+    }
+  }
+  return n;
+}
+
+TEST(ExecutorTest, cross_thread) {
+  auto poller = Poller::new_instance();
+  Executor ex = poller->executor();
+
+  constexpr int Threads = 4, Tasks = 10000;
+  thread::id poller_thread = this_thread::get_id();
+  vector<int> last(Threads, -1);
+  atomic<bool> ordered{true}, same_thread{true};
+  int done = 0;
+
+  vector<thread> producers;
+  for (int i = 0; i < Threads; ++i) {
+    producers.emplace_back([&, ex, i]() mutable {
+      for (int j = 0; j < Tasks; ++j) {
+        ex.post([&, i, j] {
+          if (last[i] != j - 1)
+            ordered = false;
+          if (this_thread::get_id() != poller_thread)
+            same_thread = false;
+          last[i] = j;
+          ++done;
+        });
+      }
+    });
+  }
+
+  while (done < Threads * Tasks)
+    ASSERT_GT(poll_tasks(poller), 0);
+  for (auto &th : producers)
+    th.join();
+  EXPECT_TRUE(ordered);
+  EXPECT_TRUE(same_thread);
+}
+
+TEST(ExecutorTest, outlive_poller) {
+  auto counter = make_shared<int>(0);
+  unique_ptr<Executor> ex;
+  {
+    auto poller = Poller::new_instance();
+    ex.reset(new Executor(poller->executor()));
+    EXPECT_TRUE(ex->post([counter] {}));
+    EXPECT_EQ(counter.use_count(), 2);
+  }
+  // the pending task is dropped with the poller.
+  EXPECT_EQ(counter.use_count(), 1);
+  EXPECT_FALSE(ex->post([counter] {}));
+  EXPECT_EQ(counter.use_count(), 1);
+
+  // copies of a moved-from handle post nowhere.
+  Executor moved(std::move(*ex));
+  Executor copy(*ex);
+  EXPECT_FALSE(copy.post([counter] {}));
+}
+
+TEST(ExecutorTest, no_allocation) {
+  auto poller = Poller::new_instance();
+  Executor ex = poller->executor();
+  int done = 0;
+  // the first posts allocate the nodes.
+  for (int i = 0; i < 4; ++i) {
+    ex.post([&done] { ++done; });
+    poll_tasks(poller);
+  }
+  size_t during_posts = 0;
+  for (int i = 0; i < 1000; ++i) {
+    size_t before = allocations;
+    ex.post([&done] { ++done; });
+    during_posts += allocations - before;
+    poll_tasks(poller);
+  }
+  EXPECT_EQ(done, 1004);
+  EXPECT_EQ(during_posts, 0u);
+}
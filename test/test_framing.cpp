@@ -0,0 +1,230 @@
+//
+// Created by byao on 2/12/18.
+// Copyright (c) 2018 byao. All rights reserved.
+//
+
+#include "../src/bytebuffer.hpp"
+#include "../src/framing.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <gtest/gtest.h>
+#include <limits>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace std;
+using namespace bsnet;
+
+namespace {
+
+vector<string> random_payloads(mt19937 &gen, size_t n, size_t max_size,
+                               bool text) {
+  uniform_int_distribution<size_t> size_dis(0, max_size);
+  uniform_int_distribution<int> byte_dis(text ? 'a' : 0, text ? 'z' : 255);
+  vector<string> res;
+  for (size_t i = 0; i < n; ++i) {
+    string s(size_dis(gen), '\0');
+    for (auto &c : s)
+      c = static_cast<char>(byte_dis(gen));
+    res.push_back(s);
+  }
+  return res;
+}
+
+/**
+ * Feed 'wire' to the codec in random sized chunks, decoding after each one
+ * as a reader of a socket would, returns the payloads decoded.
+ */
+template <typename Codec>
+vector<string> feed(Codec &codec, const string &wire, mt19937 &gen,
+                    size_t max_chunk) {
+  uniform_int_distribution<size_t> chunk_dis(1, max_chunk);
+  // a small buffer, so the frames wrap around the ring.
+  ByteBuffer in(32);
+  vector<string> res;
+  size_t pos = 0;
+  while (pos < wire.size()) {
+    size_t n = min(chunk_dis(gen), wire.size() - pos);
+    in.put(wire.data() + pos, n);
+    pos += n;
+    Frame frame;
+    DecodeResult r;
+    while ((r = codec.decode(in, frame)) == DecodeResult::Frame) {
+      res.push_back(frame.payload.to_string());
+      in.discard(static_cast<ByteBuffer::SizeType>(frame.size));
+    }
+    EXPECT_EQ(r, DecodeResult::NeedMore);
+  }
+  EXPECT_EQ(in.readable_bytes(), 0);
+  return res;
+}
+
+template <typename Codec>
+void fuzz(Codec &codec, bool text, size_t max_size) {
+  mt19937 gen(42);
+  for (size_t max_chunk : {1, 3, 17, 1000}) {
+    auto payloads = random_payloads(gen, 200, max_size, text);
+    ByteBuffer out;
+    for (auto &p : payloads)
+      codec.encode(out, p.data(), p.size());
+    string wire = out.take_string();
+    EXPECT_EQ(feed(codec, wire, gen, max_chunk), payloads);
+  }
+}
+
+} // namespace
+
+TEST(FramingTest, length_fuzz) {
+  length_codec_t<uint32_t> be;
+  fuzz(be, false, 300);
+  length_codec_t<uint16_t, Endian::Little> le;
+  fuzz(le, false, 300);
+  length_codec_t<uint8_t> small;
+  fuzz(small, false, 255);
+}
+
+TEST(FramingTest, length_wire_format) {
+  length_codec_t<uint16_t> codec;
+  ByteBuffer buf;
+  codec.encode(buf, "abc", 3);
+  EXPECT_EQ(buf.readable_bytes(), 5);
+  EXPECT_EQ(buf[0], 0);
+  EXPECT_EQ(buf[1], 3);
+
+  Frame frame;
+  EXPECT_EQ(codec.decode(buf, frame), DecodeResult::Frame);
+  EXPECT_EQ(frame.size, 5u);
+  EXPECT_EQ(frame.payload.to_string(), "abc");
+}
+
+TEST(FramingTest, length_too_large) {
+  length_codec_t<uint32_t> codec(1024);
+  ByteBuffer buf;
+  buf.put<uint32_t>(1025, Endian::Big);
+  Frame frame;
+  EXPECT_EQ(codec.decode(buf, frame), DecodeResult::Invalid);
+
+  // a length wrapping around with the header size.
+  length_codec_t<uint64_t> wide;
+  buf.clear();
+  buf.put<uint64_t>(numeric_limits<uint64_t>::max() - 4, Endian::Big);
+  buf.put_string("abcd");
+  EXPECT_EQ(wide.decode(buf, frame), DecodeResult::NeedMore);
+}
+
+TEST(FramingTest, encode_too_large) {
+  ByteBuffer buf;
+  string big(70000, 'x');
+  length_codec_t<uint16_t> codec;
+  EXPECT_THROW(codec.encode(buf, big.data(), big.size()), framing_error);
+  EXPECT_THROW(codec.encode_header(buf, 65536), framing_error);
+  // a limit above what the length type holds.
+  length_codec_t<uint16_t> wide(100000);
+  EXPECT_THROW(wide.encode_header(buf, 65536), framing_error);
+  length_codec_t<uint32_t> limited(1024);
+  EXPECT_THROW(limited.encode_header(buf, 1025), framing_error);
+  EXPECT_THROW(VarintCodec(100).encode(buf, big.data(), 101), framing_error);
+  EXPECT_THROW(VarintCodec(100).encode_header(buf, 101), framing_error);
+  EXPECT_EQ(buf.readable_bytes(), 0);
+
+  limited.encode_header(buf, 1024);
+  EXPECT_EQ(buf.readable_bytes(), 4);
+}
+
+TEST(FramingTest, line_fuzz) {
+  LineCodec crlf;
+  fuzz(crlf, true, 300);
+  LineCodec lf(8192, false);
+  fuzz(lf, true, 300);
+}
+
+TEST(FramingTest, line_invalid) {
+  LineCodec codec(16);
+  ByteBuffer buf;
+  Frame frame;
+  buf.put_string(string(16, 'a'));
+  EXPECT_EQ(codec.decode(buf, frame), DecodeResult::NeedMore);
+  buf.put_string("b");
+  EXPECT_EQ(codec.decode(buf, frame), DecodeResult::Invalid);
+
+  codec.reset();
+  buf.clear();
+  buf.put_string("ab\r\ncd\n\n");
+  EXPECT_EQ(codec.decode(buf, frame), DecodeResult::Frame);
+  EXPECT_EQ(frame.payload.to_string(), "ab");
+  buf.discard(static_cast<ByteBuffer::SizeType>(frame.size));
+  EXPECT_EQ(codec.decode(buf, frame), DecodeResult::Frame);
+  EXPECT_EQ(frame.payload.to_string(), "cd");
+  buf.discard(static_cast<ByteBuffer::SizeType>(frame.size));
+  EXPECT_EQ(codec.decode(buf, frame), DecodeResult::Frame);
+  EXPECT_TRUE(frame.payload.empty());
+  EXPECT_EQ(frame.size, 1u);
+}
+
+TEST(FramingTest, varint_fuzz) {
+  VarintCodec codec;
+  fuzz(codec, false, 1000);
+}
+
+TEST(FramingTest, varint_invalid) {
+  VarintCodec codec(100);
+  Frame frame;
+  ByteBuffer buf;
+  VarintCodec().encode_header(buf, 300);
+  EXPECT_EQ(buf.readable_bytes(), 2);
+  EXPECT_EQ(buf[0], 0xac);
+  EXPECT_EQ(buf[1], 0x02);
+  EXPECT_EQ(codec.decode(buf, frame), DecodeResult::Invalid);
+
+  // an unterminated varint.
+  buf.clear();
+  for (int i = 0; i < 9; ++i)
+    buf.put<Byte>(0xff);
+  EXPECT_EQ(codec.decode(buf, frame), DecodeResult::NeedMore);
+  buf.put<Byte>(0xff);
+  EXPECT_EQ(codec.decode(buf, frame), DecodeResult::Invalid);
+
+  // the 10th byte overflows 64 bits.
+  VarintCodec wide(numeric_limits<size_t>::max());
+  buf.clear();
+  for (int i = 0; i < 9; ++i)
+    buf.put<Byte>(0xff);
+  buf.put<Byte>(0x02);
+  EXPECT_EQ(wide.decode(buf, frame), DecodeResult::Invalid);
+
+  // the largest length, never as many bytes.
+  buf.clear();
+  for (int i = 0; i < 9; ++i)
+    buf.put<Byte>(0xff);
+  buf.put<Byte>(0x01);
+  buf.put_string("abcd");
+  EXPECT_EQ(wide.decode(buf, frame), DecodeResult::NeedMore);
+}
+
+// garbage never crashes a decoder, and a frame never exceeds the input.
+TEST(FramingTest, random_input) {
+  mt19937 gen(7);
+  uniform_int_distribution<int> byte_dis(0, 255);
+  length_codec_t<uint16_t> length(4096);
+  LineCodec line(64);
+  VarintCodec varint(4096);
+  for (int round = 0; round < 1000; ++round) {
+    ByteBuffer buf;
+    int n = byte_dis(gen);
+    for (int i = 0; i < n; ++i)
+      buf.put(static_cast<Byte>(byte_dis(gen)));
+    auto avail = static_cast<size_t>(buf.readable_bytes());
+    Frame frame;
+    if (length.decode(buf, frame) == DecodeResult::Frame) {
+      EXPECT_LE(frame.size, avail);
+    }
+    line.reset();
+    if (line.decode(buf, frame) == DecodeResult::Frame) {
+      EXPECT_LE(frame.size, avail);
+    }
+    if (varint.decode(buf, frame) == DecodeResult::Frame) {
+      EXPECT_LE(frame.size, avail);
+    }
+  }
+}
@@ -0,0 +1,125 @@
+//
+// Created by byao on 1/16/18.
+// Copyright (c) 2018 byao. All rights reserved.
+//
+#include "../src/address.hpp"
+#include "../src/bytebuffer.hpp"
+#include "../src/handoff.hpp"
+#include "../src/poller_epoll.hpp"
+#include "../src/tcp_listener.hpp"
+#include "../src/tcp_stream.hpp"
+#include "../src/unix_listener.hpp"
+#include "../src/unix_stream.hpp"
+#include "gtest/gtest.h"
+#include <string>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <vector>
+
+using namespace std;
+using namespace bsnet;
+
+static bool wait_readable(Poller &poller, Evented &ev) {
+  vector<Event> events(1);
+  Duration timeout(3000);
+  poller.register_evt(ev, Token(1), Ready::readable(), PollOpt::oneshot());
+  int n = poller.poll(events, &timeout);
+  poller.deregister_evt(ev);
+  return n == 1;
+}
+
+static string read_string(Poller &poller, TcpStream &stream, size_t len) {
+  ByteBuffer buf;
+  while (static_cast<size_t>(buf.readable_bytes()) < len &&
+         wait_readable(poller, stream)) {
+    if (stream.read(buf) <= 0)
+      break;
+  }
+  return buf.take_string();
+}
+
+// the new process: take over the sockets and serve.
+static int new_process(const AddrUnix &handoff_addr) {
+  auto poller = Poller::new_instance();
+  UnixStream conn = UnixStream::connect(handoff_addr);
+  HandoffReceiver receiver;
+  Duration timeout(3000);
+  receiver.receive(conn, &timeout);
+  if (receiver.listener_names() != vector<string>{"http"} ||
+      receiver.stream_names() != vector<string>{"conn-1"})
+    return 1;
+
+  // the connection left in the accept queue of the old process.
+  TcpListener listener = receiver.take_listener("http");
+  if (!wait_readable(*poller, listener))
+    return 2;
+  TcpStream pending = listener.accept();
+  ByteBuffer hello;
+  hello.put_string("served by new");
+  pending.write(hello);
+
+  // the established connection, with the bytes buffered by the old process.
+  ByteBuffer rbuf, wbuf;
+  TcpStream stream = receiver.take_stream("conn-1", &rbuf, &wbuf);
+  if (rbuf.take_string() != "half a requ")
+    return 3;
+  if (stream.write(wbuf) != 13)
+    return 4;
+  return 0;
+}
+
+TEST(HandoffTest, hot_restart) {
+  auto poller = Poller::new_instance();
+  AddrUnix handoff_addr =
+      AddrUnix::abstract("bsnet-handoff-" + to_string(::getpid()));
+  UnixListener handoff = UnixListener::bind(handoff_addr, 1);
+
+  TcpListener listener = TcpListener::bind(AddrV4::from("127.0.0.1:0"), 16);
+  Addr addr;
+  listener.local_addr(addr);
+
+  // an established connection with buffered data, and a connection still
+  // waiting in the accept queue.
+  TcpStream client1 = TcpStream::connect(addr);
+  ASSERT_TRUE(wait_readable(*poller, listener));
+  TcpStream conn1 = listener.accept();
+  TcpStream client2 = TcpStream::connect(addr);
+
+  ByteBuffer rbuf, wbuf;
+  rbuf.put_string("half a requ");
+  wbuf.put_string("pending reply");
+
+  pid_t pid = ::fork();
+  ASSERT_NE(pid, -1);
+  if (pid == 0) {
+    int code;
+    try {
+      code = new_process(handoff_addr);
+    } catch (std::exception &ex) {
+      fprintf(stderr, "new process: %s\n", ex.what());
+      code = 10;
+    }
+    ::_exit(code);
+  }
+
+  ASSERT_TRUE(wait_readable(*poller, handoff));
+  UnixStream conn = handoff.accept();
+  HandoffSender sender;
+  sender.add_listener("http", listener);
+  sender.add_stream("conn-1", conn1, rbuf, wbuf);
+  Duration timeout(3000);
+  sender.send(conn, &timeout);
+
+  int status;
+  ASSERT_EQ(::waitpid(pid, &status, 0), pid);
+  ASSERT_TRUE(WIFEXITED(status));
+  EXPECT_EQ(WEXITSTATUS(status), 0);
+
+  EXPECT_EQ(read_string(*poller, client2, 13), "served by new");
+  EXPECT_EQ(read_string(*poller, client1, 13), "pending reply");
+}
+
+TEST(HandoffTest, missing_item) {
+  HandoffReceiver receiver;
+  EXPECT_THROW(receiver.take_listener("none"), handoff_error);
+}
@@ -0,0 +1,287 @@
+//
+// Created by byao on 2/14/18.
+// Copyright (c) 2018 byao. All rights reserved.
+//
+
+#include "../src/address.hpp"
+#include "../src/bytebuffer.hpp"
+#include "../src/http.hpp"
+#include "../src/tcp_listener.hpp"
+#include "../src/tcp_stream.hpp"
+#include <algorithm>
+#include <gtest/gtest.h>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace std;
+using namespace bsnet;
+
+namespace {
+
+struct Parsed {
+  string method;
+  string target;
+  string host;
+  bool keep_alive;
+  string body;
+};
+
+/**
+ * Feed 'wire' in random sized chunks, consuming after every result, as a
+ * server reading a connection would.
+ */
+vector<Parsed> feed(const string &wire, size_t max_chunk, unsigned seed,
+                    HttpResult *last = nullptr) {
+  mt19937 gen(seed);
+  uniform_int_distribution<size_t> chunk_dis(1, max_chunk);
+  // a small ring, so the heads wrap around its end.
+  ByteBuffer in(64);
+  HttpParser parser;
+  HttpRequest req;
+  vector<Parsed> res;
+  size_t pos = 0;
+  HttpResult r = HttpResult::NeedMore;
+  while (pos < wire.size() && r != HttpResult::Invalid) {
+    size_t n = min(chunk_dis(gen), wire.size() - pos);
+    in.put(wire.data() + pos, n);
+    pos += n;
+    while ((r = parser.parse(in, req)) != HttpResult::NeedMore &&
+           r != HttpResult::Invalid) {
+      if (r == HttpResult::Head) {
+        const StringRef *host = req.header("host");
+        res.push_back(Parsed{req.method.to_string(), req.target.to_string(),
+                             host ? host->to_string() : "", req.keep_alive,
+                             ""});
+      } else if (r == HttpResult::Body) {
+        res.back().body += req.body.to_string();
+      }
+      parser.consume(in);
+    }
+  }
+  if (last)
+    *last = r;
+  return res;
+}
+
+HttpResult parse_all(const string &wire) {
+  HttpResult r;
+  feed(wire, wire.size(), 0, &r);
+  return r;
+}
+
+} // namespace
+
+TEST(HttpParserTest, simple_get) {
+  ByteBuffer buf;
+  buf.put_string("GET /index.html?q=1 HTTP/1.1\r\n"
+                 "Host: example.com\r\n"
+                 "Accept:  */*  \r\n"
+                 "X-Empty:\r\n"
+                 "\r\n");
+  HttpParser parser;
+  HttpRequest req;
+  ASSERT_EQ(parser.parse(buf, req), HttpResult::Head);
+  EXPECT_TRUE(req.method.equals("GET"));
+  EXPECT_TRUE(req.target.equals("/index.html?q=1"));
+  EXPECT_EQ(req.minor_version, 1);
+  EXPECT_TRUE(req.keep_alive);
+  ASSERT_EQ(req.headers.size(), 3u);
+  EXPECT_TRUE(req.headers[0].name.equals("Host"));
+  EXPECT_TRUE(req.header("HOST")->equals("example.com"));
+  EXPECT_TRUE(req.header("accept")->equals("*/*"));
+  EXPECT_TRUE(req.header("x-empty")->empty());
+  EXPECT_EQ(req.header("cookie"), nullptr);
+
+  EXPECT_EQ(parser.parse(buf, req), HttpResult::Done);
+  EXPECT_EQ(parser.parsed(), static_cast<size_t>(buf.readable_bytes()));
+  parser.consume(buf);
+  EXPECT_EQ(buf.readable_bytes(), 0);
+  EXPECT_EQ(parser.parse(buf, req), HttpResult::NeedMore);
+}
+
+TEST(HttpParserTest, keep_alive) {
+  auto parsed = feed("GET / HTTP/1.0\r\n\r\n"
+                     "GET / HTTP/1.0\r\nConnection: Keep-Alive\r\n\r\n"
+                     "GET / HTTP/1.1\r\nConnection: foo, close\r\n\r\n"
+                     "GET / HTTP/1.1\r\n\r\n",
+                     1000, 0);
+  ASSERT_EQ(parsed.size(), 4u);
+  EXPECT_FALSE(parsed[0].keep_alive);
+  EXPECT_TRUE(parsed[1].keep_alive);
+  EXPECT_FALSE(parsed[2].keep_alive);
+  EXPECT_TRUE(parsed[3].keep_alive);
+}
+
+TEST(HttpParserTest, pipelined_bodies) {
+  string wire;
+  vector<Parsed> expect;
+  mt19937 gen(1);
+  uniform_int_distribution<int> kind_dis(0, 2), size_dis(0, 300);
+  for (int i = 0; i < 100; ++i) {
+    string body(static_cast<size_t>(size_dis(gen)), 'a' + i % 26);
+    string target = "/r" + to_string(i);
+    string host = "h" + to_string(i);
+    int kind = kind_dis(gen);
+    if (kind == 0)
+      body.clear();
+    wire += (kind == 0 ? "GET " : "POST ") + target + " HTTP/1.1\r\n";
+    wire += "Host: " + host + "\r\n";
+    if (kind == 1) {
+      wire += "Content-Length: " + to_string(body.size()) + "\r\n\r\n" + body;
+    } else if (kind == 2) {
+      wire += "Transfer-Encoding: chunked\r\n\r\n";
+      // chunks of random sizes, with an extension now and then.
+      size_t pos = 0;
+      while (pos < body.size()) {
+        size_t n = min(body.size() - pos, static_cast<size_t>(size_dis(gen)));
+        char hex[16];
+        snprintf(hex, sizeof(hex), "%zX", n);
+        wire += string(hex) + (n % 2 ? ";ext=1" : "") + "\r\n" +
+                body.substr(pos, n) + "\r\n";
+        pos += n;
+      }
+      wire += "0\r\nX-Trailer: t\r\n\r\n";
+    } else {
+      wire += "\r\n";
+    }
+    expect.push_back(Parsed{kind == 0 ? "GET" : "POST", target, host, true,
+                            body});
+  }
+
+  for (size_t max_chunk : {1, 7, 64, 4096}) {
+    HttpResult last;
+    auto parsed = feed(wire, max_chunk, 42, &last);
+    EXPECT_EQ(last, HttpResult::NeedMore);
+    ASSERT_EQ(parsed.size(), expect.size());
+    for (size_t i = 0; i < expect.size(); ++i) {
+      EXPECT_EQ(parsed[i].method, expect[i].method);
+      EXPECT_EQ(parsed[i].target, expect[i].target);
+      EXPECT_EQ(parsed[i].host, expect[i].host);
+      EXPECT_EQ(parsed[i].body, expect[i].body);
+    }
+  }
+}
+
+TEST(HttpParserTest, invalid) {
+  EXPECT_EQ(parse_all("GET / HTTP/2.0\r\n\r\n"), HttpResult::Invalid);
+  EXPECT_EQ(parse_all("GET  / HTTP/1.1\r\n\r\n"), HttpResult::Invalid);
+  EXPECT_EQ(parse_all("GET / HTTP/1.1\r\nHost : a\r\n\r\n"),
+            HttpResult::Invalid);
+  EXPECT_EQ(parse_all("GET / HTTP/1.1\r\nA: b\r\n  folded\r\n\r\n"),
+            HttpResult::Invalid);
+  EXPECT_EQ(parse_all("GET / HTTP/1.1\r\nA: b\x01\r\n\r\n"),
+            HttpResult::Invalid);
+  EXPECT_EQ(parse_all("POST / HTTP/1.1\r\nContent-Length: 1x\r\n\r\n"),
+            HttpResult::Invalid);
+  EXPECT_EQ(parse_all("POST / HTTP/1.1\r\nContent-Length: 1\r\n"
+                      "Content-Length: 2\r\n\r\n"),
+            HttpResult::Invalid);
+  EXPECT_EQ(parse_all("POST / HTTP/1.1\r\nContent-Length: 1\r\n"
+                      "Transfer-Encoding: chunked\r\n\r\n"),
+            HttpResult::Invalid);
+  EXPECT_EQ(parse_all("POST / HTTP/1.1\r\nTransfer-Encoding: gzip\r\n\r\n"),
+            HttpResult::Invalid);
+  EXPECT_EQ(parse_all("POST / HTTP/1.1\r\nTransfer-Encoding: chunked\r\n\r\n"
+                      "zz\r\n"),
+            HttpResult::Invalid);
+  EXPECT_EQ(parse_all("POST / HTTP/1.1\r\nTransfer-Encoding: chunked\r\n\r\n"
+                      "1\r\nab\r\n"),
+            HttpResult::Invalid);
+
+  // a head too large, without the end.
+  EXPECT_EQ(parse_all("GET / HTTP/1.1\r\nA: " + string(9000, 'a')),
+            HttpResult::Invalid);
+  string many = "GET / HTTP/1.1\r\n";
+  for (int i = 0; i < 65; ++i)
+    many += "A: b\r\n";
+  EXPECT_EQ(parse_all(many + "\r\n"), HttpResult::Invalid);
+}
+
+// garbage never crashes the parser, nor reads past the input.
+TEST(HttpParserTest, random_input) {
+  mt19937 gen(3);
+  const string alphabet = "GET /HTP1.0\r\n:abc;-0123456789";
+  uniform_int_distribution<size_t> pick(0, alphabet.size() - 1), len(0, 200);
+  for (int round = 0; round < 2000; ++round) {
+    string wire = "GET / HTTP/1.1\r\n";
+    size_t n = len(gen);
+    for (size_t i = 0; i < n; ++i)
+      wire += alphabet[pick(gen)];
+    feed(wire, 16, static_cast<unsigned>(round));
+  }
+}
+
+TEST(HttpResponseTest, content_length) {
+  HttpResponse res;
+  ByteBuffer out;
+  string part1 = "Hello, ", part2 = "World!";
+  res.start(200);
+  res.header("Content-Type", "text/plain");
+  res.body(part1);
+  res.body(part2);
+  res.write_to(out);
+  EXPECT_EQ(out.take_string(), "HTTP/1.1 200 OK\r\n"
+                               "Content-Type: text/plain\r\n"
+                               "Content-Length: 13\r\n"
+                               "\r\n"
+                               "Hello, World!");
+
+  res.start(404, nullptr, 0);
+  res.header("content-length", static_cast<size_t>(0));
+  res.write_to(out);
+  EXPECT_EQ(out.take_string(), "HTTP/1.0 404 Not Found\r\n"
+                               "content-length: 0\r\n"
+                               "\r\n");
+}
+
+TEST(HttpResponseTest, chunked_parts) {
+  HttpResponse res;
+  ByteBuffer out;
+  res.start(200, "Fine");
+  res.chunked();
+  string chunk(26, 'x');
+  res.body(chunk);
+  res.write_to(out, false);
+  EXPECT_EQ(out.take_string(), "HTTP/1.1 200 Fine\r\n"
+                               "Transfer-Encoding: chunked\r\n"
+                               "\r\n"
+                               "1a\r\n" +
+                                   chunk + "\r\n");
+
+  // a view wrapping around the ring is a single chunk.
+  ByteBuffer ring(16);
+  ring.put_string(string(10, '-'));
+  ring.discard(10);
+  ring.put_string("0123456789ab");
+  res.body(ring.view(0, 12));
+  res.body("", 0);
+  res.write_to(out);
+  EXPECT_EQ(out.take_string(), "c\r\n0123456789ab\r\n0\r\n\r\n");
+}
+
+TEST(HttpResponseTest, send_gathered) {
+  TcpListener listener = TcpListener::bind(AddrV4::from("127.0.0.1:0"), 16);
+  Addr addr;
+  listener.local_addr(addr);
+  TcpStream client = TcpStream::connect(addr);
+  TcpStream server = listener.accept();
+
+  string body(100 * 1024, 'b');
+  HttpResponse res;
+  res.start(200);
+  res.body(body);
+  EXPECT_TRUE(res.send(server) || server.is_write_blocked());
+
+  string expect = "HTTP/1.1 200 OK\r\nContent-Length: 102400\r\n\r\n" + body;
+  // what the socket didn't take was queued, the body can go away.
+  body.assign(body.size(), 'c');
+  ByteBuffer in;
+  string got;
+  while (got.size() < expect.size()) {
+    server.flush();
+    if (client.read(in) > 0)
+      got += in.take_string();
+  }
+  EXPECT_EQ(got, expect);
+}
@@ -0,0 +1,139 @@
+//
+// Created by byao on 1/30/18.
+// Copyright (c) 2018 byao. All rights reserved.
+//
+
+#include "../src/lockfree_queue.hpp"
+#include <atomic>
+#include <gtest/gtest.h>
+#include <memory>
+#include <numeric>
+#include <thread>
+#include <vector>
+
+using namespace std;
+using namespace bsnet;
+
+TEST(SpscQueueTest, put_get) {
+  spsc_queue_t<int> q(5);
+  EXPECT_EQ(q.capacity(), 8);
+  for (int i = 0; i < 8; ++i)
+    EXPECT_TRUE(q.try_put(i));
+  EXPECT_FALSE(q.try_put(8));
+  EXPECT_EQ(q.size(), 8);
+
+  int v;
+  for (int i = 0; i < 8; ++i) {
+    ASSERT_TRUE(q.try_get(v));
+    EXPECT_EQ(v, i);
+  }
+  EXPECT_FALSE(q.try_get(v));
+  EXPECT_TRUE(q.empty());
+
+  vector<int> in(20);
+  iota(in.begin(), in.end(), 0);
+  EXPECT_EQ(q.try_put_n(in.begin(), in.size()), 8);
+  vector<int> out;
+  EXPECT_EQ(q.try_get_n(out, 5), 5);
+  EXPECT_EQ(q.try_get_n(out, 100), 3);
+  EXPECT_EQ(out, vector<int>(in.begin(), in.begin() + 8));
+}
+
+TEST(SpscQueueTest, move_only) {
+  auto counter = make_shared<int>(0);
+  {
+    spsc_queue_t<unique_ptr<shared_ptr<int>>> q(4);
+    q.put(unique_ptr<shared_ptr<int>>(new shared_ptr<int>(counter)));
+    q.put(unique_ptr<shared_ptr<int>>(new shared_ptr<int>(counter)));
+    unique_ptr<shared_ptr<int>> p;
+    q.get(p);
+    EXPECT_EQ(*p, counter);
+    EXPECT_EQ(counter.use_count(), 3);
+  }
+  // the element left is destroyed with the queue.
+  EXPECT_EQ(counter.use_count(), 1);
+}
+
+TEST(SpscQueueTest, threads) {
+  constexpr uint64_t N = 1000000;
+  spsc_queue_t<uint64_t> q(1024);
+  thread producer([&] {
+    for (uint64_t i = 0; i < N; ++i)
+      q.put(i);
+  });
+  bool ordered = true;
+  for (uint64_t i = 0; i < N; ++i) {
+    uint64_t v;
+    q.get(v);
+    ordered = ordered && v == i;
+  }
+  producer.join();
+  EXPECT_TRUE(ordered);
+}
+
+TEST(MpmcQueueTest, put_get) {
+  mpmc_queue_t<int> q(4);
+  for (int i = 0; i < 4; ++i)
+    EXPECT_TRUE(q.try_emplace(i));
+  EXPECT_FALSE(q.try_put(4));
+  int v;
+  ASSERT_TRUE(q.try_get(v));
+  EXPECT_EQ(v, 0);
+  EXPECT_TRUE(q.try_put(4));
+  vector<int> out;
+  EXPECT_EQ(q.try_get_n(out, 10), 4);
+  EXPECT_EQ(out, (vector<int>{1, 2, 3, 4}));
+  EXPECT_FALSE(q.try_get(v));
+}
+
+struct NoDefault {
+  explicit NoDefault(int v) : v(v) {}
+  int v;
+};
+
+TEST(MpmcQueueTest, get_n_no_default) {
+  mpmc_queue_t<NoDefault> q(4);
+  spsc_queue_t<NoDefault> sq(4);
+  for (int i = 0; i < 3; ++i) {
+    EXPECT_TRUE(q.try_emplace(i));
+    EXPECT_TRUE(sq.try_emplace(i));
+  }
+  vector<NoDefault> out, sout;
+  EXPECT_EQ(q.try_get_n(out, 10), 3);
+  EXPECT_EQ(sq.try_get_n(sout, 10), 3);
+  for (int i = 0; i < 3; ++i) {
+    EXPECT_EQ(out[i].v, i);
+    EXPECT_EQ(sout[i].v, i);
+  }
+  EXPECT_TRUE(q.empty());
+}
+
+TEST(MpmcQueueTest, threads) {
+  constexpr int Producers = 4, Consumers = 4, N = 200000;
+  mpmc_queue_t<int> q(256);
+  vector<atomic<int>> seen(Producers * N);
+  atomic<int> consumed{0};
+
+  vector<thread> threads;
+  for (int p = 0; p < Producers; ++p) {
+    threads.emplace_back([&, p] {
+      for (int i = 0; i < N; ++i)
+        q.put(p * N + i);
+    });
+  }
+  for (int c = 0; c < Consumers; ++c) {
+    threads.emplace_back([&] {
+      int v;
+      while (consumed.load() < Producers * N) {
+        if (q.try_get(v)) {
+          seen[v].fetch_add(1);
+          consumed.fetch_add(1);
+        }
+      }
+    });
+  }
+  for (auto &th : threads)
+    th.join();
+  for (int i = 0; i < Producers * N; ++i)
+    ASSERT_EQ(seen[i].load(), 1) << i;
+}
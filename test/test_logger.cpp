@@ -0,0 +1,81 @@
+//
+// Created by byao on 2/7/18.
+// Copyright (c) 2018 byao. All rights reserved.
+//
+
+#include "../src/bytebuffer.hpp"
+#include "../src/logger.hpp"
+#include <cerrno>
+#include <fcntl.h>
+#include <gtest/gtest.h>
+#include <string>
+#include <unistd.h>
+
+using namespace std;
+using namespace bsnet;
+
+struct LoggerTest : ::testing::Test {
+  LoggerTest() {
+    Logger &logger = Logger::instance();
+    logger.flush();
+    logger.set_sink([this](const char *data, size_t len) {
+      out.append(data, len);
+    });
+  }
+
+  ~LoggerTest() override {
+    Logger::instance().set_sink(nullptr);
+    Logger::set_level(LogLevel::Warn);
+    Logger::set_rate_limit(Logger::DefaultRateLimit);
+  }
+
+  string flushed() {
+    Logger::instance().flush();
+    return out;
+  }
+
+  string out;
+};
+
+TEST_F(LoggerTest, format) {
+  BSNET_LOG(LogLevel::Error, "fd %lld, %lld bytes", 7, 1024);
+  errno = EBADF;
+  BSNET_PLOG(LogLevel::Warn, "closing");
+  EXPECT_EQ(errno, EBADF);
+  string s = flushed();
+  EXPECT_NE(s.find("ERROR fd 7, 1024 bytes\n"), string::npos);
+  EXPECT_NE(s.find("WARN  closing: Bad file descriptor\n"), string::npos);
+}
+
+TEST_F(LoggerTest, level) {
+  BSNET_LOG(LogLevel::Info, "hidden");
+  EXPECT_EQ(flushed(), "");
+  Logger::set_level(LogLevel::Info);
+  BSNET_LOG(LogLevel::Info, "shown");
+  EXPECT_NE(flushed().find("INFO  shown"), string::npos);
+}
+
+TEST_F(LoggerTest, rate_limit) {
+  Logger::set_rate_limit(3);
+  for (int i = 0; i < 10; ++i)
+    BSNET_LOG(LogLevel::Warn, "flood %lld", i);
+  string s = flushed();
+  EXPECT_NE(s.find("flood 2\n"), string::npos);
+  EXPECT_EQ(s.find("flood 3"), string::npos);
+}
+
+TEST_F(LoggerTest, buffer_errors) {
+  int fds[2];
+  ASSERT_EQ(::pipe2(fds, O_NONBLOCK), 0);
+  ByteBuffer buf(64);
+  // an empty nonblocking pipe is not an error worth logging.
+  EXPECT_EQ(buf.read_from(fds[0]), -1);
+  EXPECT_EQ(errno, EAGAIN);
+  EXPECT_EQ(flushed(), "");
+
+  ::close(fds[0]);
+  ::close(fds[1]);
+  EXPECT_EQ(buf.read_from(fds[0]), -1);
+  EXPECT_EQ(errno, EBADF);
+  EXPECT_NE(flushed().find("ByteBuffer::read_from, fd"), string::npos);
+}
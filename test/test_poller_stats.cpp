@@ -0,0 +1,58 @@
+//
+// Created by byao on 2/5/18.
+// Copyright (c) 2018 byao. All rights reserved.
+//
+
+#include "../src/executor.hpp"
+#include "../src/poller_epoll.hpp"
+#include "../src/registration.hpp"
+#include <gtest/gtest.h>
+#include <vector>
+
+using namespace std;
+using namespace bsnet;
+
+TEST(PollerStatsTest, bucket) {
+  EXPECT_EQ(PollerStats::bucket(0), 0u);
+  EXPECT_EQ(PollerStats::bucket(1), 1u);
+  EXPECT_EQ(PollerStats::bucket(2), 2u);
+  EXPECT_EQ(PollerStats::bucket(3), 2u);
+  EXPECT_EQ(PollerStats::bucket(4), 3u);
+  EXPECT_EQ(PollerStats::bucket(1u << 20), PollerStats::EventBuckets - 1);
+}
+
+TEST(PollerStatsTest, counters) {
+  auto poller = Poller::new_instance();
+  Registration reg;
+  poller->register_evt(reg, Token(1), Ready::readable(), PollOpt::edge());
+  SetReadiness sr = reg.new_set_readiness();
+
+  vector<Event> events(16), user;
+  Duration timeout(0);
+  EXPECT_EQ(poller->poll(events, &timeout), 0);
+
+  sr.set_readiness(Ready::readable());
+  int ran = 0;
+  poller->executor().post([&ran] { ++ran; });
+  ASSERT_EQ(poller->poll(events, &timeout), 1);
+  EXPECT_EQ(poller->user_poll(user), 1);
+  EXPECT_EQ(ran, 1);
+
+  PollerStats stats = poller->stats();
+  if (!PollerStats::enabled()) {
+    EXPECT_EQ(stats.polls, 0u);
+    EXPECT_EQ(stats.user_polls, 0u);
+    return;
+  }
+  EXPECT_EQ(stats.polls, 2u);
+  EXPECT_EQ(stats.timeouts, 1u);
+  EXPECT_EQ(stats.events, 1u);
+  EXPECT_EQ(stats.events_hist[0], 1u);
+  EXPECT_EQ(stats.events_hist[1], 1u);
+  EXPECT_EQ(stats.wakeups, 1u);
+  EXPECT_GT(stats.busy_ns, 0u);
+  EXPECT_EQ(stats.user_polls, 1u);
+  EXPECT_EQ(stats.user_events, 1u);
+  EXPECT_EQ(stats.tasks, 1u);
+  EXPECT_EQ(stats.max_user_events, 1u);
+}
@@ -2,10 +2,12 @@
 // Created by byao on 12/20/17.
 // Copyright (c) 2017 byao. All rights reserved.
 //
+#include "../src/neterr.hpp"
 #include "../src/poller_epoll.hpp"
 #include "../src/registration.hpp"
 #include <chrono>
 #include <gtest/gtest.h>
+#include <memory>
 #include <queue>
 #include <random>
 #include <thread>
@@ -74,3 +76,145 @@ TEST(TestRegistration, registration) {
     }
   }
 }
+
+static int drain(Poller *poller, vector<Event> &events) {
+  events.clear();
+  return poller->user_poll(events);
+}
+
+TEST(TestRegistration, multiple_producers) {
+  auto poller = Poller::new_instance();
+  Registration reg;
+  poller->register_evt(reg, Token(7), Ready::readable() | Ready::writable(),
+                       PollOpt::edge());
+
+  // far more signals than the queue could hold events.
+  SetReadiness sr = reg.new_set_readiness();
+  vector<thread> producers;
+  for (int i = 0; i < 4; ++i) {
+    producers.emplace_back([sr, i]() mutable {
+      for (int j = 0; j < 10000; ++j)
+        sr.set_readiness(i % 2 ? Ready::readable() : Ready::writable());
+    });
+  }
+  for (auto &th : producers)
+    th.join();
+
+  // coalesced into one event, with the bits merged.
+  vector<Event> events;
+  ASSERT_EQ(drain(poller, events), 1);
+  EXPECT_EQ(events[0].token(), Token(7));
+  EXPECT_TRUE(events[0].readiness().is_readable());
+  EXPECT_TRUE(events[0].readiness().is_writable());
+  EXPECT_EQ(drain(poller, events), 0);
+
+  sr.set_readiness(Ready::readable());
+  ASSERT_EQ(drain(poller, events), 1);
+  EXPECT_EQ(events[0].readiness(), Ready::readable());
+}
+
+TEST(TestRegistration, level) {
+  auto poller = Poller::new_instance();
+  Registration reg;
+  SetReadiness sr = reg.new_set_readiness();
+  poller->register_evt(reg, Token(1), Ready::readable(), PollOpt::level());
+
+  // reported while ready.
+  vector<Event> events;
+  sr.set_readiness(Ready::readable());
+  sr.set_readiness(Ready::readable());
+  EXPECT_EQ(drain(poller, events), 1);
+  EXPECT_EQ(drain(poller, events), 1);
+
+  sr.set_readiness(Ready::empty());
+  EXPECT_EQ(drain(poller, events), 0);
+  EXPECT_EQ(drain(poller, events), 0);
+}
+
+TEST(TestRegistration, oneshot) {
+  auto poller = Poller::new_instance();
+  Registration reg;
+  SetReadiness sr = reg.new_set_readiness();
+  poller->register_evt(reg, Token(1), Ready::readable(), PollOpt::oneshot());
+
+  vector<Event> events;
+  sr.set_readiness(Ready::readable());
+  sr.set_readiness(Ready::readable());
+  EXPECT_EQ(drain(poller, events), 1);
+
+  poller->reregister_evt(reg, Token(2), Ready::readable(), PollOpt::oneshot());
+  sr.set_readiness(Ready::writable());
+  sr.set_readiness(Ready::readable());
+  ASSERT_EQ(drain(poller, events), 1);
+  EXPECT_EQ(events[0].token(), Token(2));
+
+  poller->reregister_evt(reg, Token(3), Ready::readable(), PollOpt::level());
+  poller->deregister_evt(reg);
+  sr.set_readiness(Ready::readable());
+  EXPECT_EQ(drain(poller, events), 0);
+
+  auto other = Poller::new_instance();
+  EXPECT_THROW(
+      other->register_evt(reg, Token(1), Ready::readable(), PollOpt::level()),
+      registration_error);
+
+  error_code ec;
+  other->register_evt(reg, Token(1), Ready::readable(), PollOpt::level(), ec);
+  EXPECT_EQ(ec, errc::invalid_argument);
+  poller->reregister_evt(reg, Token(2), Ready::readable(), PollOpt::level(),
+                         ec);
+  EXPECT_FALSE(ec);
+}
+
+// fails with EEXIST, and clobbers errno while the error unwinds.
+struct Failing : public Evented {
+  struct Clobber {
+    ~Clobber() { errno = 0; }
+  };
+
+  void register_on(Poller &, Token, Ready, PollOpt) override {
+    Clobber c;
+    errno = EEXIST;
+    throw registration_error("register");
+  }
+  void reregister_on(Poller &, Token, Ready, PollOpt) override {
+    throw system_error(make_error_code(errc::permission_denied));
+  }
+  void deregister_on(Poller &) override { throw 1; }
+};
+
+TEST(TestRegistration, default_error_code) {
+  auto poller = Poller::new_instance();
+  Failing f;
+  error_code ec;
+  poller->register_evt(f, Token(1), Ready::readable(), PollOpt::level(), ec);
+  EXPECT_EQ(ec, errc::file_exists);
+  poller->reregister_evt(f, Token(1), Ready::readable(), PollOpt::level(),
+                         ec);
+  EXPECT_EQ(ec, errc::permission_denied);
+  poller->deregister_evt(f, ec);
+  EXPECT_EQ(ec, errc::invalid_argument);
+}
+
+TEST(TestRegistration, lifetime) {
+  // handles outlive the registration, and the poller.
+  SetReadiness sr = [] {
+    Registration reg;
+    return reg.new_set_readiness();
+  }();
+  sr.set_readiness(Ready::readable());
+
+  unique_ptr<Registration> reg(new Registration());
+  SetReadiness copy = reg->new_set_readiness();
+  {
+    auto poller = Poller::new_instance();
+    poller->register_evt(*reg, Token(1), Ready::readable(), PollOpt::level());
+    copy.set_readiness(Ready::readable());
+  }
+  copy.set_readiness(Ready::readable());
+  SetReadiness last = copy;
+  reg.reset();
+  copy = sr;
+  last.set_readiness(Ready::readable());
+  EXPECT_TRUE(last.readiness().is_readable());
+}
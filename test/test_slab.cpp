@@ -0,0 +1,108 @@
+//
+// Created by byao on 1/21/18.
+// Copyright (c) 2018 byao. All rights reserved.
+//
+
+#include "../src/slab.hpp"
+#include <gtest/gtest.h>
+#include <memory>
+#include <string>
+#include <vector>
+using namespace std;
+using namespace bsnet;
+
+TEST(SlabTest, insert_remove) {
+  Slab<string> slab;
+  Token a = slab.insert("a");
+  Token b = slab.emplace(3, 'b');
+  EXPECT_EQ(a.index(), 0);
+  EXPECT_EQ(b.index(), 1);
+  EXPECT_EQ(slab.size(), 2);
+  EXPECT_EQ(slab[a], "a");
+  EXPECT_EQ(*slab.get(b), "bbb");
+
+  EXPECT_TRUE(slab.remove(a));
+  EXPECT_FALSE(slab.remove(a));
+  EXPECT_EQ(slab.get(a), nullptr);
+  EXPECT_EQ(slab.size(), 1);
+
+  // the slot is reused, the stale token doesn't see the new entry.
+  Token c = slab.insert("c");
+  EXPECT_EQ(c.index(), a.index());
+  EXPECT_EQ(slab.get(a), nullptr);
+  EXPECT_EQ(slab[c], "c");
+}
+
+TEST(SlabTest, zero_generation) {
+  Slab<string> slab;
+  Token a = slab.insert("a");
+  Token b = slab.insert("b");
+  EXPECT_FALSE(slab.contains(Token()));
+  EXPECT_TRUE(slab.remove(a));
+
+  // a vacant slot must not match a token of generation 0, which is just
+  // its index.
+  EXPECT_EQ(slab.get(Token()), nullptr);
+  EXPECT_FALSE(slab.contains(Token()));
+  EXPECT_FALSE(slab.remove(Token()));
+  EXPECT_EQ(slab.get(Token(uint64_t{a.index()})), nullptr);
+  EXPECT_FALSE(slab.remove(Token(uint64_t{a.index()})));
+  EXPECT_EQ(slab.get(Token(uint64_t{b.index()})), nullptr);
+  EXPECT_EQ(slab.size(), 1);
+  EXPECT_EQ(slab[b], "b");
+}
+
+TEST(SlabTest, stable_address) {
+  Slab<int> slab(4);
+  Token first = slab.insert(42);
+  int *p = slab.get(first);
+  vector<Token> tokens;
+  for (int i = 0; i < 10000; ++i)
+    tokens.push_back(slab.insert(i));
+  EXPECT_EQ(slab.get(first), p);
+  EXPECT_EQ(*p, 42);
+  for (int i = 0; i < 10000; ++i)
+    EXPECT_EQ(slab[tokens[i]], i);
+}
+
+TEST(SlabTest, iterate) {
+  Slab<int> slab;
+  vector<Token> tokens;
+  for (int i = 0; i < 600; ++i)
+    tokens.push_back(slab.insert(i));
+  for (int i = 0; i < 600; i += 2)
+    slab.remove(tokens[i]);
+
+  int n = 0;
+  for (auto it = slab.begin(); it != slab.end(); ++it) {
+    EXPECT_EQ(*it % 2, 1);
+    EXPECT_EQ(it.token(), tokens[*it]);
+    ++n;
+  }
+  EXPECT_EQ(n, 300);
+
+  const Slab<int> &cslab = slab;
+  int sum = 0;
+  for (const int &v : cslab)
+    sum += v;
+  EXPECT_EQ(sum, 300 * 300);
+}
+
+TEST(SlabTest, destroy) {
+  auto counter = make_shared<int>(0);
+  {
+    Slab<shared_ptr<int>> slab;
+    Token tok = slab.insert(counter);
+    slab.insert(counter);
+    EXPECT_EQ(counter.use_count(), 3);
+    slab.remove(tok);
+    EXPECT_EQ(counter.use_count(), 2);
+  }
+  EXPECT_EQ(counter.use_count(), 1);
+
+  Slab<int> small(64, 64);
+  for (int i = 0; i < 64; ++i)
+    small.insert(i);
+  EXPECT_THROW(small.insert(0), token_exhuasted);
+  EXPECT_EQ(small.size(), 64);
+}
@@ -1,5 +1,6 @@
 #include "../src/address.hpp"
 #include "../src/bytebuffer.hpp"
+#include "../src/neterr.hpp"
 #include "../src/poller_epoll.hpp"
 #include "../src/tcp_listener.hpp"
 #include "../src/tcp_stream.hpp"
@@ -25,9 +26,8 @@ struct TcpStreamTest : ::testing::Test {
   using Buffer = TcpStream::Buf;
 
   TcpStreamTest()
-      : host("127.0.0.1"), service("8081"),
-        server(TcpListener::bind(AddrV4::from(host + ":" + service), 128)),
-        poller(Poller::new_instance()) {}
+      : host("127.0.0.1"), service("8081"), poller(Poller::new_instance()),
+        server(TcpListener::bind(AddrV4::from(host + ":" + service), 128)) {}
 
   ~TcpStreamTest() override {}
 
@@ -41,13 +41,13 @@ struct TcpStreamTest : ::testing::Test {
       vector<Event> events(1);
       poller->register_evt(server, Token(0), Ready::readable(),
                            PollOpt::level());
-      int n = poller->poll(events);
+      poller->poll(events);
 
       TcpStream peer = server.accept();
       poller->register_evt(peer, Token(1), Ready::readable(), PollOpt::level());
-      n = poller->poll(events);
+      poller->poll(events);
 
-      if (events[0].token() == 1 &&
+      if (events[0].token() == Token(1) &&
           events[0].readiness() == Ready::readable()) {
         int len = peer.read(rbuf);
         fprintf(stderr, "input length: %d\n", len);
@@ -98,4 +98,259 @@ TEST_F(TcpStreamTest, read_write) {
   EXPECT_EQ(response, upper_str(msg));
 
   client_poller->deregister_evt(client);
-};
\ No newline at end of file
+};
+
+TEST(TcpWriteQueueTest, watermarks) {
+  auto poller = Poller::new_instance();
+  TcpListener listener = TcpListener::bind(AddrV4::from("127.0.0.1:0"), 16);
+  Addr addr;
+  listener.local_addr(addr);
+  TcpStream client = TcpStream::connect(addr);
+
+  vector<Event> events(4);
+  Duration timeout(1000);
+  poller->register_evt(listener, Token(1), Ready::readable(),
+                       PollOpt::level());
+  ASSERT_EQ(poller->poll(events, &timeout), 1);
+  poller->deregister_evt(listener);
+  TcpStream server = listener.accept();
+
+  // a small socket buffer, so the queue fills up quickly.
+  int bufsize = 4096;
+  setsockopt(client.fd(), SOL_SOCKET, SO_SNDBUF, &bufsize, sizeof(bufsize));
+
+  vector<bool> crossings;
+  client.set_write_watermarks(8 * 1024, 32 * 1024);
+  client.set_watermark_callback(
+      [&](TcpStream &, bool blocked) { crossings.push_back(blocked); });
+  poller->register_evt(client, Token(2), Ready::readable(), PollOpt::level());
+
+  string chunk(4096, 'x');
+  size_t sent = 0;
+  bool writable = true;
+  while (writable) {
+    writable = client.send(chunk);
+    sent += chunk.size();
+  }
+  EXPECT_TRUE(client.is_write_blocked());
+  EXPECT_GE(client.queued_bytes(), 32 * 1024);
+  EXPECT_EQ(crossings, vector<bool>{true});
+
+  // the consumer catches up, the queue is drained on writable events.
+  ByteBuffer rbuf;
+  size_t received = 0;
+  Duration tick(10);
+  while (received < sent) {
+    ssize_t n;
+    while ((n = server.read(rbuf)) > 0) {
+      received += n;
+      rbuf.clear();
+    }
+    int m = poller->poll(events, &tick);
+    for (int i = 0; i < m; ++i) {
+      if (events[i].token() == Token(2) &&
+          events[i].readiness().is_writable()) {
+        ASSERT_NE(client.flush(), -1);
+      }
+    }
+  }
+  EXPECT_EQ(received, sent);
+  EXPECT_EQ(client.queued_bytes(), 0);
+  EXPECT_FALSE(client.is_write_blocked());
+  EXPECT_EQ(crossings, (vector<bool>{true, false}));
+
+  // the writable interest is dropped once the queue is empty.
+  EXPECT_EQ(poller->poll(events, &tick), 0);
+}
+
+TEST(TcpWriteQueueTest, peer_reset) {
+  TcpListener listener = TcpListener::bind(AddrV4::from("127.0.0.1:0"), 16);
+  Addr addr;
+  listener.local_addr(addr);
+  TcpStream client = TcpStream::connect(addr);
+  this_thread::sleep_for(chrono::milliseconds(10));
+  {
+    // close with a RST.
+    TcpStream server = listener.accept();
+    struct linger lg = {1, 0};
+    setsockopt(server.fd(), SOL_SOCKET, SO_LINGER, &lg, sizeof(lg));
+  }
+  this_thread::sleep_for(chrono::milliseconds(10));
+
+  // no SIGPIPE, the queue fails and keeps the error.
+  bool ok = true;
+  for (int i = 0; i < 10 && ok; ++i) {
+    ByteBuffer buf;
+    buf.put_string(string(1024, 'x'));
+    ok = client.send(buf);
+  }
+  EXPECT_FALSE(ok);
+  EXPECT_TRUE(client.send_error() == EPIPE ||
+              client.send_error() == ECONNRESET);
+  EXPECT_EQ(client.queued_bytes(), 0u);
+  errno = 0;
+  EXPECT_FALSE(client.send("more"));
+  EXPECT_EQ(errno, client.send_error());
+}
+
+TEST(TcpReadBudgetTest, fair_reading) {
+  auto poller = Poller::new_instance();
+  TcpListener listener = TcpListener::bind(AddrV4::from("127.0.0.1:0"), 16);
+  Addr addr;
+  listener.local_addr(addr);
+  TcpStream client = TcpStream::connect(addr);
+
+  vector<Event> events(4);
+  Duration timeout(1000);
+  poller->register_evt(listener, Token(1), Ready::readable(),
+                       PollOpt::level());
+  ASSERT_EQ(poller->poll(events, &timeout), 1);
+  poller->deregister_evt(listener);
+  TcpStream server = listener.accept();
+  server.set_read_budget(16 * 1024, 100);
+  poller->register_evt(server, Token(5), Ready::readable(), PollOpt::edge());
+
+  const size_t total = 256 * 1024;
+  client.send(string(total, 'b'));
+
+  ByteBuffer rbuf;
+  size_t received = 0;
+  int reads = 0, requeued = 0;
+  vector<Event> user_events;
+  while (received < total) {
+    client.flush();
+    int n = poller->poll(events, &timeout);
+    ASSERT_GT(n, 0);
+    for (int i = 0; i < n; ++i) {
+      user_events.clear();
+      if (events[i].token() == Token(0)) {
+        poller->user_poll(user_events);
+        requeued += static_cast<int>(user_events.size());
+      } else {
+        user_events.push_back(events[i]);
+      }
+      for (auto &evt : user_events) {
+        ASSERT_EQ(evt.token(), Token(5));
+        ASSERT_TRUE(evt.readiness().is_readable());
+        ssize_t len = server.read_some(rbuf);
+        if (len > 0) {
+          EXPECT_LE(len, 16 * 1024);
+          received += len;
+          ++reads;
+        }
+        rbuf.clear();
+      }
+    }
+  }
+  EXPECT_EQ(received, total);
+  EXPECT_GE(reads, 16);
+  // the stream was reported again through the readiness queue.
+  EXPECT_GT(requeued, 0);
+  // bulk reads grow the read size.
+  EXPECT_GT(server.read_size_hint(), TcpStream::InitialReadSize);
+}
+
+TEST(TcpStatsTest, counters) {
+  TcpListener listener = TcpListener::bind(AddrV4::from("127.0.0.1:0"), 16);
+  Addr addr;
+  listener.local_addr(addr);
+  TcpStream client = TcpStream::connect(addr);
+  TcpStream server = TcpStream::from_fd(-1);
+  while (server.fd() == -1) {
+    TcpStream s = listener.accept();
+    server.swap(s);
+  }
+  EXPECT_EQ(server.stats(), nullptr);
+  server.enable_stats(true);
+  client.enable_stats(true);
+
+  // nothing to read yet.
+  ByteBuffer rbuf;
+  EXPECT_EQ(server.read(rbuf), -1);
+  const TcpStreamStats *ss = server.stats();
+  ASSERT_NE(ss, nullptr);
+  EXPECT_EQ(ss->read_calls, 1u);
+  EXPECT_EQ(ss->read_eagain, 1u);
+  EXPECT_FALSE(ss->has_first_byte());
+
+  client.send(string(1000, 'a'));
+  const TcpStreamStats *cs = client.stats();
+  EXPECT_EQ(cs->bytes_out, 1000u);
+  EXPECT_EQ(cs->write_calls, 1u);
+  EXPECT_EQ(cs->partial_writes, 0u);
+
+  size_t received = 0;
+  while (received < 1000) {
+    ssize_t n = server.read(rbuf);
+    if (n > 0)
+      received += n;
+  }
+  EXPECT_EQ(ss->bytes_in, 1000u);
+  EXPECT_EQ(ss->inbuf_high_water, 1000u);
+  EXPECT_TRUE(ss->has_first_byte());
+  EXPECT_GE(ss->time_to_first_byte().count(), 0);
+
+  TcpInfo info;
+  client.tcp_info(info);
+  EXPECT_GT(info.snd_mss, 0u);
+  EXPECT_GT(info.snd_cwnd, 0u);
+
+  // stats follow the stream when it's moved.
+  TcpStream moved(std::move(server));
+  EXPECT_EQ(moved.stats(), ss);
+  moved.enable_stats(false);
+  EXPECT_EQ(moved.stats(), nullptr);
+}
+
+TEST(TcpErrorCodeTest, no_throw) {
+  auto poller = Poller::new_instance();
+  TcpListener listener = TcpListener::bind(AddrV4::from("127.0.0.1:0"), 16);
+  Addr addr;
+  error_code ec;
+  listener.local_addr(addr, ec);
+  ASSERT_FALSE(ec);
+
+  // nothing to accept.
+  TcpStream none = listener.accept(ec);
+  EXPECT_EQ(ec, errc::resource_unavailable_try_again);
+  EXPECT_EQ(none.fd(), -1);
+
+  TcpStream client = TcpStream::connect(addr, ec);
+  ASSERT_FALSE(ec);
+  Addr peer;
+  TcpStream server = listener.accept(ec, &peer);
+  ASSERT_FALSE(ec);
+  EXPECT_NE(server.fd(), -1);
+
+  server.set_nodelay(true, ec);
+  EXPECT_FALSE(ec);
+  EXPECT_TRUE(server.nodelay(ec));
+  EXPECT_FALSE(ec);
+
+  poller->register_evt(server, Token(1), Ready::readable(), PollOpt::edge(),
+                       ec);
+  EXPECT_FALSE(ec);
+  poller->register_evt(server, Token(1), Ready::readable(), PollOpt::edge(),
+                       ec);
+  EXPECT_EQ(ec, errc::file_exists);
+  poller->deregister_evt(server, ec);
+  EXPECT_FALSE(ec);
+  poller->deregister_evt(server, ec);
+  EXPECT_EQ(ec, errc::no_such_file_or_directory);
+
+  // a closed port refuses the connection.
+  Addr closed;
+  {
+    TcpListener gone = TcpListener::bind(AddrV4::from("127.0.0.1:0"), 1);
+    gone.local_addr(closed);
+  }
+  TcpStream refused = TcpStream::connect(closed, ec);
+  EXPECT_EQ(ec, errc::connection_refused);
+  EXPECT_EQ(refused.fd(), -1);
+  EXPECT_THROW(TcpStream::connect(closed), connecting_failed);
+
+  vector<Event> events(4);
+  Duration timeout(0);
+  EXPECT_EQ(poller->poll(events, ec, &timeout), 0);
+  EXPECT_FALSE(ec);
+}
@@ -0,0 +1,144 @@
+//
+// Created by byao on 1/28/18.
+// Copyright (c) 2018 byao. All rights reserved.
+//
+
+#include "../src/executor.hpp"
+#include "../src/poller_epoll.hpp"
+#include "../src/thread_pool.hpp"
+#include "../src/ws_deque.hpp"
+#include <atomic>
+#include <chrono>
+#include <gtest/gtest.h>
+#include <thread>
+#include <vector>
+
+using namespace std;
+using namespace bsnet;
+
+TEST(WsDequeTest, owner) {
+  ws_deque_t<int> dq(4);
+  for (int i = 0; i < 100; ++i)
+    dq.push(i);
+  EXPECT_EQ(dq.size(), 100);
+
+  int v;
+  ASSERT_TRUE(dq.steal(v));
+  EXPECT_EQ(v, 0);
+  ASSERT_TRUE(dq.take(v));
+  EXPECT_EQ(v, 99);
+  for (int i = 98; i > 0; --i) {
+    ASSERT_TRUE(dq.take(v));
+    EXPECT_EQ(v, i);
+  }
+  EXPECT_FALSE(dq.take(v));
+  EXPECT_FALSE(dq.steal(v));
+}
+
+TEST(WsDequeTest, thieves) {
+  constexpr int N = 200000, Thieves = 3;
+  ws_deque_t<int> dq(16);
+  vector<atomic<int>> seen(N);
+  atomic<bool> done{false};
+
+  vector<thread> thieves;
+  for (int i = 0; i < Thieves; ++i) {
+    thieves.emplace_back([&] {
+      int v;
+      while (!done.load()) {
+        if (dq.steal(v))
+          seen[v].fetch_add(1);
+      }
+    });
+  }
+
+  int v;
+  for (int i = 0; i < N; ++i) {
+    dq.push(i);
+    if (i % 3 == 0 && dq.take(v))
+      seen[v].fetch_add(1);
+  }
+  while (dq.take(v))
+    seen[v].fetch_add(1);
+  done = true;
+  for (auto &th : thieves)
+    th.join();
+
+  for (int i = 0; i < N; ++i)
+    ASSERT_EQ(seen[i].load(), 1) << i;
+}
+
+static void wait_for(const atomic<int> &count, int n) {
+  auto deadline = chrono::steady_clock::now() + chrono::seconds(10);
+  while (count.load() < n && chrono::steady_clock::now() < deadline)
+    this_thread::sleep_for(chrono::milliseconds(1));
+}
+
+TEST(ThreadPoolTest, submit) {
+  ThreadPool pool(4);
+  atomic<int> count{0};
+  for (int i = 0; i < 100000; ++i)
+    pool.submit([&count] { count.fetch_add(1); });
+  wait_for(count, 100000);
+  EXPECT_EQ(count.load(), 100000);
+}
+
+static void spawn(ThreadPool &pool, atomic<int> &count, int depth) {
+  count.fetch_add(1);
+  if (depth == 0)
+    return;
+  for (int i = 0; i < 2; ++i)
+    pool.submit([&pool, &count, depth] { spawn(pool, count, depth - 1); });
+}
+
+TEST(ThreadPoolTest, nested) {
+  // tasks submitted by workers go to their own deques, and are stolen.
+  ThreadPool pool(4);
+  atomic<int> count{0};
+  pool.submit([&] { spawn(pool, count, 15); });
+  wait_for(count, (1 << 16) - 1);
+  EXPECT_EQ(count.load(), (1 << 16) - 1);
+}
+
+TEST(ThreadPoolTest, complete_on_poller) {
+  auto poller = Poller::new_instance();
+  ThreadPool pool(2);
+  thread::id poller_thread = this_thread::get_id();
+
+  int sum = 0, voids = 0;
+  bool on_poller = true;
+  for (int i = 1; i <= 100; ++i) {
+    pool.submit(poller->executor(), [i] { return i; }, [&](int r) {
+      sum += r;
+      on_poller = on_poller && this_thread::get_id() == poller_thread;
+    });
+  }
+  pool.submit(poller->executor(), [] {}, [&] { ++voids; });
+
+  vector<Event> events(8);
+  auto deadline = chrono::steady_clock::now() + chrono::seconds(10);
+  while ((sum < 5050 || voids < 1) && chrono::steady_clock::now() < deadline) {
+    Duration timeout(100);
+    int n = poller->poll(events, &timeout);
+    for (int i = 0; i < n; ++i) {
+      vector<Event> user;
+      if (events[i].token() == Token(0))
+        poller->user_poll(user);
+    }
+  }
+  EXPECT_EQ(sum, 5050);
+  EXPECT_EQ(voids, 1);
+  EXPECT_TRUE(on_poller);
+}
+
+TEST(ThreadPoolTest, idle) {
+  // workers park, and wake up for new work.
+  ThreadPool pool(4);
+  atomic<int> count{0};
+  for (int round = 1; round <= 5; ++round) {
+    this_thread::sleep_for(chrono::milliseconds(20));
+    pool.submit([&count] { count.fetch_add(1); });
+    wait_for(count, round);
+    EXPECT_EQ(count.load(), round);
+  }
+}
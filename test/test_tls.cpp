@@ -0,0 +1,320 @@
+//
+// Created by byao on 2/16/18.
+// Copyright (c) 2018 byao. All rights reserved.
+//
+
+#include "../src/address.hpp"
+#include "../src/bytebuffer.hpp"
+#include "../src/neterr.hpp"
+#include "../src/tcp_listener.hpp"
+#include "../src/tcp_stream.hpp"
+#include "../src/tls_stream.hpp"
+#include <chrono>
+#include <cstdlib>
+#include <gtest/gtest.h>
+#include <openssl/ec.h>
+#include <openssl/evp.h>
+#include <openssl/pem.h>
+#include <openssl/x509v3.h>
+#include <string>
+#include <thread>
+#include <unistd.h>
+
+using namespace std;
+using namespace bsnet;
+
+namespace {
+
+struct Cert {
+  string cert_pem;
+  string key_pem;
+};
+
+string bio_string(BIO *bio) {
+  char *data;
+  long len = BIO_get_mem_data(bio, &data);
+  string s(data, static_cast<size_t>(len));
+  BIO_free(bio);
+  return s;
+}
+
+// a self-signed certificate of 'localhost', in memory.
+Cert self_signed() {
+  EVP_PKEY *key = nullptr;
+  EVP_PKEY_CTX *kctx = EVP_PKEY_CTX_new_id(EVP_PKEY_EC, nullptr);
+  EVP_PKEY_keygen_init(kctx);
+  EVP_PKEY_CTX_set_ec_paramgen_curve_nid(kctx, NID_X9_62_prime256v1);
+  EVP_PKEY_keygen(kctx, &key);
+  EVP_PKEY_CTX_free(kctx);
+  X509 *x = X509_new();
+  X509_set_version(x, 2);
+  ASN1_INTEGER_set(X509_get_serialNumber(x), 1);
+  X509_gmtime_adj(X509_getm_notBefore(x), -60);
+  X509_gmtime_adj(X509_getm_notAfter(x), 3600);
+  X509_set_pubkey(x, key);
+  X509_NAME *name = X509_get_subject_name(x);
+  X509_NAME_add_entry_by_txt(
+      name, "CN", MBSTRING_ASC,
+      reinterpret_cast<const unsigned char *>("localhost"), -1, -1, 0);
+  X509_set_issuer_name(x, name);
+  X509V3_CTX ctx;
+  X509V3_set_ctx_nodb(&ctx);
+  X509V3_set_ctx(&ctx, x, x, nullptr, nullptr, 0);
+  X509_EXTENSION *ext =
+      X509V3_EXT_conf_nid(nullptr, &ctx, NID_subject_alt_name, "DNS:localhost");
+  X509_add_ext(x, ext, -1);
+  X509_EXTENSION_free(ext);
+  X509_sign(x, key, EVP_sha256());
+
+  Cert cert;
+  BIO *bio = BIO_new(BIO_s_mem());
+  PEM_write_bio_X509(bio, x);
+  cert.cert_pem = bio_string(bio);
+  bio = BIO_new(BIO_s_mem());
+  PEM_write_bio_PrivateKey(bio, key, nullptr, nullptr, 0, nullptr, nullptr);
+  cert.key_pem = bio_string(bio);
+  X509_free(x);
+  EVP_PKEY_free(key);
+  return cert;
+}
+
+const Cert &test_cert() {
+  static Cert cert = self_signed();
+  return cert;
+}
+
+struct TlsTest : ::testing::Test {
+  TlsTest()
+      : listener(TcpListener::bind(AddrV4::from("127.0.0.1:0"), 16)),
+        server_ctx(TlsContext::server(test_cert().cert_pem,
+                                      test_cert().key_pem)),
+        client_ctx(TlsContext::client()) {
+    listener.local_addr(addr);
+    client_ctx.add_ca(test_cert().cert_pem);
+  }
+
+  // a connected pair of tcp streams.
+  pair<TcpStream, TcpStream> connect() {
+    TcpStream client = TcpStream::connect(addr);
+    TcpStream server = listener.accept();
+    return make_pair(std::move(client), std::move(server));
+  }
+
+  // drive both sides, as their readiness events would.
+  static void handshake(TlsStream &a, TlsStream &b) {
+    for (int i = 0; i < 2000; ++i) {
+      bool done = a.handshake();
+      done = b.handshake() && done;
+      if (done)
+        return;
+      this_thread::sleep_for(chrono::milliseconds(1));
+    }
+    FAIL() << "handshake timed out";
+  }
+
+  // read 'n' bytes from 'from', flushing 'to' meanwhile.
+  static string transfer(TlsStream &to, TlsStream &from, size_t n) {
+    ByteBuffer buf;
+    auto deadline = chrono::steady_clock::now() + chrono::seconds(10);
+    while (static_cast<size_t>(buf.readable_bytes()) < n &&
+           chrono::steady_clock::now() < deadline) {
+      to.flush();
+      if (from.read(buf) == 0)
+        break;
+    }
+    return buf.take_string();
+  }
+
+  TcpListener listener;
+  Addr addr;
+  TlsContext server_ctx;
+  TlsContext client_ctx;
+};
+
+} // namespace
+
+TEST_F(TlsTest, echo) {
+  auto tcp = connect();
+  TlsStream client = TlsStream::client(std::move(tcp.first), client_ctx,
+                                       "localhost");
+  TlsStream server = TlsStream::server(std::move(tcp.second), server_ctx);
+  EXPECT_FALSE(client.is_established());
+
+  // queued until the handshake completes.
+  client.send("early");
+  handshake(client, server);
+  EXPECT_STREQ(client.version(), "TLSv1.3");
+  EXPECT_FALSE(client.session_reused());
+  EXPECT_EQ(transfer(client, server, 5), "early");
+
+  client.send("Hello, World!");
+  EXPECT_EQ(transfer(client, server, 13), "Hello, World!");
+  server.send("Bye");
+  EXPECT_EQ(transfer(server, client, 3), "Bye");
+
+  // a bulk transfer, larger than the socket buffers.
+  string bulk(4 * 1024 * 1024, '\0');
+  for (size_t i = 0; i < bulk.size(); ++i)
+    bulk[i] = static_cast<char>(i * 31);
+  server.send(bulk);
+  string got = transfer(server, client, bulk.size());
+  EXPECT_EQ(got.size(), bulk.size());
+  EXPECT_TRUE(got == bulk);
+
+  client.shutdown();
+  client.flush();
+  EXPECT_FALSE(client.send("late"));
+  EXPECT_EQ(errno, EPROTO);
+  EXPECT_EQ(client.send_error(), EPROTO);
+  ByteBuffer buf;
+  ssize_t n = -1;
+  for (int i = 0; i < 1000 && n != 0; ++i)
+    n = server.read(buf);
+  EXPECT_EQ(n, 0);
+}
+
+TEST_F(TlsTest, truncation) {
+  auto tcp = connect();
+  TlsStream client = TlsStream::client(std::move(tcp.first), client_ctx,
+                                       "localhost");
+  TlsStream server = TlsStream::server(std::move(tcp.second), server_ctx);
+  handshake(client, server);
+  server.send("partial");
+  EXPECT_EQ(transfer(server, client, 7), "partial");
+
+  // a FIN without close_notify is not the end of stream.
+  server.tcp().shutdown(Shutdown::Write);
+  ByteBuffer buf;
+  ssize_t n = 0;
+  for (int i = 0; i < 1000; ++i) {
+    n = client.read(buf);
+    if (n != -1 || errno != EAGAIN)
+      break;
+    this_thread::sleep_for(chrono::milliseconds(1));
+  }
+  EXPECT_EQ(n, -1);
+  EXPECT_EQ(errno, ECONNRESET);
+}
+
+TEST_F(TlsTest, verify_failure) {
+  // nothing trusts the certificate.
+  auto tcp = connect();
+  TlsStream client = TlsStream::client(std::move(tcp.first),
+                                       TlsContext::client(), "localhost");
+  TlsStream server = TlsStream::server(std::move(tcp.second), server_ctx);
+  EXPECT_THROW(
+      {
+        for (int i = 0; i < 2000; ++i) {
+          client.handshake();
+          try {
+            server.handshake();
+          } catch (tls_error &) {
+          }
+          this_thread::sleep_for(chrono::milliseconds(1));
+        }
+      },
+      tls_error);
+
+  // trusted, but of another name.
+  auto tcp2 = connect();
+  TlsStream other = TlsStream::client(std::move(tcp2.first), client_ctx,
+                                      "example.com");
+  TlsStream server2 = TlsStream::server(std::move(tcp2.second), server_ctx);
+  EXPECT_THROW(
+      {
+        for (int i = 0; i < 2000; ++i) {
+          other.handshake();
+          try {
+            server2.handshake();
+          } catch (tls_error &) {
+          }
+          this_thread::sleep_for(chrono::milliseconds(1));
+        }
+      },
+      tls_error);
+}
+
+TEST_F(TlsTest, session_resumption) {
+  for (int round = 0; round < 2; ++round) {
+    auto tcp = connect();
+    TlsStream client = TlsStream::client(std::move(tcp.first), client_ctx,
+                                         "localhost", "localhost:test");
+    TlsStream server = TlsStream::server(std::move(tcp.second), server_ctx);
+    handshake(client, server);
+    EXPECT_EQ(client.session_reused(), round == 1);
+    EXPECT_EQ(server.session_reused(), round == 1);
+    // the client gets the session tickets of TLS 1.3 with the data.
+    server.send("ping");
+    EXPECT_EQ(transfer(server, client, 4), "ping");
+    EXPECT_GE(client_ctx.cached_sessions(), 1u);
+    // a session is resumable after a clean shutdown only.
+    client.shutdown();
+    client.flush();
+  }
+
+  client_ctx.set_session_cache_size(0);
+  EXPECT_EQ(client_ctx.cached_sessions(), 0u);
+}
+
+TEST_F(TlsTest, sendfile) {
+  // kTLS if the kernel has it, the same results otherwise.
+  server_ctx.set_ktls(true);
+  client_ctx.set_ktls(true);
+
+  char path[] = "/tmp/bsnet_tls_XXXXXX";
+  int fd = mkstemp(path);
+  ASSERT_NE(fd, -1);
+  unlink(path);
+  string content(300 * 1024 + 7, '\0');
+  for (size_t i = 0; i < content.size(); ++i)
+    content[i] = static_cast<char>(i * 7 + 3);
+  ASSERT_EQ(write(fd, content.data(), content.size()),
+            static_cast<ssize_t>(content.size()));
+
+  auto tcp = connect();
+  TlsStream client = TlsStream::client(std::move(tcp.first), client_ctx,
+                                       "localhost");
+  TlsStream server = TlsStream::server(std::move(tcp.second), server_ctx);
+  handshake(client, server);
+  RecordProperty("ktls_send", server.ktls_send());
+
+  // small socket buffers, so the sender blocks until the client reads.
+  int size = 16 * 1024;
+  setsockopt(server.tcp().fd(), SOL_SOCKET, SO_SNDBUF, &size, sizeof(size));
+  setsockopt(client.tcp().fd(), SOL_SOCKET, SO_RCVBUF, &size, sizeof(size));
+  const size_t high = 32 * 1024;
+  server.tcp().set_write_watermarks(16 * 1024, high);
+
+  server.send("file:");
+  off_t offset = 100;
+  size_t left = content.size() - 100;
+  size_t total = left + 5;
+  size_t max_queued = 0;
+  int blocked = 0;
+  ByteBuffer buf;
+  auto deadline = chrono::steady_clock::now() + chrono::seconds(10);
+  while (static_cast<size_t>(buf.readable_bytes()) < total &&
+         chrono::steady_clock::now() < deadline) {
+    if (left > 0) {
+      ssize_t n = server.sendfile(fd, &offset, left);
+      max_queued = std::max(max_queued, server.tcp().queued_bytes());
+      if (n > 0) {
+        left -= static_cast<size_t>(n);
+        continue;
+      }
+      ASSERT_EQ(errno, EAGAIN);
+      ++blocked;
+    }
+    server.flush();
+    client.read(buf);
+  }
+  EXPECT_EQ(left, 0u);
+  EXPECT_GT(blocked, 0);
+  // one chunk, and its records, above the high watermark at most.
+  EXPECT_LE(max_queued, high + 64 * 1024 + 4 * 1024);
+  EXPECT_EQ(offset, static_cast<off_t>(content.size()));
+  string got = buf.take_string();
+  EXPECT_EQ(got.size(), content.size() - 95);
+  EXPECT_TRUE(got == "file:" + content.substr(100));
+  close(fd);
+}
@@ -14,11 +14,11 @@ using namespace bsnet;
 TEST(TokenTest, token_alloc) {
 
   uint32_t size = 1000;
-  TokenPool pool(size);
+  TokenPool pool(size, size);
   vector<Token> tokens;
   for (int i = 0; i < 1024; ++i) {
     Token tok = pool.alloc_token();
-    EXPECT_EQ(static_cast<uint64_t>(tok), i);
+    EXPECT_EQ(tok.index(), i);
     tokens.push_back(tok);
   }
   EXPECT_THROW(pool.alloc_token(), token_exhuasted);
@@ -26,6 +26,54 @@ TEST(TokenTest, token_alloc) {
   for (int i = 0; i < 1024; ++i) {
     pool.free_token(tokens[i]);
   }
+  EXPECT_EQ(pool.size(), 0);
+}
+
+TEST(TokenTest, token_grow) {
+  TokenPool pool(64);
+  for (uint64_t i = 0; i < 5000; ++i)
+    EXPECT_EQ(pool.alloc_token().index(), i);
+  EXPECT_EQ(pool.size(), 5000);
+  EXPECT_EQ(pool.capacity(), 8192);
+}
+
+TEST(TokenTest, lowest_free) {
+  TokenPool pool(5000);
+  vector<Token> tokens;
+  for (int i = 0; i < 5000; ++i)
+    tokens.push_back(pool.alloc_token());
+
+  pool.free_token(tokens[4097]);
+  pool.free_token(tokens[130]);
+  pool.free_token(tokens[63]);
+  EXPECT_EQ(pool.alloc_token().index(), 63);
+  EXPECT_EQ(pool.alloc_token().index(), 130);
+  EXPECT_EQ(pool.alloc_token().index(), 4097);
+  EXPECT_EQ(pool.alloc_token().index(), 5000);
+}
+
+TEST(TokenTest, generation) {
+  TokenPool pool(64);
+  Token old = pool.alloc_token();
+  EXPECT_NE(static_cast<uint64_t>(old), 0);
+  EXPECT_TRUE(pool.valid(old));
+  EXPECT_TRUE(pool.free_token(old));
+  EXPECT_FALSE(pool.valid(old));
+
+  // the slot is reused, but the stale token doesn't match the new owner.
+  Token tok = pool.alloc_token();
+  EXPECT_EQ(tok.index(), old.index());
+  EXPECT_NE(tok, old);
+  EXPECT_TRUE(pool.valid(tok));
+  EXPECT_FALSE(pool.valid(old));
+  EXPECT_FALSE(pool.free_token(old));
+  EXPECT_TRUE(pool.valid(tok));
+
+  // round trip through the raw value carried by events.
+  Token raw(static_cast<uint64_t>(tok));
+  EXPECT_EQ(raw, tok);
+  EXPECT_TRUE(pool.valid(raw));
+  EXPECT_FALSE(pool.valid(Token(static_cast<uint64_t>(1) << 32 | 63)));
 }
 
 TEST(TokenTest, random_taken) {
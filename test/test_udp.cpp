@@ -0,0 +1,131 @@
+//
+// Created by byao on 1/8/18.
+// Copyright (c) 2018 byao. All rights reserved.
+//
+#include "../src/address.hpp"
+#include "../src/bytebuffer.hpp"
+#include "../src/neterr.hpp"
+#include "../src/poller_epoll.hpp"
+#include "../src/udp_socket.hpp"
+#include "gtest/gtest.h"
+#include <cerrno>
+#include <string>
+#include <vector>
+
+using namespace std;
+using namespace bsnet;
+
+struct UdpSocketTest : ::testing::Test {
+  UdpSocketTest()
+      : server(UdpSocket::bind(AddrV4::from("127.0.0.1:0"))),
+        client(UdpSocket::bind(AddrV4::from("127.0.0.1:0"))),
+        poller(Poller::new_instance()) {
+    server.local_addr(server_addr);
+    poller->register_evt(server, Token(1), Ready::readable(), PollOpt::level());
+  }
+
+  bool wait_readable() {
+    vector<Event> events(1);
+    Duration timeout(1000);
+    return poller->poll(events, &timeout) == 1;
+  }
+
+  UdpSocket server;
+  UdpSocket client;
+  Guard<Poller> poller;
+  Addr server_addr;
+};
+
+TEST_F(UdpSocketTest, send_recv) {
+  ByteBuffer wbuf, rbuf;
+  wbuf.put_string("hello, world!");
+  EXPECT_EQ(client.send_to(wbuf, server_addr), 13);
+  EXPECT_EQ(wbuf.readable_bytes(), 0);
+
+  ASSERT_TRUE(wait_readable());
+  Addr peer, client_addr;
+  uint16_t segment = 0;
+  EXPECT_EQ(server.recv_from(rbuf, &peer, &segment), 13);
+  EXPECT_EQ(segment, 13);
+  EXPECT_EQ(rbuf.take_string(), "hello, world!");
+
+  client.local_addr(client_addr);
+  ASSERT_TRUE(peer.is_ipv4());
+  EXPECT_EQ(memcmp(peer.get_sockaddr(), client_addr.get_sockaddr(),
+                   peer.size()),
+            0);
+}
+
+TEST_F(UdpSocketTest, segmentation_offload) {
+  ByteBuffer wbuf, rbuf;
+  string payload;
+  for (int i = 0; i < 3; ++i)
+    payload.append(1000, static_cast<char>('a' + i));
+  payload.append(500, 'd');
+  wbuf.put_string(payload);
+
+  client.connect(server_addr);
+  ssize_t n = client.send_segments(wbuf, 1000);
+  if (n == -1 && (errno == EIO || errno == EINVAL || errno == ENOPROTOOPT))
+    GTEST_SKIP() << "UDP_SEGMENT is not supported: " << strerror(errno);
+  ASSERT_EQ(n, 3500);
+
+  // without GRO, the receiver sees every single segment.
+  for (int i = 0; i < 4; ++i) {
+    ASSERT_TRUE(wait_readable());
+    uint16_t segment = 0;
+    ssize_t len = server.recv(rbuf, &segment);
+    EXPECT_EQ(len, i < 3 ? 1000 : 500);
+    EXPECT_EQ(segment, len);
+  }
+  EXPECT_EQ(rbuf.take_string(), payload);
+}
+
+TEST_F(UdpSocketTest, receive_offload) {
+  try {
+    server.set_gro(true);
+  } catch (udp_error &) {
+    GTEST_SKIP() << "UDP_GRO is not supported";
+  }
+  EXPECT_TRUE(server.gro());
+
+  ByteBuffer wbuf, rbuf;
+  string payload(4000, 'x');
+  wbuf.put_string(payload);
+  client.connect(server_addr);
+  ssize_t n = client.send_segments(wbuf, 1000);
+  if (n == -1)
+    GTEST_SKIP() << "UDP_SEGMENT is not supported: " << strerror(errno);
+  ASSERT_EQ(n, 4000);
+
+  // datagrams may or may not be coalesced, but the segment size is always
+  // reported.
+  ssize_t total = 0;
+  while (total < 4000) {
+    ASSERT_TRUE(wait_readable());
+    uint16_t segment = 0;
+    ssize_t len = server.recv(rbuf, &segment);
+    ASSERT_GT(len, 0);
+    EXPECT_EQ(segment, 1000);
+    EXPECT_EQ(len % segment, 0);
+    total += len;
+  }
+  EXPECT_EQ(rbuf.take_string(), payload);
+}
+
+TEST_F(UdpSocketTest, socket_segment_size) {
+  try {
+    client.set_segment_size(500);
+  } catch (udp_error &) {
+    GTEST_SKIP() << "UDP_SEGMENT is not supported";
+  }
+  EXPECT_EQ(client.segment_size(), 500);
+
+  ByteBuffer wbuf, rbuf;
+  wbuf.put_string(string(1000, 'y'));
+  EXPECT_EQ(client.send_to(wbuf, server_addr), 1000);
+  for (int i = 0; i < 2; ++i) {
+    ASSERT_TRUE(wait_readable());
+    EXPECT_EQ(server.recv(rbuf), 500);
+  }
+}
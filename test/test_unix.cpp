@@ -0,0 +1,150 @@
+//
+// Created by byao on 1/13/18.
+// Copyright (c) 2018 byao. All rights reserved.
+//
+#include "../src/address.hpp"
+#include "../src/bytebuffer.hpp"
+#include "../src/fd_passing.hpp"
+#include "../src/poller_epoll.hpp"
+#include "../src/unix_datagram.hpp"
+#include "../src/unix_listener.hpp"
+#include "../src/unix_stream.hpp"
+#include "gtest/gtest.h"
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+using namespace std;
+using namespace bsnet;
+
+static bool wait_readable(Poller &poller, Evented &ev) {
+  vector<Event> events(1);
+  Duration timeout(1000);
+  poller.register_evt(ev, Token(1), Ready::readable(), PollOpt::oneshot());
+  int n = poller.poll(events, &timeout);
+  poller.deregister_evt(ev);
+  return n == 1;
+}
+
+TEST(UnixTest, listener_stream) {
+  auto poller = Poller::new_instance();
+  AddrUnix addr = AddrUnix::abstract("bsnet-test-" + to_string(::getpid()));
+  UnixListener listener = UnixListener::bind(addr, 16);
+  AddrUnix local;
+  listener.local_addr(local);
+  EXPECT_TRUE(local.is_abstract());
+  EXPECT_EQ(local.path(), addr.path());
+
+  UnixStream client = UnixStream::connect(addr);
+  ASSERT_TRUE(wait_readable(*poller, listener));
+  AddrUnix peer;
+  UnixStream server = listener.accept(&peer);
+  EXPECT_GT(server.fd(), 0);
+  EXPECT_TRUE(peer.is_unnamed());
+
+  ByteBuffer wbuf, rbuf;
+  wbuf.put_string("hello, unix");
+  EXPECT_EQ(client.write(wbuf), 11);
+  ASSERT_TRUE(wait_readable(*poller, server));
+  EXPECT_EQ(server.read(rbuf), 11);
+  EXPECT_EQ(rbuf.take_string(), "hello, unix");
+}
+
+TEST(UnixTest, datagram) {
+  auto poller = Poller::new_instance();
+  AddrUnix addr = AddrUnix::abstract("bsnet-dgram-" + to_string(::getpid()));
+  UnixDatagram server = UnixDatagram::bind(addr);
+  UnixDatagram client = UnixDatagram::unbound();
+
+  ByteBuffer wbuf, rbuf;
+  wbuf.put_string("first");
+  EXPECT_EQ(client.send_to(wbuf, addr), 5);
+  wbuf.put_string("second");
+  EXPECT_EQ(client.send_to(wbuf, addr), 6);
+
+  ASSERT_TRUE(wait_readable(*poller, server));
+  AddrUnix peer;
+  EXPECT_EQ(server.recv_from(rbuf, &peer), 5);
+  EXPECT_TRUE(peer.is_unnamed());
+  EXPECT_EQ(server.recv(rbuf), 6);
+  EXPECT_EQ(rbuf.take_string(), "firstsecond");
+}
+
+TEST(UnixTest, pass_fds) {
+  auto poller = Poller::new_instance();
+  auto streams = UnixStream::pair();
+  int pipefd[2];
+  ASSERT_EQ(::pipe(pipefd), 0);
+
+  // hand the write end of the pipe to the other side.
+  ByteBuffer wbuf, rbuf;
+  wbuf.put_string("fd");
+  EXPECT_EQ(streams.first.send_fds(wbuf, &pipefd[1], 1), 2);
+  ::close(pipefd[1]);
+
+  vector<int> fds;
+  ASSERT_TRUE(wait_readable(*poller, streams.second));
+  EXPECT_EQ(streams.second.recv_fds(rbuf, fds), 2);
+  EXPECT_EQ(rbuf.take_string(), "fd");
+  ASSERT_EQ(fds.size(), 1);
+
+  // the received descriptor refers to the same pipe.
+  ASSERT_EQ(::write(fds[0], "pipe", 4), 4);
+  ::close(fds[0]);
+  char data[8];
+  EXPECT_EQ(::read(pipefd[0], data, sizeof(data)), 4);
+  EXPECT_EQ(string(data, 4), "pipe");
+  ::close(pipefd[0]);
+
+  // an empty buffer can not carry descriptors over a stream.
+  EXPECT_EQ(streams.first.send_fds(wbuf, &pipefd[0], 1), -1);
+}
+
+TEST(UnixTest, pass_fds_datagram) {
+  auto poller = Poller::new_instance();
+  auto socks = UnixDatagram::pair();
+  auto streams = UnixStream::pair();
+
+  // pass a connected stream, then talk over it.
+  ByteBuffer wbuf, rbuf;
+  int fd = streams.second.release();
+  wbuf.put_string("take it");
+  EXPECT_EQ(socks.first.send_fds(wbuf, &fd, 1), 7);
+  ::close(fd);
+
+  vector<int> fds;
+  ASSERT_TRUE(wait_readable(*poller, socks.second));
+  EXPECT_EQ(socks.second.recv_fds(rbuf, fds), 7);
+  ASSERT_EQ(fds.size(), 1);
+  UnixStream passed = UnixStream::from_fd(fds[0]);
+
+  rbuf.clear();
+  wbuf.put_string("over the passed stream");
+  streams.first.write(wbuf);
+  ASSERT_TRUE(wait_readable(*poller, passed));
+  passed.read(rbuf);
+  EXPECT_EQ(rbuf.take_string(), "over the passed stream");
+}
+
+TEST(UnixTest, pass_fds_truncated) {
+  auto poller = Poller::new_instance();
+  auto streams = UnixStream::pair();
+  // the credentials take a part of the control buffer of 'recv_fds'.
+  int on = 1;
+  ASSERT_EQ(::setsockopt(streams.second.fd(), SOL_SOCKET, SO_PASSCRED, &on,
+                         sizeof(on)),
+            0);
+
+  vector<int> sent(MaxPassedFds, 0);
+  ByteBuffer wbuf, rbuf;
+  wbuf.put_string("many");
+  ASSERT_EQ(streams.first.send_fds(wbuf, sent.data(), sent.size()), 4);
+
+  vector<int> fds;
+  ASSERT_TRUE(wait_readable(*poller, streams.second));
+  errno = 0;
+  EXPECT_EQ(streams.second.recv_fds(rbuf, fds), -1);
+  EXPECT_EQ(errno, EMSGSIZE);
+  EXPECT_TRUE(fds.empty());
+  EXPECT_EQ(rbuf.take_string(), "many");
+}